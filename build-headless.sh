@@ -0,0 +1,7 @@
+# Headless simulation runner (src/headless_main.cpp), no SDL, GL or audio so it builds on any box with g++
+mkdir -p build
+
+g++ -O2 -g -Wno-switch \
+  -std=c++11 -pthread \
+  -o build/headless \
+  src/headless_main.cpp
@@ -64,7 +64,7 @@ cl ^
   /LIBPATH:%SDL3_TTF__LIB_PATH% ^
   /LIBPATH:%FREETYPE__LIB_PATH% ^
   -PDB:%filename% ^
-  SDL3.lib SDL3_mixer.lib SDL3_ttf.lib freetype.lib ^
+  SDL3.lib SDL3_mixer.lib SDL3_ttf.lib freetype.lib ws2_32.lib ^
   /SUBSYSTEM:CONSOLE
 REM TODO: use /SUBSYSTEM:WINDOWS for release to avoid opening a console
 
@@ -6,15 +6,30 @@
 #include <glad/glad.h>
 #include <glm/glm.hpp>
 
+#include "gl_state.h"
+
+#include <string.h>
+
 #include <fstream>
 #include <iostream>
 #include <sstream>
 #include <string>
+#include <vector>
+
+// Reflected when the program links so setting a uniform never has to ask the driver where it lives
+struct Shader_Uniform
+{
+    std::string name;
+    GLint location;
+    GLenum type;
+    GLint size;  // Array length (1 for non-arrays)
+};
 
 class Shader
 {
    public:
     unsigned int ID;
+    std::vector<Shader_Uniform> uniforms;  // Active uniforms outside of uniform blocks
     // constructor generates the shader on the fly
     // ------------------------------------------------------------------------
     Shader(const char* vertexPath, const char* fragmentPath)
@@ -70,70 +85,133 @@ class Shader
         // delete the shaders as they're linked into our program now and no longer necessary
         glDeleteShader(vertex);
         glDeleteShader(fragment);
+
+        reflectUniforms();
     }
     // activate the shader
     // ------------------------------------------------------------------------
-    void use() const { glUseProgram(ID); }
+    void use() const { gl_state__use_program(ID); }  // Skipped if the program is already in use
+    // cached uniform lookup (-1 if the uniform doesn't exist or was optimized out, which glUniform* ignores)
+    // ------------------------------------------------------------------------
+    GLint getUniformLocation(const char* name) const
+    {
+        // Programs only have a handful of uniforms so a linear scan beats hashing
+        for (size_t i = 0; i < uniforms.size(); i++)
+        {
+            if (strcmp(uniforms[i].name.c_str(), name) == 0)
+            {
+                return uniforms[i].location;
+            }
+        }
+        return -1;
+    }
+    // point a named uniform block at a binding point shared with other programs
+    // ------------------------------------------------------------------------
+    void bindUniformBlock(const char* name, GLuint binding) const
+    {
+        GLuint block_index = glGetUniformBlockIndex(ID, name);
+        if (block_index != GL_INVALID_INDEX)
+        {
+            glUniformBlockBinding(ID, block_index, binding);
+        }
+    }
     // utility uniform functions
     // ------------------------------------------------------------------------
-    void setBool(const std::string& name, bool value) const
+    void setBool(const char* name, bool value) const
     {
-        glUniform1i(glGetUniformLocation(ID, name.c_str()), (int)value);
+        glUniform1i(getUniformLocation(name), (int)value);
     }
     // ------------------------------------------------------------------------
-    void setInt(const std::string& name, int value) const
+    void setInt(const char* name, int value) const
     {
-        glUniform1i(glGetUniformLocation(ID, name.c_str()), value);
+        glUniform1i(getUniformLocation(name), value);
     }
     // ------------------------------------------------------------------------
-    void setFloat(const std::string& name, real32 value) const
+    void setFloat(const char* name, real32 value) const
     {
-        glUniform1f(glGetUniformLocation(ID, name.c_str()), value);
+        glUniform1f(getUniformLocation(name), value);
     }
     // ------------------------------------------------------------------------
-    void setVec2(const std::string& name, const glm::vec2& value) const
+    void setVec2(const char* name, const glm::vec2& value) const
     {
-        glUniform2fv(glGetUniformLocation(ID, name.c_str()), 1, &value[0]);
+        glUniform2fv(getUniformLocation(name), 1, &value[0]);
     }
-    void setVec2(const std::string& name, real32 x, real32 y) const
+    void setVec2(const char* name, real32 x, real32 y) const
     {
-        glUniform2f(glGetUniformLocation(ID, name.c_str()), x, y);
+        glUniform2f(getUniformLocation(name), x, y);
     }
     // ------------------------------------------------------------------------
-    void setVec3(const std::string& name, const glm::vec3& value) const
+    void setVec3(const char* name, const glm::vec3& value) const
     {
-        glUniform3fv(glGetUniformLocation(ID, name.c_str()), 1, &value[0]);
+        glUniform3fv(getUniformLocation(name), 1, &value[0]);
     }
-    void setVec3(const std::string& name, real32 x, real32 y, real32 z) const
+    void setVec3(const char* name, real32 x, real32 y, real32 z) const
     {
-        glUniform3f(glGetUniformLocation(ID, name.c_str()), x, y, z);
+        glUniform3f(getUniformLocation(name), x, y, z);
     }
     // ------------------------------------------------------------------------
-    void setVec4(const std::string& name, const glm::vec4& value) const
+    void setVec4(const char* name, const glm::vec4& value) const
     {
-        glUniform4fv(glGetUniformLocation(ID, name.c_str()), 1, &value[0]);
+        glUniform4fv(getUniformLocation(name), 1, &value[0]);
     }
-    void setVec4(const std::string& name, real32 x, real32 y, real32 z, real32 w) const
+    void setVec4(const char* name, real32 x, real32 y, real32 z, real32 w) const
     {
-        glUniform4f(glGetUniformLocation(ID, name.c_str()), x, y, z, w);
+        glUniform4f(getUniformLocation(name), x, y, z, w);
     }
     // ------------------------------------------------------------------------
-    void setMat2(const std::string& name, const glm::mat2& mat) const
+    void setMat2(const char* name, const glm::mat2& mat) const
     {
-        glUniformMatrix2fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+        glUniformMatrix2fv(getUniformLocation(name), 1, GL_FALSE, &mat[0][0]);
     }
     // ------------------------------------------------------------------------
-    void setMat3(const std::string& name, const glm::mat3& mat) const
+    void setMat3(const char* name, const glm::mat3& mat) const
     {
-        glUniformMatrix3fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+        glUniformMatrix3fv(getUniformLocation(name), 1, GL_FALSE, &mat[0][0]);
     }
     // ------------------------------------------------------------------------
-    void setMat4(const std::string& name, const glm::mat4& mat) const
+    void setMat4(const char* name, const glm::mat4& mat) const
     {
-        glUniformMatrix4fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+        glUniformMatrix4fv(getUniformLocation(name), 1, GL_FALSE, &mat[0][0]);
     }
 
    private:
+    // ask the driver for every active uniform once, after linking
+    // ------------------------------------------------------------------------
+    void reflectUniforms()
+    {
+        GLint uniform_count = 0;
+        GLint max_name_length = 0;
+        glGetProgramiv(ID, GL_ACTIVE_UNIFORMS, &uniform_count);
+        glGetProgramiv(ID, GL_ACTIVE_UNIFORM_MAX_LENGTH, &max_name_length);
+
+        std::vector<char> name_buffer(max_name_length > 0 ? max_name_length : 1);
+        for (GLint i = 0; i < uniform_count; i++)
+        {
+            Shader_Uniform uniform;
+            GLsizei name_length = 0;
+            glGetActiveUniform(ID,
+                               (GLuint)i,
+                               (GLsizei)name_buffer.size(),
+                               &name_length,
+                               &uniform.size,
+                               &uniform.type,
+                               &name_buffer[0]);
+            uniform.name.assign(&name_buffer[0], name_length);
+            uniform.location = glGetUniformLocation(ID, uniform.name.c_str());
+            if (uniform.location < 0)
+            {
+                continue;  // Lives in a uniform block
+            }
+
+            // Arrays are reported as "name[0]", also allow looking them up by "name"
+            size_t bracket = uniform.name.find('[');
+            if (bracket != std::string::npos)
+            {
+                uniform.name.erase(bracket);
+            }
+            uniforms.push_back(uniform);
+        }
+    }
     // utility function for checking shader compilation/linking errors.
     // ------------------------------------------------------------------------
     void checkCompileErrors(unsigned int shader, std::string type)
@@ -0,0 +1,592 @@
+// Arena simulation
+//
+// Thousands of AI snakes on one big board, all going after the same eggs. Every snake moves on the same jump, at the
+// game's starting 10 jumps a second. A snake dies when it leaves the board or runs into a body, its own or anyone
+// else's. If two heads move into the same cell (or swap cells), both snakes die. A dead snake's body disappears and
+// it comes back somewhere else a couple of seconds later. Eaten eggs respawn right away, so there's always egg_count
+// of them around.
+//
+// All the snakes share one occupancy grid, a uint32 per cell holding who is there: 0 for nobody, snake index + 1, or
+// ARENA_EGG. The per-snake data is structure-of-arrays like batch_env.cpp's, and the body is a small ring of cells.
+//
+// A jump runs in phases, each a thread_pool__parallel_for over the snakes, so the end of one is a barrier for the
+// next:
+//     1. Think: every snake picks where it goes from the grid as it is. Nothing shared gets written.
+//     2. Resolve: every snake works out whether it survives the move. A cell is free if it's empty, has an egg, or is
+//        a tail that's moving away this jump. Heads going for the same cell look at each other's targets. Still
+//        nothing shared gets written.
+//     3. Clear: snakes that die take their body off the grid, survivors take their tail off (unless they grow).
+//     4. Move: survivors write their new head. No two survivors go for the same cell, that was a head-on in phase 2.
+// Then eggs and dead snakes get respawned on this thread, in snake order, with the arena's RNG. Every cell a phase
+// writes belongs to exactly one snake, so the result is the same no matter how many threads run it or how the snakes
+// get split up between them.
+//
+// Usage:
+//     arena_simulation__init(&sim, snake_count, egg_count, x_grids, y_grids);
+//     arena_simulation__reset(&sim, seed);
+//     loop: arena_simulation__step(&sim, &pool, dt);  // pool can be 0 to do it all on this thread
+//     sim.cells[y * x_grids + x] is who's where, sim.stats what happened
+//
+// Needs snake_simulation.cpp included before it (Direction, SNAKE_STARTING_GRID_JUMP__SECONDS and the RNG).
+
+#define ARENA_EMPTY 0
+#define ARENA_EGG 0xFFFFFFFF
+#define ARENA_NO_CELL 0xFFFFFFFF    // Target of a snake that's heading off the board
+#define ARENA_MAX_LENGTH 32         // Cells including the head, snakes stop growing here but keep eating
+#define ARENA_EGG_SEARCH_RADIUS 12  // Steps, past this a snake just wanders
+#define ARENA_RESPAWN_JUMPS 20      // Jumps a dead snake sits out
+#define ARENA_SPAWN_TRIES 8         // Random cells tried per spawn before giving up until the next jump
+#define ARENA_MIN_SNAKES_PER_BATCH 256
+#define ARENA_JUMP__SECONDS SNAKE_STARTING_GRID_JUMP__SECONDS
+
+#define ARENA_DEATH_CRASH 1    // Off the board or into a body
+#define ARENA_DEATH_HEAD_ON 2  // Into another head
+
+struct Arena_Stats
+{
+    uint32 alive_count;
+    uint64 eaten_egg_count;
+    uint64 death_count;
+    uint64 head_on_count;  // Deaths from running into another head
+    uint32 longest_length;
+};
+
+struct Arena_Simulation
+{
+    uint32 snake_count;
+    uint32 egg_count;  // Kept on the board
+    uint32 x_grids;
+    uint32 y_grids;
+    uint32 cell_count;
+
+    uint32 rng;  // Spawns, only touched between phases
+    uint32 jumps;
+    uint32 live_egg_count;
+    real32 time_until_jump__seconds;
+    Arena_Stats stats;
+
+    // One per cell: ARENA_EMPTY, ARENA_EGG or the index + 1 of the snake there
+    uint32* cells;
+
+    // One entry per snake
+    uint8* direction;  // Direction enum value
+    uint8* body_head;  // Ring slot of the head
+    uint8* will_eat;   // Phase scratch, the target has an egg
+    uint8* will_die;   // Phase scratch, ARENA_DEATH_*
+    uint16* length;    // Cells including the head, 0 while dead
+    uint16* respawn_jumps;
+    uint32* target_cell;  // Phase scratch, where the head goes this jump
+    uint32* goal_cell;    // Egg it's heading for, ARENA_NO_CELL for none
+    uint32* snake_rng;    // Own LCG for the AI, so thinking in parallel stays deterministic
+
+    // ARENA_MAX_LENGTH entries per snake, snake i starts at i * ARENA_MAX_LENGTH
+    uint32* body;
+
+    Memory_Arena arena;
+};
+
+bool32 arena_simulation__init(
+    Arena_Simulation* sim, uint32 snake_count, uint32 egg_count, uint32 x_grids, uint32 y_grids)
+{
+    uint32 cell_count = x_grids * y_grids;
+    if (snake_count + egg_count > cell_count / 2)
+    {
+        fprintf(stderr,
+                "ERROR::ARENA: %u snakes and %u eggs don't fit on a %ux%u board\n",
+                snake_count,
+                egg_count,
+                x_grids,
+                y_grids);
+        return 0;
+    }
+
+    sim->snake_count = snake_count;
+    sim->egg_count = egg_count;
+    sim->x_grids = x_grids;
+    sim->y_grids = y_grids;
+    sim->cell_count = cell_count;
+
+    size_t body_count = (size_t)snake_count * ARENA_MAX_LENGTH;
+    size_t arena_size = memory_arena__array_size(uint32, cell_count) +
+                        4 * memory_arena__array_size(uint8, snake_count) +
+                        2 * memory_arena__array_size(uint16, snake_count) +
+                        3 * memory_arena__array_size(uint32, snake_count) +
+                        memory_arena__array_size(uint32, body_count);
+    if (!memory_arena__reserve(&sim->arena, arena_size))
+    {
+        return 0;
+    }
+
+    sim->cells = memory_arena__push_array(&sim->arena, uint32, cell_count);
+    sim->direction = memory_arena__push_array(&sim->arena, uint8, snake_count);
+    sim->body_head = memory_arena__push_array(&sim->arena, uint8, snake_count);
+    sim->will_eat = memory_arena__push_array(&sim->arena, uint8, snake_count);
+    sim->will_die = memory_arena__push_array(&sim->arena, uint8, snake_count);
+    sim->length = memory_arena__push_array(&sim->arena, uint16, snake_count);
+    sim->respawn_jumps = memory_arena__push_array(&sim->arena, uint16, snake_count);
+    sim->target_cell = memory_arena__push_array(&sim->arena, uint32, snake_count);
+    sim->goal_cell = memory_arena__push_array(&sim->arena, uint32, snake_count);
+    sim->snake_rng = memory_arena__push_array(&sim->arena, uint32, snake_count);
+    sim->body = memory_arena__push_array(&sim->arena, uint32, body_count);
+
+    return 1;
+}
+
+void arena_simulation__free(Arena_Simulation* sim)
+{
+    memory_arena__free(&sim->arena);
+}
+
+local_internal uint32 arena_simulation__head(const Arena_Simulation* sim, uint32 snake)
+{
+    return sim->body[(size_t)snake * ARENA_MAX_LENGTH + sim->body_head[snake]];
+}
+
+local_internal uint32 arena_simulation__tail(const Arena_Simulation* sim, uint32 snake)
+{
+    uint32 slot = (sim->body_head[snake] + ARENA_MAX_LENGTH + 1 - sim->length[snake]) % ARENA_MAX_LENGTH;
+    return sim->body[(size_t)snake * ARENA_MAX_LENGTH + slot];
+}
+
+// Part i of a snake, 0 is the head
+uint32 arena_simulation__body_cell(const Arena_Simulation* sim, uint32 snake, uint32 i)
+{
+    uint32 slot = (sim->body_head[snake] + ARENA_MAX_LENGTH - i) % ARENA_MAX_LENGTH;
+    return sim->body[(size_t)snake * ARENA_MAX_LENGTH + slot];
+}
+
+// The tail stays put this jump, so nobody else can move into it
+local_internal bool32 arena_simulation__grows(const Arena_Simulation* sim, uint32 snake)
+{
+    return sim->will_eat[snake] && sim->length[snake] < ARENA_MAX_LENGTH;
+}
+
+// Cell one step from cell in direction, ARENA_NO_CELL off the board
+local_internal uint32 arena_simulation__neighbour(const Arena_Simulation* sim, uint32 cell, uint8 direction)
+{
+    uint32 x = cell % sim->x_grids;
+    uint32 y = cell / sim->x_grids;
+    switch (direction)
+    {
+        case DIRECTION_NORTH:
+        {
+            return y + 1 < sim->y_grids ? cell + sim->x_grids : ARENA_NO_CELL;
+        }
+        case DIRECTION_EAST:
+        {
+            return x + 1 < sim->x_grids ? cell + 1 : ARENA_NO_CELL;
+        }
+        case DIRECTION_SOUTH:
+        {
+            return y > 0 ? cell - sim->x_grids : ARENA_NO_CELL;
+        }
+        case DIRECTION_WEST:
+        {
+            return x > 0 ? cell - 1 : ARENA_NO_CELL;
+        }
+    }
+    return ARENA_NO_CELL;
+}
+
+local_internal uint32 arena_simulation__distance(const Arena_Simulation* sim, uint32 a, uint32 b)
+{
+    int32 dx = (int32)(a % sim->x_grids) - (int32)(b % sim->x_grids);
+    int32 dy = (int32)(a / sim->x_grids) - (int32)(b / sim->x_grids);
+    return (uint32)(abs(dx) + abs(dy));
+}
+
+//=======================================================
+// SPAWNING
+//=======================================================
+
+// Serial, between jumps, so it's the only thing using sim->rng
+local_internal uint32 arena_simulation__random_empty_cell(Arena_Simulation* sim)
+{
+    for (uint32 try_index = 0; try_index < ARENA_SPAWN_TRIES; try_index++)
+    {
+        uint32 cell = snake_rng__next(&sim->rng) % sim->cell_count;
+        if (sim->cells[cell] == ARENA_EMPTY)
+        {
+            return cell;
+        }
+    }
+    return ARENA_NO_CELL;
+}
+
+local_internal void arena_simulation__spawn_eggs(Arena_Simulation* sim)
+{
+    while (sim->live_egg_count < sim->egg_count)
+    {
+        uint32 cell = arena_simulation__random_empty_cell(sim);
+        if (cell == ARENA_NO_CELL)
+        {
+            return;  // Crowded, try again next jump
+        }
+        sim->cells[cell] = ARENA_EGG;
+        sim->live_egg_count++;
+    }
+}
+
+// A single cell, heading off in a random direction
+local_internal bool32 arena_simulation__spawn_snake(Arena_Simulation* sim, uint32 snake)
+{
+    uint32 cell = arena_simulation__random_empty_cell(sim);
+    if (cell == ARENA_NO_CELL)
+    {
+        return 0;
+    }
+    sim->cells[cell] = snake + 1;
+    sim->body[(size_t)snake * ARENA_MAX_LENGTH] = cell;
+    sim->body_head[snake] = 0;
+    sim->length[snake] = 1;
+    sim->direction[snake] = (uint8)(DIRECTION_NORTH + snake_rng__next(&sim->rng) % 4);
+    sim->goal_cell[snake] = ARENA_NO_CELL;
+    return 1;
+}
+
+void arena_simulation__reset(Arena_Simulation* sim, uint32 seed)
+{
+    memset(sim->cells, 0, sim->cell_count * sizeof(uint32));
+    sim->rng = seed;
+    sim->jumps = 0;
+    sim->live_egg_count = 0;
+    sim->time_until_jump__seconds = ARENA_JUMP__SECONDS;
+    sim->stats = Arena_Stats();
+
+    for (uint32 snake = 0; snake < sim->snake_count; snake++)
+    {
+        sim->length[snake] = 0;
+        sim->respawn_jumps[snake] = 0;
+        sim->will_eat[snake] = 0;
+        sim->will_die[snake] = 0;
+        sim->snake_rng[snake] = seed ^ ((snake + 1) * 2654435761u);  // Any different stream per snake will do
+        if (arena_simulation__spawn_snake(sim, snake))
+        {
+            sim->stats.alive_count++;
+        }
+    }
+    arena_simulation__spawn_eggs(sim);
+}
+
+//=======================================================
+// JUMP PHASES
+//=======================================================
+
+// Nearest egg within ARENA_EGG_SEARCH_RADIUS steps, going out one diamond-shaped ring at a time
+local_internal uint32 arena_simulation__find_egg(const Arena_Simulation* sim, uint32 cell)
+{
+    int32 x = (int32)(cell % sim->x_grids);
+    int32 y = (int32)(cell / sim->x_grids);
+    for (int32 radius = 1; radius <= ARENA_EGG_SEARCH_RADIUS; radius++)
+    {
+        for (int32 i = 0; i < radius; i++)
+        {
+            // One point on each side of the ring, going around it counterclockwise
+            int32 ring_x[4] = {x + i, x + radius - i, x - i, x - radius + i};
+            int32 ring_y[4] = {y + radius - i, y - i, y - radius + i, y + i};
+            for (uint32 side = 0; side < 4; side++)
+            {
+                if (ring_x[side] < 0 || ring_x[side] >= (int32)sim->x_grids || ring_y[side] < 0 ||
+                    ring_y[side] >= (int32)sim->y_grids)
+                {
+                    continue;
+                }
+                uint32 ring_cell = (uint32)ring_y[side] * sim->x_grids + (uint32)ring_x[side];
+                if (sim->cells[ring_cell] == ARENA_EGG)
+                {
+                    return ring_cell;
+                }
+            }
+        }
+    }
+    return ARENA_NO_CELL;
+}
+
+// Another snake could go for the same cell
+local_internal bool32 arena_simulation__is_next_to_other_head(const Arena_Simulation* sim, uint32 cell, uint32 snake)
+{
+    for (uint8 direction = DIRECTION_NORTH; direction <= DIRECTION_WEST; direction++)
+    {
+        uint32 neighbour = arena_simulation__neighbour(sim, cell, direction);
+        if (neighbour == ARENA_NO_CELL)
+        {
+            continue;
+        }
+        uint32 occupant = sim->cells[neighbour];
+        if (occupant != ARENA_EMPTY && occupant != ARENA_EGG && occupant - 1 != snake &&
+            arena_simulation__head(sim, occupant - 1) == neighbour)
+        {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+// Phase 1: head for the nearest egg without running into anything that's there now. Goes straight if it can when
+// there's nothing to head for, with the odd random turn.
+local_internal void arena_simulation__think(void* data, uint32 first, uint32 count)
+{
+    Arena_Simulation* sim = (Arena_Simulation*)data;
+    for (uint32 snake = first; snake < first + count; snake++)
+    {
+        sim->will_eat[snake] = 0;
+        sim->will_die[snake] = 0;
+        if (!sim->length[snake])
+        {
+            continue;
+        }
+
+        uint32 head = arena_simulation__head(sim, snake);
+        uint32 goal = sim->goal_cell[snake];
+        if (goal == ARENA_NO_CELL || sim->cells[goal] != ARENA_EGG)
+        {
+            goal = arena_simulation__find_egg(sim, head);
+            sim->goal_cell[snake] = goal;
+        }
+
+        // Straight, then both turns, in a random order so wandering snakes don't all curl the same way
+        uint8 direction = sim->direction[snake];
+        uint32 turn = snake_rng__next(&sim->snake_rng[snake]) >> 16;
+        uint8 candidates[3] = {direction,
+                               (uint8)(DIRECTION_NORTH + (direction - DIRECTION_NORTH + 1 + (turn & 1) * 2) % 4),
+                               (uint8)(DIRECTION_NORTH + (direction - DIRECTION_NORTH + 3 - (turn & 1) * 2) % 4)};
+        bool32 should_wander = goal == ARENA_NO_CELL && (turn & 0x70) == 0;  // 1 in 8
+
+        uint8 best_direction = direction;
+        uint32 best_target = arena_simulation__neighbour(sim, head, direction);
+        uint32 best_score = 0;  // 1 for not hitting anything, +2 for no other head next to it, +1 for closer
+        for (uint32 i = should_wander ? 1 : 0; i < (should_wander ? 4u : 3u); i++)
+        {
+            uint8 candidate = candidates[i % 3];
+            uint32 target = arena_simulation__neighbour(sim, head, candidate);
+            if (target == ARENA_NO_CELL || (sim->cells[target] != ARENA_EMPTY && sim->cells[target] != ARENA_EGG))
+            {
+                continue;
+            }
+            uint32 score = 1;
+            score += arena_simulation__is_next_to_other_head(sim, target, snake) ? 0 : 2;
+            score += goal != ARENA_NO_CELL &&
+                     arena_simulation__distance(sim, target, goal) < arena_simulation__distance(sim, head, goal);
+            if (score > best_score)
+            {
+                best_direction = candidate;
+                best_target = target;
+                best_score = score;
+            }
+        }
+
+        sim->direction[snake] = best_direction;
+        sim->target_cell[snake] = best_target;
+        sim->will_eat[snake] = best_target != ARENA_NO_CELL && sim->cells[best_target] == ARENA_EGG;
+    }
+}
+
+// Phase 2: does the move kill it
+local_internal void arena_simulation__resolve(void* data, uint32 first, uint32 count)
+{
+    Arena_Simulation* sim = (Arena_Simulation*)data;
+    for (uint32 snake = first; snake < first + count; snake++)
+    {
+        if (!sim->length[snake])
+        {
+            continue;
+        }
+
+        uint32 target = sim->target_cell[snake];
+        if (target == ARENA_NO_CELL)
+        {
+            sim->will_die[snake] = ARENA_DEATH_CRASH;
+            continue;
+        }
+
+        uint32 occupant = sim->cells[target];
+        if (occupant != ARENA_EMPTY && occupant != ARENA_EGG)
+        {
+            // Only a tail that's leaving is fine. If its owner dies instead, the body goes and the cell's free anyway.
+            // Swapping heads with a snake that's just a head counts as a head-on.
+            uint32 other = occupant - 1;
+            if (arena_simulation__tail(sim, other) != target || arena_simulation__grows(sim, other))
+            {
+                sim->will_die[snake] = ARENA_DEATH_CRASH;
+                continue;
+            }
+            if (sim->length[other] == 1 && sim->target_cell[other] == arena_simulation__head(sim, snake))
+            {
+                sim->will_die[snake] = ARENA_DEATH_HEAD_ON;
+                continue;
+            }
+        }
+
+        // Any other head next to the target going for it too
+        for (uint8 direction = DIRECTION_NORTH; direction <= DIRECTION_WEST; direction++)
+        {
+            uint32 neighbour = arena_simulation__neighbour(sim, target, direction);
+            if (neighbour == ARENA_NO_CELL)
+            {
+                continue;
+            }
+            uint32 other = sim->cells[neighbour] - 1;
+            if (sim->cells[neighbour] != ARENA_EMPTY && sim->cells[neighbour] != ARENA_EGG && other != snake &&
+                arena_simulation__head(sim, other) == neighbour && sim->target_cell[other] == target)
+            {
+                sim->will_die[snake] = ARENA_DEATH_HEAD_ON;
+                break;
+            }
+        }
+    }
+}
+
+// Phase 3: every snake only clears its own cells
+local_internal void arena_simulation__clear(void* data, uint32 first, uint32 count)
+{
+    Arena_Simulation* sim = (Arena_Simulation*)data;
+    for (uint32 snake = first; snake < first + count; snake++)
+    {
+        if (!sim->length[snake])
+        {
+            continue;
+        }
+
+        if (sim->will_die[snake])
+        {
+            for (uint32 i = 0; i < sim->length[snake]; i++)
+            {
+                sim->cells[arena_simulation__body_cell(sim, snake, i)] = ARENA_EMPTY;
+            }
+        }
+        else if (!arena_simulation__grows(sim, snake))
+        {
+            sim->cells[arena_simulation__tail(sim, snake)] = ARENA_EMPTY;
+        }
+    }
+}
+
+// Phase 4: survivors move their heads, no two of them have the same target
+local_internal void arena_simulation__move(void* data, uint32 first, uint32 count)
+{
+    Arena_Simulation* sim = (Arena_Simulation*)data;
+    for (uint32 snake = first; snake < first + count; snake++)
+    {
+        if (!sim->length[snake] || sim->will_die[snake])
+        {
+            continue;
+        }
+
+        uint32 target = sim->target_cell[snake];
+        if (arena_simulation__grows(sim, snake))
+        {
+            sim->length[snake]++;
+        }
+        sim->body_head[snake] = (uint8)((sim->body_head[snake] + 1) % ARENA_MAX_LENGTH);
+        sim->body[(size_t)snake * ARENA_MAX_LENGTH + sim->body_head[snake]] = target;
+        sim->cells[target] = snake + 1;
+    }
+}
+
+local_internal void arena_simulation__run_phase(
+    Arena_Simulation* sim, Thread_Pool* pool, Thread_Pool__For_Function phase)
+{
+    if (pool)
+    {
+        thread_pool__parallel_for(pool, sim->snake_count, ARENA_MIN_SNAKES_PER_BATCH, phase, sim);
+    }
+    else
+    {
+        phase(sim, 0, sim->snake_count);
+    }
+}
+
+//=======================================================
+// STEP
+//=======================================================
+
+// Moves every snake once
+void arena_simulation__jump(Arena_Simulation* sim, Thread_Pool* pool)
+{
+    arena_simulation__run_phase(sim, pool, arena_simulation__think);
+    arena_simulation__run_phase(sim, pool, arena_simulation__resolve);
+    arena_simulation__run_phase(sim, pool, arena_simulation__clear);
+    arena_simulation__run_phase(sim, pool, arena_simulation__move);
+
+    // The bookkeeping and the spawns in snake order, so they come out the same however the phases were split up
+    Arena_Stats* stats = &sim->stats;
+    stats->longest_length = 0;
+    for (uint32 snake = 0; snake < sim->snake_count; snake++)
+    {
+        if (!sim->length[snake])
+        {
+            continue;
+        }
+
+        if (sim->will_die[snake])
+        {
+            stats->head_on_count += sim->will_die[snake] == ARENA_DEATH_HEAD_ON ? 1 : 0;
+            stats->death_count++;
+            stats->alive_count--;
+            sim->length[snake] = 0;
+            sim->respawn_jumps[snake] = ARENA_RESPAWN_JUMPS;
+            continue;
+        }
+
+        if (sim->will_eat[snake])
+        {
+            stats->eaten_egg_count++;
+            sim->live_egg_count--;
+        }
+        stats->longest_length = sim->length[snake] > stats->longest_length ? sim->length[snake] : stats->longest_length;
+    }
+
+    arena_simulation__spawn_eggs(sim);
+    for (uint32 snake = 0; snake < sim->snake_count; snake++)
+    {
+        if (sim->length[snake])
+        {
+            continue;
+        }
+        if (sim->respawn_jumps[snake])
+        {
+            sim->respawn_jumps[snake]--;
+        }
+        else if (arena_simulation__spawn_snake(sim, snake))
+        {
+            stats->alive_count++;
+        }
+    }
+
+    sim->jumps++;
+}
+
+// Returns how many jumps it made
+uint32 arena_simulation__step(Arena_Simulation* sim, Thread_Pool* pool, real32 dt)
+{
+    uint32 jump_count = 0;
+    sim->time_until_jump__seconds -= dt;
+    while (sim->time_until_jump__seconds <= 0)
+    {
+        sim->time_until_jump__seconds += ARENA_JUMP__SECONDS;
+        arena_simulation__jump(sim, pool);
+        jump_count++;
+    }
+    return jump_count;
+}
+
+// FNV-1a over the grid and the snakes, for checking two runs ended up the same
+uint64 arena_simulation__hash(const Arena_Simulation* sim)
+{
+    uint64 hash = 14695981039346656037ULL;
+    const uint32* arrays[2] = {sim->cells, sim->body};
+    size_t counts[2] = {sim->cell_count, (size_t)sim->snake_count * ARENA_MAX_LENGTH};
+    for (uint32 a = 0; a < 2; a++)
+    {
+        for (size_t i = 0; i < counts[a]; i++)
+        {
+            hash = (hash ^ arrays[a][i]) * 1099511628211ULL;
+        }
+    }
+    for (uint32 snake = 0; snake < sim->snake_count; snake++)
+    {
+        hash = (hash ^ sim->length[snake]) * 1099511628211ULL;
+        hash = (hash ^ sim->direction[snake]) * 1099511628211ULL;
+    }
+    return hash;
+}
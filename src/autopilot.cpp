@@ -0,0 +1,178 @@
+// Autopilot
+//
+// Plays the game by itself (attract mode, soak tests). It follows a Hamiltonian cycle, a loop through every cell of the
+// board exactly once, and takes shortcuts toward the egg whenever skipping ahead can't trap the snake. Following the
+// cycle keeps the body on one stretch of it between the tail and the head. The next cell along the cycle is then always
+// free (or is the tail moving out of the way), so the snake can never box itself in. A shortcut is only taken if it
+// lands short of the egg and well short of the tail, which keeps that true. Early on that's close to the shortest path
+// to the egg. Once the snake covers half the board it just tails its own body around the cycle until the board is
+// full.
+//
+// Planning is incremental: the cycle is built once per board size and each grid jump only looks at the four cells
+// around the head, with no search at all. That's O(1) per jump no matter how long the snake gets, so it keeps up even
+// when the snake jumps every tick.
+//
+// NOTE: A Hamiltonian cycle only exists if the board has an even number of rows or columns.
+//
+// Usage:
+//     autopilot__init(&autopilot, x_grids, y_grids);
+//     if (snake_simulation__jumps_next_step(&sim, dt))
+//         snake_simulation__queue_input(&sim, autopilot__choose_direction(&autopilot, &sim));
+
+#define AUTOPILOT_TAIL_ROOM 3  // Cells a shortcut leaves between the head and the tail, room for the body to grow
+
+struct Autopilot
+{
+    uint32 x_grids;
+    uint32 y_grids;
+    uint32* cycle_position;  // Where each cell (y * x_grids + x) is along the cycle
+
+    // Planner timings since the last autopilot__reset_timings
+    uint64 plan_count;
+    real64 plan_total__us;
+    real32 plan_max__us;
+
+    Memory_Arena arena;
+};
+
+void autopilot__reset_timings(Autopilot* autopilot)
+{
+    autopilot->plan_count = 0;
+    autopilot->plan_total__us = 0;
+    autopilot->plan_max__us = 0;
+}
+
+real32 autopilot__plan_mean__us(Autopilot* autopilot)
+{
+    return autopilot->plan_count ? (real32)(autopilot->plan_total__us / autopilot->plan_count) : 0.0f;
+}
+
+// Builds the cycle for the board, does nothing if it's already built for this size
+bool32 autopilot__init(Autopilot* autopilot, uint32 x_grids, uint32 y_grids)
+{
+    if (autopilot->cycle_position && autopilot->x_grids == x_grids && autopilot->y_grids == y_grids)
+    {
+        return 1;
+    }
+    if (x_grids < 2 || y_grids < 2 || (x_grids % 2 && y_grids % 2))
+    {
+        fprintf(stderr, "ERROR::AUTOPILOT: No Hamiltonian cycle on a %ux%u board\n", x_grids, y_grids);
+        return 0;
+    }
+
+    uint32 cell_count = x_grids * y_grids;
+    if (!memory_arena__reserve(&autopilot->arena, memory_arena__array_size(uint32, cell_count)))
+    {
+        return 0;
+    }
+    autopilot->cycle_position = memory_arena__push_array(&autopilot->arena, uint32, cell_count);
+    autopilot->x_grids = x_grids;
+    autopilot->y_grids = y_grids;
+
+    // Laid out in rows if there's an even number of them, otherwise in columns: along the first row, zig-zag up
+    // through the rest of the rows leaving out the first column, then back down the first column.
+    bool32 is_transposed = y_grids % 2;
+    uint32 width = is_transposed ? y_grids : x_grids;
+    uint32 height = is_transposed ? x_grids : y_grids;
+
+    uint32 position = 0;
+#define AUTOPILOT_VISIT(u, v) \
+    autopilot->cycle_position[is_transposed ? (u) * x_grids + (v) : (v) * x_grids + (u)] = position++
+
+    for (uint32 u = 0; u < width; u++)
+    {
+        AUTOPILOT_VISIT(u, 0);
+    }
+    for (uint32 v = 1; v < height; v++)
+    {
+        for (uint32 i = 1; i < width; i++)
+        {
+            uint32 u = v % 2 ? width - i : i;  // Odd rows go back toward the first column
+            AUTOPILOT_VISIT(u, v);
+        }
+    }
+    for (uint32 v = height - 1; v >= 1; v--)
+    {
+        AUTOPILOT_VISIT(0, v);
+    }
+#undef AUTOPILOT_VISIT
+
+    autopilot__reset_timings(autopilot);
+    return 1;
+}
+
+void autopilot__free(Autopilot* autopilot)
+{
+    memory_arena__free(&autopilot->arena);
+    autopilot->cycle_position = 0;
+}
+
+// Picks the direction for the snake's next jump
+Direction autopilot__choose_direction(Autopilot* autopilot, Snake_Simulation* sim)
+{
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+    uint32 cell_count = sim->x_grids * sim->y_grids;
+    uint32 head_position = autopilot->cycle_position[snake_simulation__cell_index(sim, sim->pos_x, sim->pos_y)];
+#define AUTOPILOT_DISTANCE(x, y)                                                                    \
+    ((autopilot->cycle_position[snake_simulation__cell_index(sim, (x), (y))] + cell_count - head_position) % \
+     cell_count)
+
+    uint32 length = sim->next_snake_part_index;
+    uint32 distance_to_tail = cell_count;  // With no body the whole cycle is ahead
+    if (length)
+    {
+        Snake_Part* tail = snake_simulation__part(sim, length - 1);
+        distance_to_tail = AUTOPILOT_DISTANCE(tail->pos_x, tail->pos_y);
+    }
+    uint32 distance_to_egg = AUTOPILOT_DISTANCE(sim->blip_pos_x, sim->blip_pos_y);
+
+    // How far along the cycle this jump may skip, 1 is just following it
+    uint32 max_skip = 1;
+    if (length + 1 < cell_count / 2 && distance_to_tail > AUTOPILOT_TAIL_ROOM + 1)
+    {
+        max_skip = distance_to_tail - AUTOPILOT_TAIL_ROOM;
+        max_skip = distance_to_egg && distance_to_egg < max_skip ? distance_to_egg : max_skip;
+    }
+
+    // The head is on the egg, so the tail stays put this jump
+    bool32 is_growing = sim->pos_x == sim->blip_pos_x && sim->pos_y == sim->blip_pos_y;
+
+    const Direction directions[] = {DIRECTION_NORTH, DIRECTION_EAST, DIRECTION_SOUTH, DIRECTION_WEST};
+    const Direction opposites[] = {DIRECTION_SOUTH, DIRECTION_WEST, DIRECTION_NORTH, DIRECTION_EAST};
+    const int32 step_x[] = {0, 1, 0, -1};
+    const int32 step_y[] = {1, 0, -1, 0};
+
+    Direction best_direction = sim->current_direction;
+    uint32 best_distance = 0;
+    for (uint32 i = 0; i < 4; i++)
+    {
+        int32 x = sim->pos_x + step_x[i];
+        int32 y = sim->pos_y + step_y[i];
+        if (x < 0 || x >= (int32)sim->x_grids || y < 0 || y >= (int32)sim->y_grids ||
+            opposites[i] == sim->current_direction)
+        {
+            continue;  // The game ignores turning back on itself
+        }
+
+        uint32 distance = AUTOPILOT_DISTANCE(x, y);
+        bool32 is_tail_leaving = distance == distance_to_tail && length && !is_growing;
+        if (snake_simulation__is_cell_occupied(sim, x, y) && !is_tail_leaving)
+        {
+            continue;
+        }
+        if (distance <= max_skip && distance > best_distance)
+        {
+            best_direction = directions[i];
+            best_distance = distance;
+        }
+    }
+#undef AUTOPILOT_DISTANCE
+
+    real32 plan__us = std::chrono::duration<real32, std::micro>(std::chrono::steady_clock::now() - start).count();
+    autopilot->plan_count++;
+    autopilot->plan_total__us += plan__us;
+    autopilot->plan_max__us = plan__us > autopilot->plan_max__us ? plan__us : autopilot->plan_max__us;
+
+    return best_direction;
+}
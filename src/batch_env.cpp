@@ -0,0 +1,327 @@
+// Batch environment
+//
+// Steps many independent games at once for bots and tuning, with the same rules as snake_simulation.cpp. A game here
+// plays out exactly like a Snake_Simulation fed the same seed and inputs. Everything is stored structure-of-arrays:
+// one array per field with an entry per game, plus flat per-game blocks for the body ring and the occupied cell bits,
+// so a tick walks memory front to back.
+//
+// A step has two passes. The first one is a branch-free loop over every game's timer, which the compiler vectorizes,
+// and it lists which games jump this tick (about one in ten at the start). The second pass only does the scalar move
+// work for the listed games. Callers that pick actions with a policy can do it in between, for just those games.
+//
+// Disjoint ranges of games can be stepped from different threads at the same time.
+//
+// Usage:
+//     batch_env__init(&env, game_count, x_grids, y_grids);
+//     batch_env__reset_all(&env, seed);
+//     loop:
+//         uint32 jumping_count = batch_env__begin_step(&env, first, count, dt);
+//         actions[env.jumping_games[first + i]] = direction to turn to (DIRECTION_NONE keeps going), i < jumping_count
+//         batch_env__finish_step(&env, first, jumping_count, actions);
+//         env.done[game] and env.ate_egg[game] say what happened, batch_env__reset(&env, game, seed) starts a new game
+//
+//     or with all the actions up front: batch_env__step(&env, actions, dt);
+
+#define BATCH_ENV_MAX_CELLS 0xFFFF  // Body cells are stored as uint16
+
+struct Batch_Env
+{
+    uint32 game_count;
+    uint32 x_grids;
+    uint32 y_grids;
+    uint32 cell_count;
+    uint32 word_count;  // Of occupied_cells per game
+
+    // One entry per game
+    int32* head_x;
+    int32* head_y;
+    uint8* direction;  // Direction enum value
+    uint32* length;    // Body parts behind the head, i.e. the score
+    int32* egg_x;
+    int32* egg_y;
+    uint32* rng;
+    real32* time_until_grid_jump__seconds;
+    real32* set_time_until_grid_jump__seconds;
+    uint32* ticks;
+    uint8* done;     // Game over, stays set until the game is reset
+    uint8* ate_egg;  // Ate an egg during the last step
+    uint8* is_jumping;      // Scratch for batch_env__begin_step
+    uint32* jumping_games;  // Games that jump this step, listed from their range's first index (batch_env__begin_step)
+    uint32* body_first;
+    uint32* free_cell_count;
+
+    // cell_count entries per game, game i starts at i * cell_count
+    uint16* body;  // Ring of body cells (y * x_grids + x), part 0 is right behind the head
+
+    // word_count entries per game, one bit per cell like Snake_Simulation's (bits past the last cell are set)
+    uint64* occupied_cells;
+
+    Memory_Arena arena;
+};
+
+bool32 batch_env__init(Batch_Env* env, uint32 game_count, uint32 x_grids, uint32 y_grids)
+{
+    uint32 cell_count = x_grids * y_grids;
+    if (cell_count >= BATCH_ENV_MAX_CELLS)
+    {
+        fprintf(stderr, "ERROR::BATCH_ENV: A %ux%u board has too many cells\n", x_grids, y_grids);
+        return 0;
+    }
+
+    env->game_count = game_count;
+    env->x_grids = x_grids;
+    env->y_grids = y_grids;
+    env->cell_count = cell_count;
+    env->word_count = (cell_count + 63) / 64;
+
+    size_t per_game_cells = (size_t)game_count * cell_count;
+    size_t per_game_words = (size_t)game_count * env->word_count;
+    size_t arena_size = 10 * memory_arena__array_size(int32, game_count) +
+                        2 * memory_arena__array_size(real32, game_count) +
+                        4 * memory_arena__array_size(uint8, game_count) +
+                        memory_arena__array_size(uint16, per_game_cells) +
+                        memory_arena__array_size(uint64, per_game_words);
+    if (!memory_arena__reserve(&env->arena, arena_size))
+    {
+        return 0;
+    }
+
+    env->head_x = memory_arena__push_array(&env->arena, int32, game_count);
+    env->head_y = memory_arena__push_array(&env->arena, int32, game_count);
+    env->length = memory_arena__push_array(&env->arena, uint32, game_count);
+    env->egg_x = memory_arena__push_array(&env->arena, int32, game_count);
+    env->egg_y = memory_arena__push_array(&env->arena, int32, game_count);
+    env->rng = memory_arena__push_array(&env->arena, uint32, game_count);
+    env->ticks = memory_arena__push_array(&env->arena, uint32, game_count);
+    env->body_first = memory_arena__push_array(&env->arena, uint32, game_count);
+    env->time_until_grid_jump__seconds = memory_arena__push_array(&env->arena, real32, game_count);
+    env->set_time_until_grid_jump__seconds = memory_arena__push_array(&env->arena, real32, game_count);
+    env->direction = memory_arena__push_array(&env->arena, uint8, game_count);
+    env->done = memory_arena__push_array(&env->arena, uint8, game_count);
+    env->ate_egg = memory_arena__push_array(&env->arena, uint8, game_count);
+    env->is_jumping = memory_arena__push_array(&env->arena, uint8, game_count);
+    env->jumping_games = memory_arena__push_array(&env->arena, uint32, game_count);
+    env->free_cell_count = memory_arena__push_array(&env->arena, uint32, game_count);
+    env->body = memory_arena__push_array(&env->arena, uint16, per_game_cells);
+    env->occupied_cells = memory_arena__push_array(&env->arena, uint64, per_game_words);
+
+    return 1;
+}
+
+void batch_env__free(Batch_Env* env)
+{
+    memory_arena__free(&env->arena);
+}
+
+bool32 batch_env__is_cell_occupied(const uint64* occupied_cells, uint32 cell)
+{
+    return (occupied_cells[cell / 64] >> (cell % 64)) & 1;
+}
+
+local_internal void batch_env__occupy_cell(uint64* occupied_cells, uint32* free_cell_count, uint32 cell)
+{
+    assert(!batch_env__is_cell_occupied(occupied_cells, cell));
+    occupied_cells[cell / 64] |= (uint64)1 << (cell % 64);
+    --*free_cell_count;
+}
+
+local_internal void batch_env__free_cell(uint64* occupied_cells, uint32* free_cell_count, uint32 cell)
+{
+    assert(batch_env__is_cell_occupied(occupied_cells, cell));
+    occupied_cells[cell / 64] &= ~((uint64)1 << (cell % 64));
+    ++*free_cell_count;
+}
+
+// Starts a new game in slot i, same starting position and egg as snake_simulation__reset
+void batch_env__reset(Batch_Env* env, uint32 i, uint32 seed)
+{
+    env->head_x[i] = env->x_grids / 2;
+    env->head_y[i] = env->y_grids / 4;
+    env->direction[i] = DIRECTION_NORTH;
+    env->length[i] = 0;
+    env->egg_x[i] = env->x_grids / 2;
+    env->egg_y[i] = env->y_grids / 2;
+    env->rng[i] = seed;
+    env->set_time_until_grid_jump__seconds[i] = SNAKE_STARTING_GRID_JUMP__SECONDS;
+    env->time_until_grid_jump__seconds[i] = SNAKE_STARTING_GRID_JUMP__SECONDS;
+    env->ticks[i] = 0;
+    env->done[i] = 0;
+    env->ate_egg[i] = 0;
+    env->body_first[i] = 0;
+
+    uint64* occupied_cells = env->occupied_cells + (size_t)i * env->word_count;
+    memset(occupied_cells, 0, env->word_count * sizeof(uint64));
+    if (env->cell_count % 64)
+    {
+        occupied_cells[env->cell_count / 64] = ~(uint64)0 << (env->cell_count % 64);
+    }
+    env->free_cell_count[i] = env->cell_count;
+    batch_env__occupy_cell(
+        occupied_cells, &env->free_cell_count[i], (uint32)env->head_y[i] * env->x_grids + env->head_x[i]);
+}
+
+// Every game gets its own seed, one LCG step apart, like consecutive games in the headless runner
+void batch_env__reset_all(Batch_Env* env, uint32 seed)
+{
+    for (uint32 i = 0; i < env->game_count; i++)
+    {
+        batch_env__reset(env, i, seed);
+        snake_rng__next(&seed);
+    }
+}
+
+// Scalar part of the step for one game that's jumping, mirrors the jump in snake_simulation__step
+local_internal void batch_env__move(Batch_Env* env, uint32 i, uint8 action)
+{
+    uint8 direction = env->direction[i];
+    switch (action)
+    {
+        case DIRECTION_NORTH:
+        {
+            direction = direction != DIRECTION_SOUTH ? (uint8)DIRECTION_NORTH : direction;
+        }
+        break;
+        case DIRECTION_EAST:
+        {
+            direction = direction != DIRECTION_WEST ? (uint8)DIRECTION_EAST : direction;
+        }
+        break;
+        case DIRECTION_SOUTH:
+        {
+            direction = direction != DIRECTION_NORTH ? (uint8)DIRECTION_SOUTH : direction;
+        }
+        break;
+        case DIRECTION_WEST:
+        {
+            direction = direction != DIRECTION_EAST ? (uint8)DIRECTION_WEST : direction;
+        }
+        break;
+    }
+    env->direction[i] = direction;
+
+    uint32 cell_count = env->cell_count;
+    uint16* body = env->body + (size_t)i * cell_count;
+    uint64* occupied_cells = env->occupied_cells + (size_t)i * env->word_count;
+    uint32* free_cell_count = &env->free_cell_count[i];
+
+    int32 x = env->head_x[i];
+    int32 y = env->head_y[i];
+
+    bool32 has_grown = 0;
+    if (x == env->egg_x[i] && y == env->egg_y[i])
+    {
+        env->ate_egg[i] = 1;
+        if (!*free_cell_count)
+        {  // The snake fills the whole board, it stops here without growing or moving
+            env->done[i] = 1;
+            env->time_until_grid_jump__seconds[i] = env->set_time_until_grid_jump__seconds[i];
+            return;
+        }
+        env->length[i]++;
+        has_grown = 1;
+
+        uint32 cell = snake_simulation__random_free_cell(
+            occupied_cells, env->word_count, cell_count, *free_cell_count, &env->rng[i]);
+        env->egg_x[i] = cell % env->x_grids;
+        env->egg_y[i] = cell / env->x_grids;
+
+        env->set_time_until_grid_jump__seconds[i] -= 0.0005f;
+    }
+
+    {  // The head's old cell becomes the new part 0
+        // NOTE: Wrapping with compares rather than %, the divide is a big part of a move
+        uint32 first = env->body_first[i] ? env->body_first[i] - 1 : cell_count - 1;
+        env->body_first[i] = first;
+        body[first] = (uint16)((uint32)y * env->x_grids + (uint32)x);
+
+        if (!has_grown)
+        {
+            uint32 dropped_index = first + env->length[i];
+            dropped_index -= dropped_index >= cell_count ? cell_count : 0;
+            uint32 dropped_cell = body[dropped_index];
+            batch_env__free_cell(occupied_cells, free_cell_count, dropped_cell);
+        }
+    }
+
+    x += direction == DIRECTION_EAST ? 1 : direction == DIRECTION_WEST ? -1 : 0;
+    y += direction == DIRECTION_NORTH ? 1 : direction == DIRECTION_SOUTH ? -1 : 0;
+    env->head_x[i] = x;
+    env->head_y[i] = y;
+
+    if (x < 0 || x >= (int32)env->x_grids || y < 0 || y >= (int32)env->y_grids)
+    {
+        env->done[i] = 1;
+    }
+    else
+    {
+        uint32 cell = (uint32)y * env->x_grids + (uint32)x;
+        if (batch_env__is_cell_occupied(occupied_cells, cell))
+        {
+            env->done[i] = 1;  // Ran into its own body
+        }
+        else
+        {
+            batch_env__occupy_cell(occupied_cells, free_cell_count, cell);
+        }
+    }
+
+    env->time_until_grid_jump__seconds[i] = env->set_time_until_grid_jump__seconds[i];
+}
+
+// Pass one for games [first, first + count): runs every game's timer and lists the games that jump this step in
+// env->jumping_games[first, first + returned count). Actions only matter for those games, so callers can pick them in
+// between the passes.
+uint32 batch_env__begin_step(Batch_Env* env, uint32 first, uint32 count, real32 dt_s)
+{
+    uint32 end = first + count;
+
+    {  // Timers for every game, no branches so it vectorizes
+        uint32* ticks = env->ticks;
+        real32* time_until_grid_jump = env->time_until_grid_jump__seconds;
+        const uint8* done = env->done;
+        uint8* ate_egg = env->ate_egg;
+        uint8* is_jumping = env->is_jumping;
+        for (uint32 i = first; i < end; i++)
+        {
+            uint32 is_running = 1u - done[i];
+            ticks[i] += is_running;
+            real32 time = time_until_grid_jump[i] - dt_s;
+            time_until_grid_jump[i] = is_running ? time : time_until_grid_jump[i];
+            is_jumping[i] = (uint8)(is_running & (time <= 0));
+            ate_egg[i] = 0;
+        }
+    }
+
+    // Compacted so the other passes (here and in the caller) only visit the few games that jump
+    uint32* jumping_games = env->jumping_games + first;
+    uint32 jumping_count = 0;
+    for (uint32 i = first; i < end; i++)
+    {
+        jumping_games[jumping_count] = i;
+        jumping_count += env->is_jumping[i];
+    }
+    return jumping_count;
+}
+
+// Pass two: moves the games batch_env__begin_step listed for the range starting at `first`. `actions` is indexed by
+// game like every other array. Finished games don't move until they're reset.
+void batch_env__finish_step(Batch_Env* env, uint32 first, uint32 jumping_count, const uint8* actions)
+{
+    const uint32* jumping_games = env->jumping_games + first;
+    for (uint32 i = 0; i < jumping_count; i++)
+    {
+        uint32 game = jumping_games[i];
+        batch_env__move(env, game, actions[game]);
+    }
+}
+
+void batch_env__step_range(Batch_Env* env, uint32 first, uint32 count, const uint8* actions, real32 dt_s)
+{
+    uint32 jumping_count = batch_env__begin_step(env, first, count, dt_s);
+    batch_env__finish_step(env, first, jumping_count, actions);
+}
+
+void batch_env__step(Batch_Env* env, const uint8* actions, real32 dt_s)
+{
+    batch_env__step_range(env, 0, env->game_count, actions, dt_s);
+}
@@ -54,6 +54,11 @@ char work_ms_per_frame_text[DEBUG_TEXT_STRING_LENGTH] = "";
 char writing_buffer_ms_per_frame_text[DEBUG_TEXT_STRING_LENGTH] = "";
 char render_ms_per_frame_text[DEBUG_TEXT_STRING_LENGTH] = "";
 char sleep_ms_per_frame_text[DEBUG_TEXT_STRING_LENGTH] = "";
+char gl_calls_text[DEBUG_TEXT_STRING_LENGTH] = "";
+char tick_jitter_text[DEBUG_TEXT_STRING_LENGTH] = "";
+char stream_buffer_text[DEBUG_TEXT_STRING_LENGTH] = "";
+char frame_pacer_text[3][2 * DEBUG_TEXT_STRING_LENGTH];
+char input_latency_text[INPUT_LATENCY_STAGE_COUNT + 1][2 * DEBUG_TEXT_STRING_LENGTH];
 
 void display_debug_info_text(Master_Timer timer)
 {
@@ -66,7 +71,7 @@ void display_debug_info_text(Master_Timer timer)
     // TODO: remove this when changing the win32 stuff
     glm::vec3 debug_text_color = {1.0f, 1.0f, 1.0f};  // White color
     real32 debug_text_scale = 0.5f / FONT_SCALE_FACTOR;
-    real32 height_offset = Characters['H'].Size.y * debug_text_scale; 
+    real32 height_offset = global_font.characters['H'].Size.y * debug_text_scale; 
     real32 padding = LOGICAL_WIDTH * 0.02f;
     real32 x_pos = padding;
     real32 y_pos = LOGICAL_HEIGHT - (height_offset + padding);
@@ -210,6 +215,126 @@ void display_debug_info_text(Master_Timer timer)
         RenderText(*global_text_shader, sleep_ms_per_frame_text, x_pos, y_pos, debug_text_scale, debug_text_color);
         y_pos -= vertical_offset;
     }
+
+    {  // Frame Pacer, how close presented frames land to the refresh interval and what holding them there costs
+        Frame_Pacer* pacer = &global_frame_pacer;
+        if (global_debug_counter == 0)
+        {
+            snprintf(frame_pacer_text[0],
+                     sizeof(frame_pacer_text[0]),
+                     "Pacer: %.2f Hz, vsync %s, %.0f%% paced by sleeping, wake slack %.3f ms, spin %.3f ms/frame",
+                     pacer->refresh_rate__hz,
+                     pacer->is_vsync_on ? "on" : "off",
+                     pacer->last_paced_fraction * 100.0f,
+                     pacer->slack__ns / 1000000.0,
+                     pacer->last_spin__ms_per_frame);
+            snprintf(frame_pacer_text[1],
+                     sizeof(frame_pacer_text[1]),
+                     "  frame time error %.3f avg, %.3f max ms, CPU %.2f ms/frame (%.1f%% of a core)",
+                     pacer->last_frame_error_mean__ms,
+                     pacer->last_frame_error_max__ms,
+                     pacer->last_cpu__ms_per_frame,
+                     pacer->last_cpu_usage * 100.0f);
+            snprintf(frame_pacer_text[2],
+                     sizeof(frame_pacer_text[2]),
+                     "  late latch %s: input to swap %.2f ms, %.1f%% missed vsync, budget %.2f + margin %.2f ms",
+                     pacer->is_late_latching ? "on" : "off",
+                     pacer->last_latch_latency__ms,
+                     pacer->last_missed_fraction * 100.0f,
+                     pacer->budget__ms,
+                     pacer->margin__ms);
+        }
+
+        for (uint32 line = 0; line < 3; line++)
+        {
+            RenderText(*global_text_shader, frame_pacer_text[line], x_pos, y_pos, debug_text_scale, debug_text_color);
+            y_pos -= vertical_offset;
+        }
+    }
+
+    {  // Simulation Tick Jitter
+        if (global_debug_counter == 0)
+        {
+            snprintf(tick_jitter_text,
+                     sizeof(tick_jitter_text),
+                     "Tick jitter ms: %.03f avg, %.03f max (%s)",
+                     timer.tick_jitter_mean__ms,
+                     timer.tick_jitter_max__ms,
+                     SIMULATION_THREAD_ENABLED ? "sim thread" : "main thread");
+        }
+
+        RenderText(*global_text_shader, tick_jitter_text, x_pos, y_pos, debug_text_scale, debug_text_color);
+        y_pos -= vertical_offset;
+    }
+
+    {  // GL State Changes (redundant ones are filtered out by gl_state)
+        if (global_debug_counter == 0)
+        {
+            snprintf(gl_calls_text,
+                     sizeof(gl_calls_text),
+                     "GL state calls: %u issued, %u skipped",
+                     global_gl_state.last_frame_calls_issued,
+                     global_gl_state.last_frame_calls_skipped);
+        }
+
+        RenderText(*global_text_shader, gl_calls_text, x_pos, y_pos, debug_text_scale, debug_text_color);
+        y_pos -= vertical_offset;
+    }
+
+    {  // Stream Buffer Usage
+        if (global_debug_counter == 0)
+        {
+            snprintf(stream_buffer_text,
+                     sizeof(stream_buffer_text),
+                     "Stream buffer: %.1f KB/frame, %u fence waits",
+                     global_stream_buffer.last_frame_bytes_written / 1024.0f,
+                     global_stream_buffer.last_frame_fence_waits);
+        }
+
+        RenderText(*global_text_shader, stream_buffer_text, x_pos, y_pos, debug_text_scale, debug_text_color);
+        y_pos -= vertical_offset;
+    }
+
+    {  // Input Latency, from the SDL event to each stage, over the last INPUT_LATENCY_SAMPLE_COUNT presses
+        if (global_debug_counter == 0)
+        {
+            snprintf(input_latency_text[0],
+                     sizeof(input_latency_text[0]),
+                     "Input latency ms (vsync %s, %.1f fps target), buckets <1|<2|<4|<8|<16|<32|<64|<128|more",
+                     global_frame_pacer.is_vsync_on ? "on" : "off",
+                     TARGET_SCREEN_FPS);
+            for (uint32 stage = 0; stage < INPUT_LATENCY_STAGE_COUNT; stage++)
+            {
+                Input_Latency_Summary summary;
+                input_latency__summarize(&global_input_latency, stage, &summary);
+                const uint32* buckets = summary.buckets;
+                snprintf(input_latency_text[stage + 1],
+                         sizeof(input_latency_text[stage + 1]),
+                         "  %-7s %.2f avg, %.2f p50, %.2f p95, %.2f max (%u)  %u|%u|%u|%u|%u|%u|%u|%u|%u",
+                         INPUT_LATENCY_STAGE_NAMES[stage],
+                         summary.mean__ms,
+                         summary.p50__ms,
+                         summary.p95__ms,
+                         summary.max__ms,
+                         summary.count,
+                         buckets[0],
+                         buckets[1],
+                         buckets[2],
+                         buckets[3],
+                         buckets[4],
+                         buckets[5],
+                         buckets[6],
+                         buckets[7],
+                         buckets[8]);
+            }
+        }
+
+        for (uint32 line = 0; line < INPUT_LATENCY_STAGE_COUNT + 1; line++)
+        {
+            RenderText(*global_text_shader, input_latency_text[line], x_pos, y_pos, debug_text_scale, debug_text_color);
+            y_pos -= vertical_offset;
+        }
+    }
 }
 
 void display_timer_in_window_name(Master_Timer timer)
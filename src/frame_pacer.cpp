@@ -0,0 +1,366 @@
+// Frame pacer
+//
+// Holds presented frames to the display's refresh rate without burning a core. It sleeps on the OS's high resolution
+// timer until a little before the deadline, then spins only for the rest. The timer is clock_nanosleep on an absolute
+// CLOCK_MONOTONIC time on Linux, and a high resolution waitable timer on Windows. "A little" is the wake-up slack. It
+// starts at a millisecond and learns from how late the timer actually wakes us: it jumps up after a late wake-up and
+// slowly creeps back down.
+//
+// With vsync on, the swap already waits for the display. If it took us most of a refresh interval to get here, the
+// pacer stays out of the way. It only steps in when the swap returns right away (some compositors, a hidden window),
+// so the loop doesn't spin at thousands of frames a second.
+//
+// Late latching (LATE_LATCH_ENABLED, --late-latch) turns that around. Normally a frame starts right after the last
+// swap, and the finished frame can sit waiting for most of a refresh interval before it's shown. A late latching frame
+// sleeps first, and only starts (input, updates, render) when just enough time is left to make the next vsync.
+// "Enough" is the frame budget plus a safety margin. The budget is the worst input + update + render-writing time of
+// the last FRAME_PACER_COST_WINDOW frames, plus their worst swap (not counting the time a swap spent waiting for its
+// vsync). The margin doubles whenever a frame misses its vsync and slowly shrinks while they don't. The next vsync is
+// predicted from the last swap, which with vsync on returns right at one.
+//
+// Every second it works out how far frame times land from the refresh interval, how much CPU time the whole process
+// used per frame, and how long frames took from input to the end of their swap against how many missed their vsync, for
+// the debug overlay.
+//
+// Usage:
+//     frame_pacer__init(&global_frame_pacer, is_vsync_on);
+//     frame_pacer__read_refresh_rate(&global_frame_pacer, window);  // Again whenever the window changes display
+//     loop:
+//         ... frame_start = SDL_GetPerformanceCounter(), work, render, swap ...
+//         frame_pacer__presented(&global_frame_pacer, frame_start, SDL_GetPerformanceCounter());  // Right after swap
+//         frame_pacer__wait(&global_frame_pacer, frame_start);           // Or, late latching:
+//         frame_pacer__wait_to_latch(&global_frame_pacer, &master_timer);
+//         frame_pacer__end_frame(&global_frame_pacer, frame_start, SDL_GetPerformanceCounter());
+
+#if defined(_WIN32)
+#if !defined(WIN32_LEAN_AND_MEAN)
+#define WIN32_LEAN_AND_MEAN  // Keeps the old winsock.h out, netplay.cpp wants winsock2.h
+#endif
+#include <windows.h>
+#if !defined(CREATE_WAITABLE_TIMER_HIGH_RESOLUTION)
+#define CREATE_WAITABLE_TIMER_HIGH_RESOLUTION 0x00000002  // Windows 10 1803 and up, older SDKs don't have it
+#endif
+#else
+#include <errno.h>
+#include <time.h>
+#endif
+
+#define FRAME_PACER_FALLBACK_REFRESH_RATE 60.0f  // When the display doesn't say
+#define FRAME_PACER_MIN_SLACK__NS 50000.0
+#define FRAME_PACER_MAX_SLACK__NS 2000000.0
+#define FRAME_PACER_SLACK_DECAY 0.995     // Per wake-up, so a one-off late wake-up is forgotten after a few seconds
+#define FRAME_PACER_SLACK_MARGIN 1.25     // On top of the latest late wake-up
+#define FRAME_PACER_VSYNC_BLOCKED 0.75f   // Of a refresh interval, took at least this long means the swap waited
+#define FRAME_PACER_COST_WINDOW 32        // Frames the late latching budget is taken over
+#define FRAME_PACER_MIN_MARGIN__MS 0.25
+#define FRAME_PACER_MARGIN_DECAY 0.998    // Per frame that makes its vsync, about halves in 6 seconds at 60 Hz
+#define FRAME_PACER_MISSED 0.5            // Of a refresh interval, a swap ending this long after its vsync missed it
+
+struct Frame_Pacer
+{
+    real32 refresh_rate__hz;
+    bool32 is_vsync_on;
+    real64 slack__ns;  // How long before the deadline to wake up and start spinning
+#if defined(_WIN32)
+    HANDLE timer;
+#endif
+
+    // Late latching
+    bool32 is_late_latching;
+    real32 work__ms[FRAME_PACER_COST_WINDOW];  // Input + updates + writing the render, per frame
+    real32 swap__ms[FRAME_PACER_COST_WINDOW];
+    uint32 cost_next;
+    real64 budget__ms;  // What the next frame is expected to need, margin not included
+    real64 margin__ms;
+    Uint64 last_swap_counter;    // When the last swap returned, where the next vsync is predicted from
+    Uint64 target_vsync_counter;  // The vsync the last frame started for should make, 0 when there isn't one yet
+
+    // Counters for the current second
+    Uint64 window_start_counter;
+    real64 window_start_cpu__seconds;
+    uint32 frame_count;
+    uint32 paced_frame_count;
+    real64 frame_error_sum__ms;
+    real64 frame_error_max__ms;
+    real64 spin_sum__ms;
+    uint32 presented_count;
+    uint32 missed_count;
+    real64 latch_latency_sum__ms;
+
+    // Results for the last full second, for the debug overlay
+    real32 last_frame_error_mean__ms;  // How far frame times land from the refresh interval
+    real32 last_frame_error_max__ms;
+    real32 last_cpu__ms_per_frame;  // Whole process, every thread
+    real32 last_cpu_usage;          // In cores
+    real32 last_spin__ms_per_frame;
+    real32 last_paced_fraction;  // Of frames the pacer had to wait on, rather than the swap
+    real32 last_latch_latency__ms;  // From the start of a frame (where input is read) to the end of its swap
+    real32 last_missed_fraction;    // Of presented frames, that landed a vsync later than they should have
+};
+
+Frame_Pacer global_frame_pacer;
+
+// Total CPU time the process has used, over all its threads
+local_internal real64 frame_pacer__process_cpu__seconds()
+{
+#if defined(_WIN32)
+    FILETIME creation_time, exit_time, kernel_time, user_time;
+    if (!GetProcessTimes(GetCurrentProcess(), &creation_time, &exit_time, &kernel_time, &user_time))
+    {
+        return 0.0;
+    }
+    ULARGE_INTEGER kernel, user;
+    kernel.LowPart = kernel_time.dwLowDateTime;
+    kernel.HighPart = kernel_time.dwHighDateTime;
+    user.LowPart = user_time.dwLowDateTime;
+    user.HighPart = user_time.dwHighDateTime;
+    return (real64)(kernel.QuadPart + user.QuadPart) * 100e-9;  // 100 ns units
+#else
+    timespec time = {};
+    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &time);
+    return (real64)time.tv_sec + (real64)time.tv_nsec * 1e-9;
+#endif
+}
+
+local_internal Uint64 frame_pacer__counter_to__ns(Uint64 counter, Uint64 frequency)
+{
+    return (Uint64)((real64)counter * (real64)SDL_NS_PER_SECOND / (real64)frequency);
+}
+
+// Blocks for about duration__ns, without spinning
+local_internal void frame_pacer__sleep(Frame_Pacer* pacer, Uint64 duration__ns)
+{
+#if defined(_WIN32)
+    if (pacer->timer)
+    {
+        LARGE_INTEGER due_time;
+        due_time.QuadPart = -(LONGLONG)(duration__ns / 100);  // Negative is relative, in 100 ns units
+        if (SetWaitableTimer(pacer->timer, &due_time, 0, NULL, NULL, FALSE))
+        {
+            WaitForSingleObject(pacer->timer, INFINITE);
+            return;
+        }
+    }
+    SDL_DelayNS(duration__ns);
+#elif defined(__linux__)
+    // Absolute, so being woken up by a signal and going back to sleep doesn't push the wake-up out
+    timespec wake_time = {};
+    clock_gettime(CLOCK_MONOTONIC, &wake_time);
+    Uint64 wake__ns = (Uint64)wake_time.tv_nsec + duration__ns;
+    wake_time.tv_sec += (time_t)(wake__ns / SDL_NS_PER_SECOND);
+    wake_time.tv_nsec = (long)(wake__ns % SDL_NS_PER_SECOND);
+    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &wake_time, NULL) == EINTR)
+    {
+    }
+#else
+    SDL_DelayNS(duration__ns);
+#endif
+}
+
+// Sleeps until the slack before deadline, then spins the rest, both on the performance counter
+local_internal void frame_pacer__sleep_until(Frame_Pacer* pacer, Uint64 deadline, Uint64 now)
+{
+    Uint64 frequency = SDL_GetPerformanceFrequency();
+    Uint64 slack = (Uint64)(pacer->slack__ns * (real64)frequency / SDL_NS_PER_SECOND);
+    if (deadline > now && deadline - now > slack)
+    {
+        Uint64 wake = deadline - slack;
+        frame_pacer__sleep(pacer, frame_pacer__counter_to__ns(wake - now, frequency));
+
+        // Learn how late the timer tends to be
+        Uint64 woke = SDL_GetPerformanceCounter();
+        real64 late__ns = woke > wake ? (real64)frame_pacer__counter_to__ns(woke - wake, frequency) : 0.0;
+        pacer->slack__ns = SDL_max(pacer->slack__ns * FRAME_PACER_SLACK_DECAY, late__ns * FRAME_PACER_SLACK_MARGIN);
+        pacer->slack__ns = SDL_clamp(pacer->slack__ns, FRAME_PACER_MIN_SLACK__NS, FRAME_PACER_MAX_SLACK__NS);
+    }
+
+    Uint64 spin_start = SDL_GetPerformanceCounter();
+    while (SDL_GetPerformanceCounter() < deadline)
+    {
+        // The last bit the timer can't be trusted with
+    }
+    pacer->spin_sum__ms += 1000.0 * (real64)(SDL_GetPerformanceCounter() - spin_start) / (real64)frequency;
+}
+
+bool32 frame_pacer__init(Frame_Pacer* pacer, bool32 is_vsync_on)
+{
+    pacer->is_vsync_on = is_vsync_on;
+    pacer->refresh_rate__hz = FRAME_PACER_FALLBACK_REFRESH_RATE;
+    pacer->slack__ns = 1000000.0;
+    pacer->margin__ms = 1.0;
+    pacer->window_start_counter = SDL_GetPerformanceCounter();
+    pacer->window_start_cpu__seconds = frame_pacer__process_cpu__seconds();
+#if defined(_WIN32)
+    pacer->timer = CreateWaitableTimerExW(NULL, NULL, CREATE_WAITABLE_TIMER_HIGH_RESOLUTION, TIMER_ALL_ACCESS);
+    if (!pacer->timer)
+    {
+        // Older Windows, the regular timer is only as good as timeBeginPeriod makes it, and the slack will grow to suit
+        pacer->timer = CreateWaitableTimerExW(NULL, NULL, 0, TIMER_ALL_ACCESS);
+    }
+    if (!pacer->timer)
+    {
+        fprintf(stderr, "ERROR::FRAME_PACER: Couldn't create a waitable timer (%lu)\n", GetLastError());
+        return 0;
+    }
+#endif
+    return 1;
+}
+
+// Sets the pace (and TARGET_SCREEN_FPS) from the display the window is on
+void frame_pacer__read_refresh_rate(Frame_Pacer* pacer, SDL_Window* window)
+{
+    SDL_DisplayID display = SDL_GetDisplayForWindow(window);
+    const SDL_DisplayMode* mode = display ? SDL_GetCurrentDisplayMode(display) : 0;
+    pacer->refresh_rate__hz = mode && mode->refresh_rate > 0 ? mode->refresh_rate : FRAME_PACER_FALLBACK_REFRESH_RATE;
+
+    TARGET_SCREEN_FPS = pacer->refresh_rate__hz;
+    TARGET_TIME_PER_FRAME_S = 1.f / TARGET_SCREEN_FPS;
+    TARGET_TIME_PER_FRAME_MS = TARGET_TIME_PER_FRAME_S * 1000.0f;
+}
+
+// Waits out the rest of the refresh interval that started at frame_start_counter, unless the swap already did
+void frame_pacer__wait(Frame_Pacer* pacer, Uint64 frame_start_counter)
+{
+    Uint64 frequency = SDL_GetPerformanceFrequency();
+    Uint64 period = (Uint64)((real64)frequency / pacer->refresh_rate__hz);
+    Uint64 deadline = frame_start_counter + period;
+    Uint64 now = SDL_GetPerformanceCounter();
+
+    if (pacer->is_vsync_on && now - frame_start_counter >= (Uint64)(period * FRAME_PACER_VSYNC_BLOCKED))
+    {
+        return;  // The swap waited for the display, we're already on its beat
+    }
+    pacer->paced_frame_count++;
+    frame_pacer__sleep_until(pacer, deadline, now);
+}
+
+// Right after the swap of a frame that started at frame_start_counter returned at swap_end_counter
+void frame_pacer__presented(Frame_Pacer* pacer, Uint64 frame_start_counter, Uint64 swap_end_counter)
+{
+    Uint64 frequency = SDL_GetPerformanceFrequency();
+    Uint64 period = (Uint64)((real64)frequency / pacer->refresh_rate__hz);
+
+    // Without late latching the frame should make the vsync after the one the last frame made
+    if (!pacer->is_late_latching && pacer->last_swap_counter)
+    {
+        pacer->target_vsync_counter = pacer->last_swap_counter + period;
+    }
+
+    // A frame that started after its vsync was waiting for something to change, not late
+    if (pacer->target_vsync_counter && frame_start_counter < pacer->target_vsync_counter)
+    {
+        pacer->presented_count++;
+        pacer->latch_latency_sum__ms += 1000.0 * (real64)(swap_end_counter - frame_start_counter) / (real64)frequency;
+        if (swap_end_counter > pacer->target_vsync_counter + (Uint64)(period * FRAME_PACER_MISSED))
+        {
+            pacer->missed_count++;
+            if (pacer->is_late_latching)
+            {
+                real64 half_period__ms = 500.0 / pacer->refresh_rate__hz;
+                pacer->margin__ms = SDL_min(pacer->margin__ms * 2.0, half_period__ms);
+            }
+        }
+        else if (pacer->is_late_latching)
+        {
+            pacer->margin__ms = SDL_max(pacer->margin__ms * FRAME_PACER_MARGIN_DECAY, FRAME_PACER_MIN_MARGIN__MS);
+        }
+    }
+
+    pacer->last_swap_counter = swap_end_counter;
+}
+
+// Late latching instead of frame_pacer__wait: sleeps until the next frame has only its budget and margin left before
+// the next predicted vsync. timer has the phases of the frame that was just presented.
+void frame_pacer__wait_to_latch(Frame_Pacer* pacer, const Master_Timer* timer)
+{
+    Uint64 frequency = SDL_GetPerformanceFrequency();
+    Uint64 period = (Uint64)((real64)frequency / pacer->refresh_rate__hz);
+    {  // What frames cost lately. A swap that went in before its vsync waited for it, and that part isn't a cost.
+        real64 swap__ms = (real64)timer->time_elapsed_for_render__seconds * 1000.0;
+        Uint64 swap_start = pacer->last_swap_counter - (Uint64)(swap__ms * (real64)frequency / 1000.0);
+        Uint64 vsync = 0;
+        if (pacer->is_vsync_on)
+        {  // The swap returned at a vsync, a missed frame's is a whole number of intervals after its target
+            vsync = pacer->last_swap_counter;
+            Uint64 target = pacer->target_vsync_counter;
+            if (target && target <= pacer->last_swap_counter)
+            {
+                vsync = target + (pacer->last_swap_counter - target) / period * period;
+            }
+        }
+        if (vsync > swap_start)
+        {
+            swap__ms -= 1000.0 * (real64)(vsync - swap_start) / (real64)frequency;
+        }
+
+        pacer->work__ms[pacer->cost_next] =
+            (timer->time_elapsed_for_work__seconds + timer->time_elapsed_for_writing_buffer__seconds) * 1000.0f;
+        pacer->swap__ms[pacer->cost_next] = (real32)swap__ms;
+        pacer->cost_next = (pacer->cost_next + 1) % FRAME_PACER_COST_WINDOW;
+
+        real32 max_work__ms = 0.0f;
+        real32 max_swap__ms = 0.0f;
+        for (uint32 i = 0; i < FRAME_PACER_COST_WINDOW; i++)
+        {
+            max_work__ms = SDL_max(max_work__ms, pacer->work__ms[i]);
+            max_swap__ms = SDL_max(max_swap__ms, pacer->swap__ms[i]);
+        }
+        pacer->budget__ms = (real64)(max_work__ms + max_swap__ms);
+    }
+
+    Uint64 lead = (Uint64)((pacer->budget__ms + pacer->margin__ms) * (real64)frequency / 1000.0);
+    lead = SDL_min(lead, period);  // Frames that need a whole interval start right away, same as without late latching
+    Uint64 now = SDL_GetPerformanceCounter();
+
+    // The first vsync after the last swap that there's still time to make
+    Uint64 vsync = pacer->last_swap_counter ? pacer->last_swap_counter + period : now + period;
+    if (vsync < now + lead)
+    {
+        vsync += ((now + lead - vsync) / period + 1) * period;
+    }
+    pacer->target_vsync_counter = vsync;
+
+    frame_pacer__sleep_until(pacer, vsync - lead, now);
+    pacer->paced_frame_count++;
+}
+
+// Bookkeeping for a presented frame that went from frame_start_counter to frame_end_counter, sleep included
+void frame_pacer__end_frame(Frame_Pacer* pacer, Uint64 frame_start_counter, Uint64 frame_end_counter)
+{
+    Uint64 frequency = SDL_GetPerformanceFrequency();
+    real64 frame__ms = 1000.0 * (real64)(frame_end_counter - frame_start_counter) / (real64)frequency;
+    real64 error__ms = SDL_fabs(frame__ms - 1000.0 / pacer->refresh_rate__hz);
+    pacer->frame_error_sum__ms += error__ms;
+    pacer->frame_error_max__ms = SDL_max(pacer->frame_error_max__ms, error__ms);
+    pacer->frame_count++;
+
+    if (frame_end_counter - pacer->window_start_counter >= frequency)
+    {
+        real64 cpu__seconds = frame_pacer__process_cpu__seconds();
+        real64 window__seconds = (real64)(frame_end_counter - pacer->window_start_counter) / (real64)frequency;
+        real64 frame_count = (real64)pacer->frame_count;
+        real64 cpu_used__seconds = cpu__seconds - pacer->window_start_cpu__seconds;
+
+        pacer->last_frame_error_mean__ms = (real32)(pacer->frame_error_sum__ms / frame_count);
+        pacer->last_frame_error_max__ms = (real32)pacer->frame_error_max__ms;
+        pacer->last_cpu__ms_per_frame = (real32)(cpu_used__seconds * 1000.0 / frame_count);
+        pacer->last_cpu_usage = (real32)(cpu_used__seconds / window__seconds);
+        pacer->last_spin__ms_per_frame = (real32)(pacer->spin_sum__ms / frame_count);
+        pacer->last_paced_fraction = (real32)(pacer->paced_frame_count / frame_count);
+        pacer->last_latch_latency__ms =
+            pacer->presented_count ? (real32)(pacer->latch_latency_sum__ms / pacer->presented_count) : 0.0f;
+        pacer->last_missed_fraction =
+            pacer->presented_count ? (real32)pacer->missed_count / (real32)pacer->presented_count : 0.0f;
+
+        pacer->window_start_counter = frame_end_counter;
+        pacer->window_start_cpu__seconds = cpu__seconds;
+        pacer->frame_count = 0;
+        pacer->paced_frame_count = 0;
+        pacer->frame_error_sum__ms = 0;
+        pacer->frame_error_max__ms = 0;
+        pacer->spin_sum__ms = 0;
+        pacer->presented_count = 0;
+        pacer->missed_count = 0;
+        pacer->latch_latency_sum__ms = 0;
+    }
+}
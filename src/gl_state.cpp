@@ -0,0 +1,171 @@
+#include "gl_state.h"
+
+GL_State global_gl_state;
+
+// Any value GL would never hand out, so the first real call always goes through
+#define GL_STATE_UNKNOWN 0xFFFFFFFF
+
+void gl_state__invalidate()
+{
+    GL_State* state = &global_gl_state;
+    state->program = GL_STATE_UNKNOWN;
+    state->vertex_array = GL_STATE_UNKNOWN;
+    state->active_texture_unit = GL_STATE_UNKNOWN;
+    for (uint32 i = 0; i < GL_STATE_MAX_TEXTURE_UNITS; i++)
+    {
+        state->textures_2d[i] = GL_STATE_UNKNOWN;
+    }
+    state->blend_enabled = -1;
+    state->blend_src = GL_STATE_UNKNOWN;
+    state->blend_dst = GL_STATE_UNKNOWN;
+    state->cull_face_enabled = -1;
+    state->depth_test_enabled = -1;
+    state->viewport[0] = state->viewport[1] = state->viewport[2] = state->viewport[3] = -1;
+}
+
+void gl_state__begin_frame()
+{
+    GL_State* state = &global_gl_state;
+    state->last_frame_calls_issued = state->calls_issued;
+    state->last_frame_calls_skipped = state->calls_skipped;
+    state->calls_issued = 0;
+    state->calls_skipped = 0;
+}
+
+void gl_state__use_program(GLuint program)
+{
+    GL_State* state = &global_gl_state;
+    if (state->program == program)
+    {
+        state->calls_skipped++;
+        return;
+    }
+    glUseProgram(program);
+    state->program = program;
+    state->calls_issued++;
+}
+
+void gl_state__bind_vertex_array(GLuint vertex_array)
+{
+    GL_State* state = &global_gl_state;
+    if (state->vertex_array == vertex_array)
+    {
+        state->calls_skipped++;
+        return;
+    }
+    glBindVertexArray(vertex_array);
+    state->vertex_array = vertex_array;
+    state->calls_issued++;
+}
+
+void gl_state__bind_texture_2d(GLuint unit, GLuint texture)
+{
+    GL_State* state = &global_gl_state;
+    SDL_assert(unit < GL_STATE_MAX_TEXTURE_UNITS);
+
+    if (state->textures_2d[unit] == texture)
+    {
+        state->calls_skipped++;
+        return;
+    }
+
+    if (state->active_texture_unit != unit)
+    {
+        glActiveTexture(GL_TEXTURE0 + unit);
+        state->active_texture_unit = unit;
+        state->calls_issued++;
+    }
+
+    glBindTexture(GL_TEXTURE_2D, texture);
+    state->textures_2d[unit] = texture;
+    state->calls_issued++;
+}
+
+void gl_state__set_blend(bool32 enabled, GLenum src, GLenum dst)
+{
+    GL_State* state = &global_gl_state;
+    enabled = enabled ? 1 : 0;
+
+    if (state->blend_enabled != enabled)
+    {
+        if (enabled)
+        {
+            glEnable(GL_BLEND);
+        }
+        else
+        {
+            glDisable(GL_BLEND);
+        }
+        state->blend_enabled = enabled;
+        state->calls_issued++;
+    }
+    else
+    {
+        state->calls_skipped++;
+    }
+
+    if (enabled)
+    {
+        if (state->blend_src != src || state->blend_dst != dst)
+        {
+            glBlendFunc(src, dst);
+            state->blend_src = src;
+            state->blend_dst = dst;
+            state->calls_issued++;
+        }
+        else
+        {
+            state->calls_skipped++;
+        }
+    }
+}
+
+local_internal void gl_state__set_capability(GLenum capability, int32* shadow, bool32 enabled)
+{
+    GL_State* state = &global_gl_state;
+    enabled = enabled ? 1 : 0;
+
+    if (*shadow == enabled)
+    {
+        state->calls_skipped++;
+        return;
+    }
+
+    if (enabled)
+    {
+        glEnable(capability);
+    }
+    else
+    {
+        glDisable(capability);
+    }
+    *shadow = enabled;
+    state->calls_issued++;
+}
+
+void gl_state__set_cull_face(bool32 enabled)
+{
+    gl_state__set_capability(GL_CULL_FACE, &global_gl_state.cull_face_enabled, enabled);
+}
+
+void gl_state__set_depth_test(bool32 enabled)
+{
+    gl_state__set_capability(GL_DEPTH_TEST, &global_gl_state.depth_test_enabled, enabled);
+}
+
+void gl_state__set_viewport(GLint x, GLint y, GLsizei width, GLsizei height)
+{
+    GL_State* state = &global_gl_state;
+    GLint* viewport = state->viewport;
+    if (viewport[0] == x && viewport[1] == y && viewport[2] == width && viewport[3] == height)
+    {
+        state->calls_skipped++;
+        return;
+    }
+    glViewport(x, y, width, height);
+    viewport[0] = x;
+    viewport[1] = y;
+    viewport[2] = width;
+    viewport[3] = height;
+    state->calls_issued++;
+}
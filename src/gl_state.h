@@ -0,0 +1,55 @@
+#ifndef GL_STATE_H
+#define GL_STATE_H
+
+#include <glad/glad.h>
+
+#include "common.h"
+
+// Shadows the bits of OpenGL state we change every frame so redundant calls never reach the driver.
+// NOTE: Anything that changes this state must go through these functions, or call gl_state__invalidate after
+// touching GL directly, otherwise the shadow copy goes stale.
+
+#define GL_STATE_MAX_TEXTURE_UNITS 8
+
+struct GL_State
+{
+    GLuint program;
+    GLuint vertex_array;
+    GLuint active_texture_unit;  // 0 based (GL_TEXTURE0 + unit)
+    GLuint textures_2d[GL_STATE_MAX_TEXTURE_UNITS];
+
+    int32 blend_enabled;  // -1 when unknown
+    GLenum blend_src;
+    GLenum blend_dst;
+    int32 cull_face_enabled;
+    int32 depth_test_enabled;
+
+    GLint viewport[4];
+
+    // Counters for the current frame, and the totals from the last one for the debug overlay
+    uint32 calls_issued;
+    uint32 calls_skipped;
+    uint32 last_frame_calls_issued;
+    uint32 last_frame_calls_skipped;
+};
+
+// Forget everything we know so the next call of each kind goes to the driver
+void gl_state__invalidate();
+
+void gl_state__begin_frame();
+
+void gl_state__use_program(GLuint program);
+
+void gl_state__bind_vertex_array(GLuint vertex_array);
+
+void gl_state__bind_texture_2d(GLuint unit, GLuint texture);
+
+void gl_state__set_blend(bool32 enabled, GLenum src = GL_SRC_ALPHA, GLenum dst = GL_ONE_MINUS_SRC_ALPHA);
+
+void gl_state__set_cull_face(bool32 enabled);
+
+void gl_state__set_depth_test(bool32 enabled);
+
+void gl_state__set_viewport(GLint x, GLint y, GLsizei width, GLsizei height);
+
+#endif  // GL_STATE_H
@@ -0,0 +1,1094 @@
+// Headless runner
+//
+// Plays games of snake_simulation.cpp back to back as fast as the CPU allows, with no window, GL or audio, and reports
+// how many simulation ticks per second it got through. A simple greedy bot does the steering: head for the egg, never
+// step straight into a wall or the body. With --autopilot the real autopilot (autopilot.cpp) steers instead, and the
+// planner's time per jump gets reported too. With --mcts the Monte Carlo tree search player (mcts.cpp) steers,
+// searching --budget-ms per jump on a pool of --threads, and reports its rollouts per second and tree size. Builds with
+// nothing but a C++11 compiler (see build-headless.sh).
+//
+// --batch steps N games at once in a Batch_Env (batch_env.cpp) instead, split over --threads, for --ticks ticks.
+// --verify plays games in a Batch_Env and in Snake_Simulations side by side and fails if they ever disagree.
+// --bench-snapshots plays a game (with the autopilot if the board has a cycle, so the snake gets long) and snapshots,
+// diffs and restores it every tick, timing each and checking the restored game is the same one.
+// --netplay-loopback plays versus (versus_simulation.cpp) between two rollback netplay sessions (netplay.cpp) over an
+// in-process link with --latency-ms, --jitter-ms and --loss, for --ticks frames, and reports how often they rolled back
+// and how much re-simulating that cost. Both sessions have to end up agreeing with the same game played offline.
+// --arena runs N AI snakes on one board (arena_simulation.cpp, use a big --grid) for --ticks ticks on --threads, and
+// reports the time per jump against the game's 100 ms between jumps. The same game on one thread has to end up
+// exactly the same.
+// --bench-jobs measures the job system (thread_pool.cpp): the cost of scheduling a task, of a dependency hand-off, and
+// how a parallel_for scales from 1 thread up to --threads (all the cores by default).
+//
+// Usage:
+//     headless [--games N] [--seed S] [--grid X Y] [--max-ticks T] [--autopilot] [--record-replay <path>]
+//     headless --mcts [--budget-ms B] [--threads T] [--games N] [--seed S] [--grid X Y]
+//     headless --batch N [--threads T] [--ticks T] [--seed S] [--grid X Y]
+//     headless --verify [--seed S] [--grid X Y]
+//     headless --bench-snapshots [--seed S] [--grid X Y]
+//     headless --bench-jobs [--threads T]
+//     headless --arena N [--eggs E] [--threads T] [--ticks T] [--seed S] [--grid X Y]
+//     headless --netplay-loopback [--latency-ms L] [--jitter-ms J] [--loss P] [--ticks T] [--seed S] [--grid X Y]
+//     headless --play-replay <path>
+
+// clang-format off
+#include "common.h"
+
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+#include "memory_arena.cpp"
+#include "thread_pool.cpp"
+#include "replay.cpp"
+#include "snake_simulation.cpp"
+#include "snapshot.cpp"
+#include "batch_env.cpp"
+#include "autopilot.cpp"
+#include "mcts.cpp"
+#include "versus_simulation.cpp"
+#include "netplay.cpp"
+#include "arena_simulation.cpp"
+// clang-format on
+
+#define HEADLESS_DELTA_TIME__SECONDS (1.f / 100.f)  // Same fixed step as the game (SIMULATION_DELTA_TIME_S)
+
+struct Headless__Options
+{
+    uint32 game_count;
+    uint32 seed;
+    uint32 x_grids;
+    uint32 y_grids;
+    uint32 max_ticks_per_game;  // Stops a game that's going in circles forever
+
+    uint32 batch_game_count;  // Run the batch environment with this many games instead, if set
+    uint32 batch_tick_count;
+    uint32 thread_count;
+    bool32 should_verify;
+    bool32 should_bench_jobs;
+    bool32 should_bench_snapshots;
+    bool32 should_run_netplay_loopback;
+    real32 latency__ms;  // Netplay loopback link, one way
+    real32 jitter__ms;
+    real32 loss;
+    uint32 arena_snake_count;  // Run the arena with this many snakes instead, if set
+    uint32 arena_egg_count;    // Half the snakes if not set
+    bool32 is_autopilot_enabled;
+    bool32 is_mcts_enabled;
+    real32 move_budget__ms;
+};
+
+// Greedy: the first open direction that gets closer to the egg, otherwise any open one, otherwise keep going.
+// is_blocked is per direction, in the order north, east, south, west.
+local_internal Direction headless__greedy_direction(
+    int32 head_x, int32 head_y, int32 egg_x, int32 egg_y, Direction current_direction, const bool32* is_blocked)
+{
+    const Direction directions[] = {DIRECTION_NORTH, DIRECTION_EAST, DIRECTION_SOUTH, DIRECTION_WEST};
+    const int32 step_x[] = {0, 1, 0, -1};
+    const int32 step_y[] = {1, 0, -1, 0};
+
+    int32 distance = abs(egg_x - head_x) + abs(egg_y - head_y);
+    Direction fallback = current_direction;
+    bool32 has_fallback = 0;
+    for (uint32 i = 0; i < 4; i++)
+    {
+        if (is_blocked[i])
+        {
+            continue;
+        }
+        if (abs(egg_x - (head_x + step_x[i])) + abs(egg_y - (head_y + step_y[i])) < distance)
+        {
+            return directions[i];
+        }
+        if (!has_fallback)
+        {
+            fallback = directions[i];
+            has_fallback = 1;
+        }
+    }
+    return fallback;
+}
+
+local_internal Direction headless__choose_direction(Snake_Simulation* sim)
+{
+    const int32 step_x[] = {0, 1, 0, -1};
+    const int32 step_y[] = {1, 0, -1, 0};
+
+    bool32 is_blocked[4];
+    for (uint32 i = 0; i < 4; i++)
+    {
+        int32 x = sim->pos_x + step_x[i];
+        int32 y = sim->pos_y + step_y[i];
+        is_blocked[i] = x < 0 || x >= (int32)sim->x_grids || y < 0 || y >= (int32)sim->y_grids ||
+                        snake_simulation__is_cell_occupied(sim, x, y);
+    }
+    return headless__greedy_direction(
+        sim->pos_x, sim->pos_y, sim->blip_pos_x, sim->blip_pos_y, sim->current_direction, is_blocked);
+}
+
+local_internal Direction headless__choose_batch_direction(Batch_Env* env, uint32 game)
+{
+    const int32 step_x[] = {0, 1, 0, -1};
+    const int32 step_y[] = {1, 0, -1, 0};
+
+    const uint64* occupied_cells = env->occupied_cells + (size_t)game * env->word_count;
+    int32 head_x = env->head_x[game];
+    int32 head_y = env->head_y[game];
+
+    bool32 is_blocked[4];
+    for (uint32 i = 0; i < 4; i++)
+    {
+        int32 x = head_x + step_x[i];
+        int32 y = head_y + step_y[i];
+        is_blocked[i] = x < 0 || x >= (int32)env->x_grids || y < 0 || y >= (int32)env->y_grids ||
+                        batch_env__is_cell_occupied(occupied_cells, (uint32)y * env->x_grids + (uint32)x);
+    }
+    return headless__greedy_direction(
+        head_x, head_y, env->egg_x[game], env->egg_y[game], (Direction)env->direction[game], is_blocked);
+}
+
+local_internal int32 headless__run_games(Headless__Options* options)
+{
+    Snake_Simulation sim = {};
+    uint32 seed = options->seed;
+
+    Autopilot autopilot = {};
+    if (options->is_autopilot_enabled && !autopilot__init(&autopilot, options->x_grids, options->y_grids))
+    {
+        return EXIT_FAILURE;
+    }
+
+    Thread_Pool pool = {};
+    Mcts_Player mcts_player = {};
+    if (options->is_mcts_enabled)
+    {
+        if (options->x_grids * options->y_grids > MCTS_MAX_CELLS)
+        {
+            fprintf(stderr, "ERROR::HEADLESS: MCTS only handles boards up to %u cells\n", MCTS_MAX_CELLS);
+            return EXIT_FAILURE;
+        }
+        uint32 thread_count = options->thread_count ? options->thread_count : std::thread::hardware_concurrency();
+        thread_count = thread_count ? thread_count : 1;
+        thread_pool__start(&pool, thread_count - 1);  // This thread searches too while it waits
+        mcts__init(&mcts_player, &pool, options->move_budget__ms);
+    }
+
+    uint64 total_ticks = 0;
+    uint64 total_moves = 0;
+    uint64 total_score = 0;
+    uint32 best_score = 0;
+    uint32 timed_out_games = 0;
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+    for (uint32 game = 0; game < options->game_count; game++)
+    {
+        if (!snake_simulation__reset(&sim, options->x_grids, options->y_grids, seed))
+        {
+            return EXIT_FAILURE;
+        }
+        replay_recorder__begin(
+            &global_replay_recorder, seed, options->x_grids, options->y_grids, HEADLESS_DELTA_TIME__SECONDS);
+        snake_rng__next(&seed);
+
+        while (!sim.game_over && sim.ticks < options->max_ticks_per_game)
+        {
+            // Only decide when a jump is due, the queue would otherwise fill up with stale choices
+            if (snake_simulation__jumps_next_step(&sim, HEADLESS_DELTA_TIME__SECONDS))
+            {
+                Direction direction = options->is_mcts_enabled        ? mcts__choose_direction(&mcts_player, &sim)
+                                      : options->is_autopilot_enabled ? autopilot__choose_direction(&autopilot, &sim)
+                                                                      : headless__choose_direction(&sim);
+                snake_simulation__queue_input(&sim, direction);
+                replay_recorder__add_input(&global_replay_recorder, sim.ticks, (uint8)direction);
+            }
+            total_moves += snake_simulation__step(&sim, HEADLESS_DELTA_TIME__SECONDS);
+        }
+        replay_recorder__finish(&global_replay_recorder, sim.ticks, snake_simulation__hash(&sim));
+
+        total_ticks += sim.ticks;
+        total_score += sim.next_snake_part_index;
+        best_score = sim.next_snake_part_index > best_score ? sim.next_snake_part_index : best_score;
+        timed_out_games += !sim.game_over;
+    }
+
+    real64 seconds = std::chrono::duration<real64>(std::chrono::steady_clock::now() - start).count();
+    if (seconds <= 0)
+    {
+        seconds = 1e-9;
+    }
+
+    printf("%u games on %ux%u (seed %u): %llu ticks, %llu moves in %.3f ms\n",
+           options->game_count,
+           options->x_grids,
+           options->y_grids,
+           options->seed,
+           (unsigned long long)total_ticks,
+           (unsigned long long)total_moves,
+           seconds * 1000.0);
+    printf("%.0f ticks/s, %.0f moves/s, mean score %.1f, best score %u, %u hit the tick limit\n",
+           total_ticks / seconds,
+           total_moves / seconds,
+           options->game_count ? (real64)total_score / options->game_count : 0.0,
+           best_score,
+           timed_out_games);
+    if (options->is_autopilot_enabled)
+    {
+        // The fastest the snake ever goes is one jump per tick
+        printf("Autopilot planning: %.3f us per jump on average, %.3f us at worst (%.0f us per tick available)\n",
+               autopilot__plan_mean__us(&autopilot),
+               autopilot.plan_max__us,
+               HEADLESS_DELTA_TIME__SECONDS * 1000000.0f);
+        autopilot__free(&autopilot);
+    }
+    if (options->is_mcts_enabled)
+    {
+        printf("MCTS: %u threads, %.1f ms per jump, %.0f rollouts/s, %u nodes in the last search\n",
+               pool.queue_count,
+               options->move_budget__ms,
+               mcts_player.total_search__seconds > 0 ? mcts_player.total_rollouts / mcts_player.total_search__seconds
+                                                     : 0.0,
+               mcts_player.last_tree_size);
+        thread_pool__stop(&pool);
+    }
+
+    snake_simulation__free(&sim);
+    return EXIT_SUCCESS;
+}
+
+// Steps its own range of a shared Batch_Env, starting a new game in any slot whose game ended
+struct Headless__Batch_Worker
+{
+    Batch_Env* env;
+    uint8* actions;  // Shared, indexed by game like the env
+    uint32 first;
+    uint32 count;
+    uint32 tick_count;
+    uint32 seed;  // For the games this worker starts
+
+    uint64 finished_game_count;
+    uint64 finished_game_score;
+};
+
+local_internal void headless__run_batch_worker(Headless__Batch_Worker* worker)
+{
+    Batch_Env* env = worker->env;
+
+    const uint32* jumping_games = env->jumping_games + worker->first;
+
+    for (uint32 tick = 0; tick < worker->tick_count; tick++)
+    {
+        uint32 jumping_count =
+            batch_env__begin_step(env, worker->first, worker->count, HEADLESS_DELTA_TIME__SECONDS);
+
+        for (uint32 i = 0; i < jumping_count; i++)
+        {
+            uint32 game = jumping_games[i];
+            worker->actions[game] = (uint8)headless__choose_batch_direction(env, game);
+        }
+
+        batch_env__finish_step(env, worker->first, jumping_count, worker->actions);
+
+        // Only games that moved can have ended
+        for (uint32 i = 0; i < jumping_count; i++)
+        {
+            uint32 game = jumping_games[i];
+            if (env->done[game])
+            {
+                worker->finished_game_count++;
+                worker->finished_game_score += env->length[game];
+                batch_env__reset(env, game, worker->seed);
+                snake_rng__next(&worker->seed);
+            }
+        }
+    }
+}
+
+local_internal void headless__run_batch_workers(void* data, uint32 first, uint32 count)
+{
+    Headless__Batch_Worker* workers = (Headless__Batch_Worker*)data;
+    for (uint32 i = first; i < first + count; i++)
+    {
+        headless__run_batch_worker(&workers[i]);
+    }
+}
+
+local_internal int32 headless__run_batch(Headless__Options* options)
+{
+    Batch_Env env = {};
+    if (!batch_env__init(&env, options->batch_game_count, options->x_grids, options->y_grids))
+    {
+        return EXIT_FAILURE;
+    }
+    batch_env__reset_all(&env, options->seed);
+    std::vector<uint8> actions(env.game_count);
+
+    uint32 thread_count = options->thread_count ? options->thread_count : std::thread::hardware_concurrency();
+    thread_count = thread_count ? thread_count : 1;
+    thread_count = thread_count < env.game_count ? thread_count : env.game_count;
+
+    std::vector<Headless__Batch_Worker> workers(thread_count);
+    uint32 games_per_worker = env.game_count / thread_count;
+    for (uint32 i = 0; i < thread_count; i++)
+    {
+        Headless__Batch_Worker* worker = &workers[i];
+        *worker = Headless__Batch_Worker();
+        worker->env = &env;
+        worker->actions = &actions[0];
+        worker->first = i * games_per_worker;
+        worker->count = i == thread_count - 1 ? env.game_count - worker->first : games_per_worker;
+        worker->tick_count = options->batch_tick_count;
+        worker->seed = options->seed ^ ((i + 1) * 2654435761u);  // Any different stream per worker will do
+    }
+
+    Thread_Pool pool = {};
+    thread_pool__start(&pool, thread_count - 1);
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+    // One worker per batch, each steps its games for every tick without syncing with the others
+    thread_pool__parallel_for(&pool, thread_count, 1, headless__run_batch_workers, &workers[0]);
+
+    real64 seconds = std::chrono::duration<real64>(std::chrono::steady_clock::now() - start).count();
+    thread_pool__stop(&pool);
+    if (seconds <= 0)
+    {
+        seconds = 1e-9;
+    }
+
+    uint64 finished_game_count = 0;
+    uint64 finished_game_score = 0;
+    for (uint32 i = 0; i < thread_count; i++)
+    {
+        finished_game_count += workers[i].finished_game_count;
+        finished_game_score += workers[i].finished_game_score;
+    }
+    uint64 game_ticks = (uint64)env.game_count * options->batch_tick_count;
+
+    printf("Batch of %u games on %ux%u, %u threads: %llu game-ticks in %.3f ms\n",
+           env.game_count,
+           env.x_grids,
+           env.y_grids,
+           thread_count,
+           (unsigned long long)game_ticks,
+           seconds * 1000.0);
+    printf("%.0f game-ticks/s, %llu games finished, mean score %.1f\n",
+           game_ticks / seconds,
+           (unsigned long long)finished_game_count,
+           finished_game_count ? (real64)finished_game_score / finished_game_count : 0.0);
+
+    batch_env__free(&env);
+    return EXIT_SUCCESS;
+}
+
+// Plays the same games through a Batch_Env and through Snake_Simulations and checks they never disagree
+local_internal int32 headless__verify_batch(Headless__Options* options)
+{
+    const uint32 game_count = 64;
+    const uint32 tick_count = 100 * 1000;
+
+    Batch_Env env = {};
+    if (!batch_env__init(&env, game_count, options->x_grids, options->y_grids))
+    {
+        return EXIT_FAILURE;
+    }
+    std::vector<Snake_Simulation> sims(game_count);
+    std::vector<uint8> actions(game_count);
+
+    uint32 seed = options->seed;
+    for (uint32 i = 0; i < game_count; i++)
+    {
+        sims[i] = Snake_Simulation();
+        batch_env__reset(&env, i, seed);
+        if (!snake_simulation__reset(&sims[i], options->x_grids, options->y_grids, seed))
+        {
+            return EXIT_FAILURE;
+        }
+        snake_rng__next(&seed);
+    }
+
+    uint64 finished_game_count = 0;
+    int32 result = EXIT_SUCCESS;
+    for (uint32 tick = 0; tick < tick_count && result == EXIT_SUCCESS; tick++)
+    {
+        uint32 jumping_count = batch_env__begin_step(&env, 0, game_count, HEADLESS_DELTA_TIME__SECONDS);
+        for (uint32 i = 0; i < jumping_count; i++)
+        {
+            uint32 game = env.jumping_games[i];
+            actions[game] = (uint8)headless__choose_batch_direction(&env, game);
+            snake_simulation__queue_input(&sims[game], (Direction)actions[game]);
+        }
+        batch_env__finish_step(&env, 0, jumping_count, &actions[0]);
+
+        for (uint32 i = 0; i < game_count && result == EXIT_SUCCESS; i++)
+        {
+            Snake_Simulation* sim = &sims[i];
+            snake_simulation__step(sim, HEADLESS_DELTA_TIME__SECONDS);
+
+            bool32 is_match = env.head_x[i] == sim->pos_x && env.head_y[i] == sim->pos_y &&
+                              env.direction[i] == sim->current_direction &&
+                              env.length[i] == sim->next_snake_part_index && env.egg_x[i] == sim->blip_pos_x &&
+                              env.egg_y[i] == sim->blip_pos_y && env.rng[i] == sim->rng && env.ticks[i] == sim->ticks &&
+                              (bool32)env.done[i] == sim->game_over;
+            const uint16* body = env.body + (size_t)i * env.cell_count;
+            for (uint32 part = 0; part < sim->next_snake_part_index && is_match; part++)
+            {
+                Snake_Part* snake_part = snake_simulation__part(sim, part);
+                is_match = body[(env.body_first[i] + part) % env.cell_count] ==
+                           snake_simulation__cell_index(sim, snake_part->pos_x, snake_part->pos_y);
+            }
+            if (!is_match)
+            {
+                fprintf(stderr, "ERROR::HEADLESS: Batch game %u went a different way on tick %u\n", i, tick);
+                result = EXIT_FAILURE;
+            }
+
+            if (env.done[i])
+            {
+                finished_game_count++;
+                batch_env__reset(&env, i, seed);
+                snake_simulation__reset(sim, options->x_grids, options->y_grids, seed);
+                snake_rng__next(&seed);
+            }
+        }
+    }
+
+    if (result == EXIT_SUCCESS)
+    {
+        printf("Batch env matches Snake_Simulation: %u games side by side for %u ticks, %llu games finished\n",
+               game_count,
+               tick_count,
+               (unsigned long long)finished_game_count);
+    }
+
+    for (uint32 i = 0; i < game_count; i++)
+    {
+        snake_simulation__free(&sims[i]);
+    }
+    batch_env__free(&env);
+    return result;
+}
+
+#define HEADLESS_BENCH_TASK_COUNT (100 * 1000)
+#define HEADLESS_BENCH_CHAIN_LENGTH (10 * 1000)
+#define HEADLESS_BENCH_ITEM_COUNT (1024 * 1024)
+#define HEADLESS_BENCH_ROUNDS_PER_ITEM 64
+
+local_internal void headless__bench_empty_task(Thread_Pool* pool, void* data)
+{
+    (void)pool;
+    (void)data;
+}
+
+// Stands in for real per-item work (a game tick, a glyph) that touches nothing but its own item
+local_internal void headless__bench_hash_items(void* data, uint32 first, uint32 count)
+{
+    uint32* values = (uint32*)data;
+    for (uint32 i = first; i < first + count; i++)
+    {
+        uint32 x = values[i];
+        for (uint32 round = 0; round < HEADLESS_BENCH_ROUNDS_PER_ITEM; round++)
+        {
+            x = (x * 1664525u + 1013904223u) ^ (x >> 13);
+        }
+        values[i] = x;
+    }
+}
+
+local_internal int32 headless__bench_jobs(Headless__Options* options)
+{
+    uint32 max_thread_count = options->thread_count ? options->thread_count : std::thread::hardware_concurrency();
+    max_thread_count = max_thread_count ? max_thread_count : 1;
+
+    std::vector<uint32> values(HEADLESS_BENCH_ITEM_COUNT);
+    real64 single_thread__ms = 0;
+    uint32 single_thread_checksum = 0;
+
+    printf("threads | ns per task | ns per dependency | parallel_for ms | speedup | steals\n");
+    for (uint32 thread_count = 1; thread_count <= max_thread_count; thread_count++)
+    {
+        Thread_Pool pool = {};
+        thread_pool__start(&pool, thread_count - 1);
+
+        real64 task__ns = 0;
+        {  // Scheduling overhead: empty tasks from one thread, run by everyone
+            std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+            for (uint32 i = 0; i < HEADLESS_BENCH_TASK_COUNT; i++)
+            {
+                thread_pool__submit(&pool, headless__bench_empty_task, 0);
+            }
+            thread_pool__wait(&pool);
+            task__ns = std::chrono::duration<real64, std::nano>(std::chrono::steady_clock::now() - start).count() /
+                       HEADLESS_BENCH_TASK_COUNT;
+        }
+
+        real64 dependency__ns = 0;
+        {  // A chain of empty tasks, each held back until the one before it has run
+            std::vector<Thread_Pool__Counter> counters(HEADLESS_BENCH_CHAIN_LENGTH);
+            std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+            thread_pool__submit_signal(&pool, headless__bench_empty_task, 0, &counters[0]);
+            for (uint32 i = 1; i < HEADLESS_BENCH_CHAIN_LENGTH; i++)
+            {
+                thread_pool__submit_after(&pool, &counters[i - 1], headless__bench_empty_task, 0, &counters[i]);
+            }
+            thread_pool__wait_for(&pool, &counters[HEADLESS_BENCH_CHAIN_LENGTH - 1]);
+            thread_pool__wait(&pool);
+            std::chrono::steady_clock::duration elapsed = std::chrono::steady_clock::now() - start;
+            dependency__ns = std::chrono::duration<real64, std::nano>(elapsed).count() / HEADLESS_BENCH_CHAIN_LENGTH;
+        }
+
+        real64 parallel_for__ms = 0;
+        {  // Scaling
+            for (uint32 i = 0; i < HEADLESS_BENCH_ITEM_COUNT; i++)
+            {
+                values[i] = i;
+            }
+            uint64 steal_count = pool.steal_count;
+            std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+            thread_pool__parallel_for(&pool, HEADLESS_BENCH_ITEM_COUNT, 1024, headless__bench_hash_items, &values[0]);
+            std::chrono::steady_clock::duration elapsed = std::chrono::steady_clock::now() - start;
+            parallel_for__ms = std::chrono::duration<real64, std::milli>(elapsed).count();
+            steal_count = pool.steal_count - steal_count;
+
+            uint32 checksum = 0;
+            for (uint32 i = 0; i < HEADLESS_BENCH_ITEM_COUNT; i++)
+            {
+                checksum ^= values[i];
+            }
+            if (thread_count == 1)
+            {
+                single_thread__ms = parallel_for__ms;
+                single_thread_checksum = checksum;
+            }
+            else if (checksum != single_thread_checksum)
+            {
+                fprintf(stderr, "ERROR::HEADLESS: parallel_for on %u threads got a different result\n", thread_count);
+                thread_pool__stop(&pool);
+                return EXIT_FAILURE;
+            }
+
+            printf("%7u | %11.1f | %17.1f | %15.2f | %6.2fx | %llu\n",
+                   thread_count,
+                   task__ns,
+                   dependency__ns,
+                   parallel_for__ms,
+                   parallel_for__ms > 0 ? single_thread__ms / parallel_for__ms : 0.0,
+                   (unsigned long long)steal_count);
+        }
+
+        thread_pool__stop(&pool);
+    }
+
+    return EXIT_SUCCESS;
+}
+
+#define HEADLESS_REWIND_JUMPS 16  // How far back the rewind deltas reach
+
+struct Headless__Timing
+{
+    uint64 count;
+    real64 total__us;
+    real64 max__us;
+};
+
+local_internal void headless__time(Headless__Timing* timing, std::chrono::steady_clock::time_point start)
+{
+    real64 us = std::chrono::duration<real64, std::micro>(std::chrono::steady_clock::now() - start).count();
+    timing->count++;
+    timing->total__us += us;
+    timing->max__us = us > timing->max__us ? us : timing->max__us;
+}
+
+local_internal void headless__print_timing(const char* name, Headless__Timing* timing)
+{
+    printf("%-8s %8.3f us mean, %8.3f us max\n",
+           name,
+           timing->count ? timing->total__us / timing->count : 0.0,
+           timing->max__us);
+}
+
+// Restored games have to be indistinguishable from the original, down to where the next eggs spawn
+local_internal bool32 headless__is_same_game(Snake_Simulation* a, Snake_Simulation* b)
+{
+    return snake_simulation__hash(a) == snake_simulation__hash(b) && a->free_cell_count == b->free_cell_count &&
+           a->time_until_grid_jump__seconds == b->time_until_grid_jump__seconds &&
+           a->set_time_until_grid_jump__seconds == b->set_time_until_grid_jump__seconds &&
+           memcmp(a->occupied_cells, b->occupied_cells, a->occupied_word_count * sizeof(uint64)) == 0;
+}
+
+local_internal int32 headless__bench_snapshots(Headless__Options* options)
+{
+    Snake_Simulation sim = {};
+    Snake_Simulation restored = {};
+    Autopilot autopilot = {};
+    bool32 is_autopilot_enabled = (options->x_grids % 2 == 0 || options->y_grids % 2 == 0) &&
+                                  autopilot__init(&autopilot, options->x_grids, options->y_grids);
+    if (!snake_simulation__reset(&sim, options->x_grids, options->y_grids, options->seed))
+    {
+        return EXIT_FAILURE;
+    }
+
+    Headless__Timing save = {};
+    Headless__Timing restore = {};
+    Headless__Timing diff = {};
+    Headless__Timing apply = {};
+    uint64 snapshot_bytes = 0;
+    uint64 delta_bytes = 0;
+    uint64 rewind_delta_bytes = 0;
+    uint64 rewind_count = 0;
+
+    std::vector<uint8> previous;
+    std::vector<uint8> snapshot;
+    std::vector<uint8> delta;
+    std::vector<uint8> rebuilt;
+    std::vector<std::vector<uint8> > jump_snapshots;  // One per jump, for the rewind deltas
+
+    while (!sim.game_over && sim.ticks < options->max_ticks_per_game)
+    {
+        if (snake_simulation__jumps_next_step(&sim, HEADLESS_DELTA_TIME__SECONDS))
+        {
+            snake_simulation__queue_input(&sim,
+                                          is_autopilot_enabled ? autopilot__choose_direction(&autopilot, &sim)
+                                                               : headless__choose_direction(&sim));
+        }
+        bool32 has_jumped = snake_simulation__step(&sim, HEADLESS_DELTA_TIME__SECONDS);
+
+        previous.swap(snapshot);
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        snake_snapshot__save(&sim, &snapshot);
+        headless__time(&save, start);
+        snapshot_bytes += snapshot.size();
+
+        start = std::chrono::steady_clock::now();
+        snake_snapshot__restore(&restored, &snapshot[0], snapshot.size());
+        headless__time(&restore, start);
+        if (!headless__is_same_game(&sim, &restored))
+        {
+            fprintf(stderr, "ERROR::HEADLESS: Restored snapshot differs from the game at tick %u\n", sim.ticks);
+            return EXIT_FAILURE;
+        }
+
+        if (!previous.empty())
+        {
+            start = std::chrono::steady_clock::now();
+            snake_snapshot__diff(&previous[0], previous.size(), &snapshot[0], snapshot.size(), &delta);
+            headless__time(&diff, start);
+            delta_bytes += delta.size();
+
+            start = std::chrono::steady_clock::now();
+            bool32 is_applied =
+                snake_snapshot__apply_delta(&previous[0], previous.size(), &delta[0], delta.size(), &rebuilt);
+            headless__time(&apply, start);
+            if (!is_applied || rebuilt != snapshot)
+            {
+                fprintf(stderr, "ERROR::HEADLESS: Delta didn't rebuild the snapshot at tick %u\n", sim.ticks);
+                return EXIT_FAILURE;
+            }
+        }
+
+        if (has_jumped)
+        {
+            // Rewinding: from now back to a few jumps ago
+            jump_snapshots.push_back(snapshot);
+            if (jump_snapshots.size() > HEADLESS_REWIND_JUMPS)
+            {
+                std::vector<uint8>* past = &jump_snapshots[jump_snapshots.size() - 1 - HEADLESS_REWIND_JUMPS];
+                snake_snapshot__diff(&snapshot[0], snapshot.size(), &(*past)[0], past->size(), &delta);
+                if (!snake_snapshot__apply_delta(&snapshot[0], snapshot.size(), &delta[0], delta.size(), &rebuilt) ||
+                    rebuilt != *past)
+                {
+                    fprintf(stderr, "ERROR::HEADLESS: Rewind delta is wrong at tick %u\n", sim.ticks);
+                    return EXIT_FAILURE;
+                }
+                rewind_delta_bytes += delta.size();
+                rewind_count++;
+            }
+        }
+    }
+
+    uint32 cell_count = options->x_grids * options->y_grids;
+    printf("%s game on %ux%u: %u ticks, final length %u, %u bytes as a Snake_Simulation (%u in the body and cells)\n",
+           is_autopilot_enabled ? "Autopilot" : "Greedy",
+           options->x_grids,
+           options->y_grids,
+           sim.ticks,
+           sim.next_snake_part_index,
+           (uint32)(sizeof(Snake_Simulation) + cell_count * sizeof(Snake_Part) + sim.occupied_word_count * 8),
+           (uint32)(cell_count * sizeof(Snake_Part) + sim.occupied_word_count * 8));
+    printf("Snapshot %.1f bytes mean (%u at the end), delta to the previous tick %.1f bytes mean, %u jumps back %.1f\n",
+           save.count ? (real64)snapshot_bytes / save.count : 0.0,
+           (uint32)snapshot.size(),
+           diff.count ? (real64)delta_bytes / diff.count : 0.0,
+           HEADLESS_REWIND_JUMPS,
+           rewind_count ? (real64)rewind_delta_bytes / rewind_count : 0.0);
+    headless__print_timing("save", &save);
+    headless__print_timing("restore", &restore);
+    headless__print_timing("diff", &diff);
+    headless__print_timing("apply", &apply);
+    printf("Every restore matched the game and every delta rebuilt its snapshot\n");
+
+    autopilot__free(&autopilot);
+    snake_simulation__free(&restored);
+    snake_simulation__free(&sim);
+    return EXIT_SUCCESS;
+}
+
+// Greedy for one snake of a versus game, same idea as headless__choose_direction. Returns DIRECTION_NONE when it wants
+// to keep going straight, so like a real player it only sends an input when it turns.
+local_internal Direction headless__choose_versus_direction(Versus_Simulation* sim, uint32 player)
+{
+    const int32 step_x[] = {0, 1, 0, -1};
+    const int32 step_y[] = {1, 0, -1, 0};
+
+    Versus_Snake* snake = &sim->snakes[player];
+    bool32 is_blocked[4];
+    for (uint32 i = 0; i < 4; i++)
+    {
+        int32 x = snake->head_x + step_x[i];
+        int32 y = snake->head_y + step_y[i];
+        is_blocked[i] = x < 0 || x >= (int32)sim->x_grids || y < 0 || y >= (int32)sim->y_grids ||
+                        versus_simulation__is_occupied(sim, versus_simulation__cell(sim, x, y));
+    }
+    Direction direction = headless__greedy_direction(
+        snake->head_x, snake->head_y, sim->egg_x, sim->egg_y, (Direction)snake->direction, is_blocked);
+    return direction == snake->direction ? DIRECTION_NONE : direction;
+}
+
+local_internal void headless__print_netplay_stats(const char* name, Netplay_Session* session)
+{
+    Netplay_Stats* stats = &session->stats;
+    real64 frame_count = stats->tick_count ? (real64)stats->tick_count : 1.0;
+    printf("%-5s %llu ticks, rolled back on %.1f%% of them, %.2f resimulated ticks per frame (%u at most), "
+           "%.3f ms resimulating (%.1f us per rollback, %.1f us at most)\n",
+           name,
+           (unsigned long long)stats->tick_count,
+           100.0 * stats->rollback_count / frame_count,
+           stats->resimulated_tick_count / frame_count,
+           stats->max_resimulated_ticks,
+           stats->resimulate__seconds * 1000.0,
+           stats->rollback_count ? stats->resimulate__seconds * 1000000.0 / stats->rollback_count : 0.0,
+           stats->max_resimulate__seconds * 1000000.0);
+    printf("      %llu stalls, %llu ticks sat out for time sync, %llu packets sent, %llu received, "
+           "%llu hash checks, %llu mismatches\n",
+           (unsigned long long)stats->stall_count,
+           (unsigned long long)stats->time_sync_count,
+           (unsigned long long)stats->packets_sent,
+           (unsigned long long)stats->packets_received,
+           (unsigned long long)stats->hash_check_count,
+           (unsigned long long)stats->desync_count);
+}
+
+// Two netplay sessions in one process, talking over a loopback link with latency, jitter and loss, each steered by a
+// greedy bot that only sees its own (predicted) game. Afterwards the game is played again offline from both inputs, and
+// both sessions have to agree with it.
+local_internal int32 headless__run_netplay_loopback(Headless__Options* options)
+{
+    Netplay_Loopback loopback = {};
+    loopback.latency__ms = options->latency__ms;
+    loopback.jitter__ms = options->jitter__ms;
+    loopback.loss = options->loss;
+    loopback.rng = options->seed;
+
+    Netplay_Session host = {};
+    Netplay_Session guest = {};
+    netplay_loopback__connect(&loopback, &host.transport, &guest.transport);
+    netplay__host(&host, options->x_grids, options->y_grids, options->seed);
+    netplay__join(&guest);
+
+    Netplay_Session* sessions[VERSUS_PLAYER_COUNT] = {&host, &guest};
+    Direction pending_inputs[VERSUS_PLAYER_COUNT] = {DIRECTION_NONE, DIRECTION_NONE};
+    std::vector<uint8> input_logs[VERSUS_PLAYER_COUNT];  // What each side actually played, by tick
+
+    for (uint32 frame = 0; frame < options->batch_tick_count; frame++)
+    {
+        loopback.now__ms += HEADLESS_DELTA_TIME__SECONDS * 1000.0;
+        for (uint32 player = 0; player < VERSUS_PLAYER_COUNT; player++)
+        {
+            Netplay_Session* session = sessions[player];
+            if (session->is_started && versus_simulation__jumps_next_step(&session->sim, HEADLESS_DELTA_TIME__SECONDS))
+            {
+                Direction direction = headless__choose_versus_direction(&session->sim, player);
+                pending_inputs[player] = direction != DIRECTION_NONE ? direction : pending_inputs[player];
+            }
+            if (netplay__advance(session, pending_inputs[player], HEADLESS_DELTA_TIME__SECONDS))
+            {
+                input_logs[player].push_back((uint8)pending_inputs[player]);
+                pending_inputs[player] = DIRECTION_NONE;
+            }
+        }
+    }
+
+    printf("Netplay over loopback on %ux%u: %.0f ms latency, up to %.0f ms jitter, %.0f%% loss, %u frames\n",
+           options->x_grids,
+           options->y_grids,
+           options->latency__ms,
+           options->jitter__ms,
+           options->loss * 100.0f,
+           options->batch_tick_count);
+    headless__print_netplay_stats("host", &host);
+    headless__print_netplay_stats("guest", &guest);
+    printf("Loopback: %llu packets sent, %llu dropped\n",
+           (unsigned long long)loopback.sent_count,
+           (unsigned long long)loopback.dropped_count);
+
+    // The same game offline, with both players' real inputs, has to hash the same at both sessions' latest checks
+    Versus_Simulation offline = {};
+    versus_simulation__reset(&offline, options->x_grids, options->y_grids, options->seed);
+    uint32 tick_count = (uint32)(input_logs[0].size() < input_logs[1].size() ? input_logs[0].size()
+                                                                             : input_logs[1].size());
+    uint32 matched_count = 0;
+    for (uint32 tick = 0; tick <= tick_count; tick++)
+    {
+        for (uint32 player = 0; player < VERSUS_PLAYER_COUNT; player++)
+        {
+            Netplay_Check* check = &sessions[player]->latest_check;
+            if (check->tick == tick)
+            {
+                if (check->hash != versus_simulation__hash(&offline))
+                {
+                    fprintf(
+                        stderr, "ERROR::HEADLESS: Session %u doesn't match the offline game at tick %u\n", player, tick);
+                    return EXIT_FAILURE;
+                }
+                matched_count++;
+            }
+        }
+        if (tick < tick_count)
+        {
+            uint8 inputs[VERSUS_PLAYER_COUNT] = {input_logs[0][tick], input_logs[1][tick]};
+            versus_simulation__step(&offline, inputs, HEADLESS_DELTA_TIME__SECONDS);
+        }
+    }
+    if (matched_count != VERSUS_PLAYER_COUNT || host.stats.desync_count || guest.stats.desync_count)
+    {
+        fprintf(stderr, "ERROR::HEADLESS: The sessions didn't both check out against the offline game\n");
+        return EXIT_FAILURE;
+    }
+    printf("Both sessions match the offline game (round %u, %u to %u)\n",
+           offline.round,
+           offline.snakes[0].round_win_count,
+           offline.snakes[1].round_win_count);
+
+    return EXIT_SUCCESS;
+}
+
+// Runs the arena once spread over the pool, timing every jump, then again on this thread alone. Both have to end up
+// with the same board.
+local_internal int32 headless__run_arena(Headless__Options* options)
+{
+    uint32 egg_count = options->arena_egg_count ? options->arena_egg_count : options->arena_snake_count / 2;
+    uint32 thread_count = options->thread_count ? options->thread_count : std::thread::hardware_concurrency();
+    thread_count = thread_count ? thread_count : 1;
+
+    Arena_Simulation sim = {};
+    if (!arena_simulation__init(&sim, options->arena_snake_count, egg_count, options->x_grids, options->y_grids))
+    {
+        return EXIT_FAILURE;
+    }
+
+    Thread_Pool pool = {};
+    thread_pool__start(&pool, thread_count - 1);
+
+    arena_simulation__reset(&sim, options->seed);
+    Headless__Timing jump_timing = {};
+    uint64 alive_total = 0;
+    for (uint32 tick = 0; tick < options->batch_tick_count; tick++)
+    {
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        if (arena_simulation__step(&sim, &pool, HEADLESS_DELTA_TIME__SECONDS))
+        {
+            headless__time(&jump_timing, start);
+            alive_total += sim.stats.alive_count;
+        }
+    }
+    thread_pool__stop(&pool);
+
+    uint64 hash = arena_simulation__hash(&sim);
+    Arena_Stats stats = sim.stats;
+    uint32 jumps = sim.jumps;
+
+    arena_simulation__reset(&sim, options->seed);
+    for (uint32 tick = 0; tick < options->batch_tick_count; tick++)
+    {
+        arena_simulation__step(&sim, 0, HEADLESS_DELTA_TIME__SECONDS);
+    }
+    uint64 single_thread_hash = arena_simulation__hash(&sim);
+    arena_simulation__free(&sim);
+
+    real64 mean__ms = jump_timing.count ? jump_timing.total__us / jump_timing.count / 1000.0 : 0.0;
+    real64 budget__ms = ARENA_JUMP__SECONDS * 1000.0;
+    printf("Arena of %u snakes and %u eggs on %ux%u, %u threads, %u jumps\n",
+           options->arena_snake_count,
+           egg_count,
+           options->x_grids,
+           options->y_grids,
+           thread_count,
+           jumps);
+    printf("%.3f ms per jump mean, %.3f ms max, %.1f%% of the %.0f ms between jumps\n",
+           mean__ms,
+           jump_timing.max__us / 1000.0,
+           mean__ms / budget__ms * 100.0,
+           budget__ms);
+    printf("%.0f alive on average, %llu eggs eaten, %llu deaths (%llu head-on), longest %u\n",
+           jumps ? (real64)alive_total / jumps : 0.0,
+           (unsigned long long)stats.eaten_egg_count,
+           (unsigned long long)stats.death_count,
+           (unsigned long long)stats.head_on_count,
+           stats.longest_length);
+
+    if (hash != single_thread_hash)
+    {
+        fprintf(stderr,
+                "ERROR::HEADLESS: The arena came out different on one thread (%016llx vs %016llx)\n",
+                (unsigned long long)single_thread_hash,
+                (unsigned long long)hash);
+        return EXIT_FAILURE;
+    }
+    printf("Same board on one thread (%016llx)\n", (unsigned long long)hash);
+
+    return EXIT_SUCCESS;
+}
+
+int32 main(int32 argc, char* argv[])
+{
+    Headless__Options options = {};
+    options.game_count = 1000;
+    options.seed = 12345;
+    options.x_grids = 64;  // The game's 1280x720 logical screen in 20 pixel cells
+    options.y_grids = 36;
+    options.max_ticks_per_game = 10 * 1000 * 1000;
+    options.batch_tick_count = 10 * 1000;
+    options.move_budget__ms = MCTS_DEFAULT_MOVE_BUDGET__MS;
+    options.latency__ms = 40.0f;
+    options.jitter__ms = 10.0f;
+    options.loss = 0.05f;
+
+    for (int32 i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--games") == 0 && i + 1 < argc)
+        {
+            options.game_count = (uint32)strtoul(argv[++i], 0, 10);
+        }
+        else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc)
+        {
+            options.seed = (uint32)strtoul(argv[++i], 0, 10);
+        }
+        else if (strcmp(argv[i], "--grid") == 0 && i + 2 < argc)
+        {
+            options.x_grids = (uint32)strtoul(argv[++i], 0, 10);
+            options.y_grids = (uint32)strtoul(argv[++i], 0, 10);
+        }
+        else if (strcmp(argv[i], "--max-ticks") == 0 && i + 1 < argc)
+        {
+            options.max_ticks_per_game = (uint32)strtoul(argv[++i], 0, 10);
+        }
+        else if (strcmp(argv[i], "--batch") == 0 && i + 1 < argc)
+        {
+            options.batch_game_count = (uint32)strtoul(argv[++i], 0, 10);
+        }
+        else if (strcmp(argv[i], "--ticks") == 0 && i + 1 < argc)
+        {
+            options.batch_tick_count = (uint32)strtoul(argv[++i], 0, 10);
+        }
+        else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc)
+        {
+            options.thread_count = (uint32)strtoul(argv[++i], 0, 10);
+        }
+        else if (strcmp(argv[i], "--autopilot") == 0)
+        {
+            options.is_autopilot_enabled = 1;
+        }
+        else if (strcmp(argv[i], "--mcts") == 0)
+        {
+            options.is_mcts_enabled = 1;
+        }
+        else if (strcmp(argv[i], "--budget-ms") == 0 && i + 1 < argc)
+        {
+            options.move_budget__ms = (real32)atof(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--verify") == 0)
+        {
+            options.should_verify = 1;
+        }
+        else if (strcmp(argv[i], "--bench-jobs") == 0)
+        {
+            options.should_bench_jobs = 1;
+        }
+        else if (strcmp(argv[i], "--bench-snapshots") == 0)
+        {
+            options.should_bench_snapshots = 1;
+        }
+        else if (strcmp(argv[i], "--netplay-loopback") == 0)
+        {
+            options.should_run_netplay_loopback = 1;
+        }
+        else if (strcmp(argv[i], "--latency-ms") == 0 && i + 1 < argc)
+        {
+            options.latency__ms = (real32)atof(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--jitter-ms") == 0 && i + 1 < argc)
+        {
+            options.jitter__ms = (real32)atof(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--loss") == 0 && i + 1 < argc)
+        {
+            options.loss = (real32)atof(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--arena") == 0 && i + 1 < argc)
+        {
+            options.arena_snake_count = (uint32)strtoul(argv[++i], 0, 10);
+        }
+        else if (strcmp(argv[i], "--eggs") == 0 && i + 1 < argc)
+        {
+            options.arena_egg_count = (uint32)strtoul(argv[++i], 0, 10);
+        }
+        else if (strcmp(argv[i], "--record-replay") == 0 && i + 1 < argc)
+        {
+            global_replay_recorder.path = argv[++i];  // Every game overwrites it, so it ends up holding the last one
+        }
+        else if (strcmp(argv[i], "--play-replay") == 0 && i + 1 < argc)
+        {
+            return snake_simulation__play_replay(argv[++i]) ? EXIT_SUCCESS : EXIT_FAILURE;
+        }
+        else
+        {
+            fprintf(stderr, "ERROR::HEADLESS: Unknown argument %s\n", argv[i]);
+            return EXIT_FAILURE;
+        }
+    }
+
+    if (options.x_grids < 2 || options.y_grids < 4)
+    {
+        fprintf(stderr, "ERROR::HEADLESS: The board has to be at least 2x4\n");
+        return EXIT_FAILURE;
+    }
+
+    if (options.arena_snake_count)
+    {
+        return headless__run_arena(&options);
+    }
+    if (options.should_run_netplay_loopback)
+    {
+        return headless__run_netplay_loopback(&options);
+    }
+    if (options.should_bench_snapshots)
+    {
+        return headless__bench_snapshots(&options);
+    }
+    if (options.should_bench_jobs)
+    {
+        return headless__bench_jobs(&options);
+    }
+    if (options.should_verify)
+    {
+        return headless__verify_batch(&options);
+    }
+    if (options.batch_game_count)
+    {
+        return headless__run_batch(&options);
+    }
+    return headless__run_games(&options);
+}
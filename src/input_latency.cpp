@@ -0,0 +1,173 @@
+// Input latency
+//
+// Follows each key press from the moment SDL saw it (the SDL_Event timestamp) through the game to the
+// SDL_GL_SwapWindow that first put its effect on screen, and keeps the last INPUT_LATENCY_SAMPLE_COUNT latencies of
+// each stage for the debug overlay. Every stage is measured from the event timestamp:
+//     event:   until handle_events polled it
+//     tick:    until the simulation acted on it (for the snake, the jump that turned it)
+//     present: until the swap of the first frame drawn from a tick at or after that one returned
+//
+// Ticks are numbered by whoever runs the updates (the main loop, or the simulation thread) calling
+// input_latency__end_tick after each one. A press acted on during tick t shows up in anything drawn from tick t + 1 on,
+// which is what input_latency__presented gets told. The simulation thread passes the number along in its snapshots.
+//
+// Usage:
+//     input_latency__init(&global_input_latency);
+//     input_latency__record(&global_input_latency, INPUT_LATENCY_STAGE_EVENT, event__ns, now__ns);  // handle_events
+//     input_latency__applied(&global_input_latency, event__ns, now__ns);  // A scene acted on a press
+//     input_latency__end_tick(&global_input_latency);                     // After every update
+//     input_latency__presented(&global_input_latency, drawn_tick, now__ns);  // Right after the swap
+//     input_latency__summarize(&global_input_latency, stage, &summary);
+
+#define INPUT_LATENCY_SAMPLE_COUNT 256  // Per stage, what the overlay's numbers are over
+#define INPUT_LATENCY_MAX_WAITING 32    // Presses acted on but not on screen yet, more than that and the oldest go
+#define INPUT_LATENCY_BUCKET_COUNT 9    // Under 1, 2, 4, ... 128 ms, and the rest
+
+enum
+{
+    INPUT_LATENCY_STAGE_EVENT,
+    INPUT_LATENCY_STAGE_TICK,
+    INPUT_LATENCY_STAGE_PRESENT,
+
+    INPUT_LATENCY_STAGE_COUNT,  // Should be the last item
+};
+
+struct Input_Latency__Samples
+{
+    real32 samples__ms[INPUT_LATENCY_SAMPLE_COUNT];  // Ring, oldest overwritten first
+    uint32 next;
+    uint32 count;
+};
+
+struct Input_Latency__Waiting
+{
+    Uint64 event__ns;
+    uint64 tick;  // The one that acted on it
+};
+
+struct Input_Latency
+{
+    SDL_Mutex* mutex;  // The event and present stages come from the main thread, the tick stage from the updates
+    Input_Latency__Samples stages[INPUT_LATENCY_STAGE_COUNT];
+    Input_Latency__Waiting waiting[INPUT_LATENCY_MAX_WAITING];
+    uint32 waiting_count;
+
+    uint64 tick;  // Only touched by whoever runs the updates
+};
+
+struct Input_Latency_Summary
+{
+    uint32 count;
+    real32 mean__ms;
+    real32 p50__ms;
+    real32 p95__ms;
+    real32 max__ms;
+    uint32 buckets[INPUT_LATENCY_BUCKET_COUNT];
+};
+
+Input_Latency global_input_latency;
+
+const char* INPUT_LATENCY_STAGE_NAMES[INPUT_LATENCY_STAGE_COUNT] = {"event", "tick", "present"};
+
+bool32 input_latency__init(Input_Latency* latency)
+{
+    latency->mutex = SDL_CreateMutex();
+    if (!latency->mutex)
+    {
+        fprintf(stderr, "ERROR::INPUT_LATENCY: %s\n", SDL_GetError());
+        return 0;
+    }
+    return 1;
+}
+
+local_internal void input_latency__push_sample(Input_Latency* latency, uint32 stage, Uint64 event__ns, Uint64 now__ns)
+{
+    Input_Latency__Samples* samples = &latency->stages[stage];
+    samples->samples__ms[samples->next] = now__ns > event__ns ? (real32)(now__ns - event__ns) / 1000000.0f : 0.0f;
+    samples->next = (samples->next + 1) % INPUT_LATENCY_SAMPLE_COUNT;
+    samples->count = SDL_min(samples->count + 1, (uint32)INPUT_LATENCY_SAMPLE_COUNT);
+}
+
+void input_latency__record(Input_Latency* latency, uint32 stage, Uint64 event__ns, Uint64 now__ns)
+{
+    SDL_LockMutex(latency->mutex);
+    input_latency__push_sample(latency, stage, event__ns, now__ns);
+    SDL_UnlockMutex(latency->mutex);
+}
+
+// Called from an update, the press waits for a present from here
+void input_latency__applied(Input_Latency* latency, Uint64 event__ns, Uint64 now__ns)
+{
+    SDL_LockMutex(latency->mutex);
+    input_latency__push_sample(latency, INPUT_LATENCY_STAGE_TICK, event__ns, now__ns);
+    if (latency->waiting_count == INPUT_LATENCY_MAX_WAITING)
+    {
+        latency->waiting_count--;  // Nothing's been presented in a while, forget the oldest
+        SDL_memmove(&latency->waiting[0], &latency->waiting[1], latency->waiting_count * sizeof(latency->waiting[0]));
+    }
+    Input_Latency__Waiting* waiting = &latency->waiting[latency->waiting_count++];
+    waiting->event__ns = event__ns;
+    waiting->tick = latency->tick;
+    SDL_UnlockMutex(latency->mutex);
+}
+
+void input_latency__end_tick(Input_Latency* latency)
+{
+    latency->tick++;
+}
+
+// drawn_tick is the latency->tick the frame that was just swapped was drawn from (everything before it is in there)
+void input_latency__presented(Input_Latency* latency, uint64 drawn_tick, Uint64 now__ns)
+{
+    SDL_LockMutex(latency->mutex);
+    uint32 still_waiting_count = 0;
+    for (uint32 i = 0; i < latency->waiting_count; i++)
+    {
+        Input_Latency__Waiting* waiting = &latency->waiting[i];
+        if (waiting->tick < drawn_tick)
+        {
+            input_latency__push_sample(latency, INPUT_LATENCY_STAGE_PRESENT, waiting->event__ns, now__ns);
+        }
+        else
+        {
+            latency->waiting[still_waiting_count++] = *waiting;
+        }
+    }
+    latency->waiting_count = still_waiting_count;
+    SDL_UnlockMutex(latency->mutex);
+}
+
+void input_latency__summarize(Input_Latency* latency, uint32 stage, Input_Latency_Summary* summary)
+{
+    real32 sorted__ms[INPUT_LATENCY_SAMPLE_COUNT];
+    SDL_LockMutex(latency->mutex);
+    uint32 count = latency->stages[stage].count;
+    SDL_memcpy(sorted__ms, latency->stages[stage].samples__ms, count * sizeof(real32));
+    SDL_UnlockMutex(latency->mutex);
+
+    *summary = Input_Latency_Summary();
+    summary->count = count;
+    if (!count)
+    {
+        return;
+    }
+
+    std::sort(sorted__ms, sorted__ms + count);
+    real32 sum__ms = 0.0f;
+    for (uint32 i = 0; i < count; i++)
+    {
+        sum__ms += sorted__ms[i];
+
+        uint32 bucket = 0;
+        for (real32 bucket_end__ms = 1.0f; bucket < INPUT_LATENCY_BUCKET_COUNT - 1 && sorted__ms[i] >= bucket_end__ms;
+             bucket_end__ms *= 2.0f)
+        {
+            bucket++;
+        }
+        summary->buckets[bucket]++;
+    }
+    summary->mean__ms = sum__ms / count;
+    summary->p50__ms = sorted__ms[count / 2];
+    summary->p95__ms = sorted__ms[(count * 95) / 100];
+    summary->max__ms = sorted__ms[count - 1];
+}
@@ -1,8 +1,13 @@
 // clang-format off
 #include "common.h"
 
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
 #include <iostream>
 #include <map>
+#include <unordered_map>
+#include <vector>
 
 #include <SDL3/SDL.h>
 #include <SDL3_ttf/SDL_ttf.h>
@@ -21,7 +26,13 @@
 
 bool32 TEXT_DEBUGGING_ENABLED = 0;
 bool32 VSYNC_ENABLED = 1;
-real32 TARGET_SCREEN_FPS = 58.9f;
+// Only render and swap when something on screen changed, otherwise sleep until the next input or simulation event
+bool32 RENDER_ON_CHANGE_ENABLED = 1;
+// Run the scenes' input handling and updates on their own thread (see simulation_thread.cpp), also: --simulation-thread
+bool32 SIMULATION_THREAD_ENABLED = 0;
+// Start each frame as late as it can go and still make the next vsync (see frame_pacer.cpp), also: --late-latch
+bool32 LATE_LATCH_ENABLED = 0;
+real32 TARGET_SCREEN_FPS = 60.0f;  // Replaced by the display's refresh rate once there's a window (frame_pacer.cpp)
 
 int32 LOGICAL_WIDTH = 1280;
 int32 LOGICAL_HEIGHT = 720;
@@ -58,6 +69,7 @@ SDL_Renderer* global_renderer;
 real32 global_text_dpi_scale_factor = 1.f;
 
 bool32 global_display_debug_info;
+bool32 global_window_needs_redraw = 1;  // Set by window events (resize, expose, restore, ...)
 
 real32 global_debug_counter;
 
@@ -74,8 +86,51 @@ struct Master_Timer
     real32 total_frame_time_elapsed__seconds;         // How long did the whole dang frame take?
     real64 physics_simulation_elapsed_time__seconds;  // This is the main counter for time. Everything will rely on what
                                                       // the physics sees
+    real32 tick_jitter_mean__ms;  // How far apart simulation ticks land from SIMULATION_DELTA_TIME_S (last second)
+    real32 tick_jitter_max__ms;
 };
 
+// Measures how evenly simulation ticks are spread out in real time
+struct Tick_Jitter
+{
+    Uint64 last_tick_counter;
+    Uint64 window_start_counter;
+    real64 sum__ms;
+    real64 max__ms;
+    uint32 count;
+
+    // Results for the last full second
+    real32 last_mean__ms;
+    real32 last_max__ms;
+};
+
+void tick_jitter__record(Tick_Jitter* jitter, Uint64 counter_now, Uint64 counter_frequency)
+{
+    if (jitter->last_tick_counter)
+    {
+        real64 interval__ms = 1000.0 * (real64)(counter_now - jitter->last_tick_counter) / (real64)counter_frequency;
+        real64 deviation__ms = SDL_fabs(interval__ms - SIMULATION_DELTA_TIME_S * 1000.0);
+        jitter->sum__ms += deviation__ms;
+        jitter->max__ms = SDL_max(jitter->max__ms, deviation__ms);
+        jitter->count++;
+    }
+    else
+    {
+        jitter->window_start_counter = counter_now;
+    }
+    jitter->last_tick_counter = counter_now;
+
+    if (counter_now - jitter->window_start_counter >= counter_frequency)
+    {
+        jitter->last_mean__ms = jitter->count ? (real32)(jitter->sum__ms / jitter->count) : 0.0f;
+        jitter->last_max__ms = (real32)jitter->max__ms;
+        jitter->sum__ms = 0;
+        jitter->max__ms = 0;
+        jitter->count = 0;
+        jitter->window_start_counter = counter_now;
+    }
+}
+
 void set_dpi()
 {
     real32 dpi = (real32)global_pixel_width / (real32)global_window_width;
@@ -98,20 +153,21 @@ global_variable const int32 FONT_SCALE_FACTOR = 4;
 Shader* global_text_shader;
 Shader* global_basic_shader;
 Shader* global_grid_shader;
+Shader* global_texture_shader;
 
 // Function to configure OpenGL for font rendering
+// NOTE: These go through the GL state cache, so calling them before every draw only costs a few compares
 void setupTextRenderingState()
 {
-    glEnable(GL_BLEND);                                 // Enable blending for alpha transparency
-    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);  // Set blend function for alpha blending
-    glDisable(GL_CULL_FACE);                            // Disable face culling (not needed for flat quads)
-    glDisable(GL_DEPTH_TEST);                           // Disable depth testing for text
+    gl_state__set_blend(1, GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);  // Enable alpha blending for transparency
+    gl_state__set_cull_face(0);                                     // Disable face culling (not needed for flat quads)
+    gl_state__set_depth_test(0);                                    // Disable depth testing for text
 }
 
 // Function to restore OpenGL state for geometry rendering
 void setupGeometryRenderingState()
 {
-    glDisable(GL_BLEND);  // Disable blending to avoid transparency issues in 3D models
+    gl_state__set_blend(0);  // Disable blending to avoid transparency issues in 3D models
     // glEnable(GL_CULL_FACE); // Enable face culling for proper back-face removal
     // glCullFace(GL_BACK); // Cull back faces
     // glFrontFace(GL_CCW); // Counter-clockwise winding is front-facing
@@ -138,7 +194,7 @@ void setupQuad()
     glGenBuffers(1, &quadVBO);
     glGenBuffers(1, &quadEBO);
 
-    glBindVertexArray(quadVAO);
+    gl_state__bind_vertex_array(quadVAO);
 
     glBindBuffer(GL_ARRAY_BUFFER, quadVBO);
     glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
@@ -154,7 +210,7 @@ void setupQuad()
     glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 4 * sizeof(float), (void*)(2 * sizeof(float)));
     glEnableVertexAttribArray(1);
 
-    glBindVertexArray(0);
+    gl_state__bind_vertex_array(0);
 }
 
 unsigned int global_square_VAO, global_square_VBO, global_square_EBO;
@@ -181,7 +237,7 @@ void setup_square_buffers()
     glGenBuffers(1, &global_square_VBO);
     glGenBuffers(1, &global_square_EBO);
 
-    glBindVertexArray(global_square_VAO);
+    gl_state__bind_vertex_array(global_square_VAO);
 
     glBindBuffer(GL_ARRAY_BUFFER, global_square_VBO);
     glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
@@ -193,77 +249,49 @@ void setup_square_buffers()
     glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 2 * sizeof(float), (void*)0);
     glEnableVertexAttribArray(0);
 
-    glBindVertexArray(0); // Unbind for safety
+    gl_state__bind_vertex_array(0); // Unbind for safety
 }
 
-/// Holds all state information relevant to a character as loaded using FreeType
-struct Character
+// Per-frame constants shared by every program through the "Frame_Uniforms" uniform block.
+// NOTE: Must match the std140 layout of the block declared in the shaders.
+struct Frame_Uniforms
 {
-    unsigned int TextureID;  // ID handle of the glyph texture
-    glm::ivec2 Size;         // Size of glyph
-    glm::ivec2 Bearing;      // Offset from baseline to left/top of glyph
-    unsigned int Advance;    // Horizontal offset to advance to next glyph
+    glm::mat4 projection;
+    glm::vec2 logical_size;
+    real32 time__seconds;
+    real32 _padding;
 };
 
-std::map<GLchar, Character> Characters;
-unsigned int FONT_VAO, FONT_VBO;
+#define FRAME_UNIFORMS_BINDING_POINT 0
+GLuint global_frame_uniforms_UBO;
 
-void RenderText(Shader& shader, std::string text, float x, float y, float scale, glm::vec3 color)
+void frame_uniforms__init()
 {
-    setupTextRenderingState();
-    shader.use();
-    
-    glm::mat4 projection = glm::ortho(0.0f, (real32)LOGICAL_WIDTH, 0.0f, (real32)LOGICAL_HEIGHT);
-    glUniformMatrix4fv(glGetUniformLocation(global_text_shader->ID, "projection"),
-                       1,
-                       GL_FALSE,
-                       glm::value_ptr(projection));
-    // activate corresponding render state
-    glUniform3f(glGetUniformLocation(shader.ID, "textColor"), color.x, color.y, color.z);
-    glActiveTexture(GL_TEXTURE0);
-    glBindVertexArray(FONT_VAO);
-
-    // iterate through all characters
-    std::string::const_iterator c;
-    for (c = text.begin(); c != text.end(); c++)
-    {
-        Character ch = Characters[*c];
-
-        float xpos = x + ch.Bearing.x * scale;
-        float ypos = y - (ch.Size.y - ch.Bearing.y) * scale;
-
-        float w = ch.Size.x * scale;
-        float h = ch.Size.y * scale;
-        // update VBO for each character
-        float vertices[6][4] = {
-            // clang-format off
-            { xpos,     ypos + h,   0.0f, 0.0f },
-            { xpos,     ypos,       0.0f, 1.0f },
-            { xpos + w, ypos,       1.0f, 1.0f },
-
-            { xpos,     ypos + h,   0.0f, 0.0f },
-            { xpos + w, ypos,       1.0f, 1.0f },
-            { xpos + w, ypos + h,   1.0f, 0.0f }
-            // clang-format on
-        };
-        // render glyph texture over quad
-        glBindTexture(GL_TEXTURE_2D, ch.TextureID);
-        // update content of VBO memory
-        glBindBuffer(GL_ARRAY_BUFFER, FONT_VBO);
-        glBufferSubData(GL_ARRAY_BUFFER,
-                        0,
-                        sizeof(vertices),
-                        vertices);  // be sure to use glBufferSubData and not glBufferData
-
-        glBindBuffer(GL_ARRAY_BUFFER, 0);
-        // render quad
-        glDrawArrays(GL_TRIANGLES, 0, 6);
-        // now advance cursors for next glyph (note that advance is number of 1/64 pixels)
-        x += (ch.Advance >> 6) * scale;  // bitshift by 6 to get value in pixels (2^6 = 64 (divide amount of 1/64th
-                                         // pixels by 64 to get amount of pixels))
-    }
-    glBindVertexArray(0);
-    glBindTexture(GL_TEXTURE_2D, 0);
+    glGenBuffers(1, &global_frame_uniforms_UBO);
+    glBindBuffer(GL_UNIFORM_BUFFER, global_frame_uniforms_UBO);
+    glBufferData(GL_UNIFORM_BUFFER, sizeof(Frame_Uniforms), NULL, GL_DYNAMIC_DRAW);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+
+    // Bound once, every program that declares the block reads from it
+    glBindBufferBase(GL_UNIFORM_BUFFER, FRAME_UNIFORMS_BINDING_POINT, global_frame_uniforms_UBO);
+}
+
+void frame_uniforms__attach(Shader& shader)
+{
+    shader.bindUniformBlock("Frame_Uniforms", FRAME_UNIFORMS_BINDING_POINT);
+}
+
+// Uploaded once per frame instead of once per draw
+void frame_uniforms__update(real64 time__seconds)
+{
+    Frame_Uniforms uniforms = {};
+    uniforms.projection = glm::ortho(0.0f, (real32)LOGICAL_WIDTH, 0.0f, (real32)LOGICAL_HEIGHT);
+    uniforms.logical_size = glm::vec2((real32)LOGICAL_WIDTH, (real32)LOGICAL_HEIGHT);
+    uniforms.time__seconds = (real32)time__seconds;
+
+    glBindBuffer(GL_UNIFORM_BUFFER, global_frame_uniforms_UBO);
+    glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(Frame_Uniforms), &uniforms);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
 }
 
 void adjust_viewport_to_window()
@@ -281,21 +309,38 @@ void adjust_viewport_to_window()
         // Window is wider than logical resolution
         int viewportWidth = (int32)(global_pixel_height * logicalAspectRatio);
         int xOffset = (global_pixel_width - viewportWidth) / 2;
-        glViewport(xOffset, 0, viewportWidth, global_pixel_height);
+        gl_state__set_viewport(xOffset, 0, viewportWidth, global_pixel_height);
     }
     else
     {
         // Window is taller than logical resolution
         int viewportHeight = (int32)(global_pixel_width / logicalAspectRatio);
         int yOffset = (global_pixel_height - viewportHeight) / 2;
-        glViewport(0, yOffset, global_pixel_width, viewportHeight);
+        gl_state__set_viewport(0, yOffset, global_pixel_width, viewportHeight);
     }
 }
 
 // clang-format off
+#include "gl_state.cpp"
+#include "stream_buffer.cpp"
+#include "memory_arena.cpp"
+#include "thread_pool.cpp"
+#include "texture_atlas.cpp"
+#include "sprite_batch.cpp"
+#include "text.cpp"
+#include "input_latency.cpp"
+#include "frame_pacer.cpp"
 #include "debug_utils.cpp"
 #include "sdl_events.cpp"
 #include "audio.cpp"
+#include "replay.cpp"
+#include "snake_simulation.cpp"
+#include "snapshot.cpp"
+#include "autopilot.cpp"
+#include "mcts.cpp"
+#include "versus_simulation.cpp"
+#include "netplay.cpp"
+#include "arena_simulation.cpp"
 
 typedef struct Scene
 {
@@ -303,25 +348,78 @@ typedef struct Scene
     void (*handle_input)(struct Scene* scene, Input* input);
     void (*update)(struct Scene* scene, real64 simulation_time_elapsed, real32 dt_s);
     void (*render)(struct Scene* scene);
+    // Simulation seconds until the scene's visuals will change by themselves (e.g. the next snake move), or a negative
+    // number if they won't change until there's input
+    real32 (*seconds_until_next_change)(struct Scene* scene);
+    // Copies the state for another thread to render from (see simulation_thread.cpp), can be 0 if the state has no
+    // pointers and copying state_size bytes is enough
+    void (*copy_state)(struct Scene* scene, std::vector<uint8>* snapshot);
     void* state;  // Pointer to the scene-specific state
+    size_t state_size;
+    bool32 has_visual_changes;  // Set by the scene whenever what it renders changes, cleared once presented
 } Scene;
 
 Scene* global_next_scene;
 Scene* global_current_scene;
 Scene global_start_screen_scene;
 Scene global_gameplay_scene;
+Scene global_versus_scene;
+Scene global_arena_scene;
 
 Audio_Context global_audio_context;
 
-uint32 global_snake_face_texture;
-uint32 global_snake_body_texture;
-uint32 global_snake_tail_texture;
-uint32 global_egg_texture;
+bool32 global_autopilot_enabled;  // Picked on the start screen, the gameplay scene steers with global_autopilot
+Autopilot global_autopilot;
+bool32 global_autopilot_uses_mcts;  // --mcts, search with global_mcts_player instead of following the cycle
+Thread_Pool global_thread_pool;     // The job system, one worker per core besides this thread
+Mcts_Player global_mcts_player;
+
+Texture_Atlas global_sprite_atlas;
+Atlas_Region global_snake_head_region;
+Atlas_Region global_snake_body_region;
+Atlas_Region global_snake_tail_region;
+Atlas_Region global_egg_region;
 
 #include "scenes/start_screen.cpp"
 #include "scenes/gameplay.cpp"
+#include "scenes/versus.cpp"
+#include "scenes/arena.cpp"
 // clang-format on
 
+// Switches to the scene asked for with global_next_scene (if any)
+void scene_manager__switch_to_next_scene()
+{
+    if (global_next_scene)
+    {
+        global_current_scene = global_next_scene;
+        global_current_scene->reset_state(global_current_scene);
+        global_current_scene->has_visual_changes = 1;
+        global_next_scene = 0;
+    }
+}
+
+#include "simulation_thread.cpp"
+
+// NOTE: Any input wakes us straight away, so this doesn't add input latency
+void wait_for_next_change(Scene* scene, real32 accumulator_s)
+{
+    real32 seconds_until_change = scene->seconds_until_next_change(scene);
+    if (seconds_until_change < 0)
+    {
+        SDL_WaitEvent(NULL);
+        return;
+    }
+
+    // Part of the wait has already built up in the accumulator and just hasn't been simulated yet
+    real32 remaining_ms = (seconds_until_change - accumulator_s) * 1000.0f;
+    int32 timeout_ms = (int32)SDL_ceilf(remaining_ms);
+    if (timeout_ms < 1)
+    {
+        timeout_ms = 1;  // Never spin, the simulation will catch up within a step
+    }
+    SDL_WaitEventTimeout(NULL, timeout_ms);
+}
+
 bool filterEvent(void* userdata, SDL_Event* event)
 {
     Input* input = (Input*)(userdata);
@@ -372,6 +470,49 @@ int32 main(int32 argc, char* argv[])
         return SDL_APP_FAILURE;
     }
 
+    for (int32 i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--simulation-thread") == 0)
+        {
+            SIMULATION_THREAD_ENABLED = 1;
+        }
+        else if (strcmp(argv[i], "--late-latch") == 0)
+        {
+            LATE_LATCH_ENABLED = 1;
+        }
+        else if (strcmp(argv[i], "--mcts") == 0)
+        {
+            global_autopilot_uses_mcts = 1;
+        }
+        else if (strcmp(argv[i], "--host") == 0 && i + 1 < argc)
+        {
+            // Versus against whoever joins, see netplay.cpp
+            if (!netplay_udp__open(&global_netplay_session.transport, (uint16)SDL_atoi(argv[++i]), 0, 0))
+            {
+                return EXIT_FAILURE;
+            }
+            netplay__host(&global_netplay_session, X_GRIDS, Y_GRIDS, (uint32)SDL_GetTicksNS());
+        }
+        else if (strcmp(argv[i], "--join") == 0 && i + 2 < argc)
+        {
+            const char* host = argv[++i];
+            if (!netplay_udp__open(&global_netplay_session.transport, 0, host, (uint16)SDL_atoi(argv[++i])))
+            {
+                return EXIT_FAILURE;
+            }
+            netplay__join(&global_netplay_session);
+        }
+        else if (strcmp(argv[i], "--record-replay") == 0 && i + 1 < argc)
+        {
+            global_replay_recorder.path = argv[++i];
+        }
+        else if (strcmp(argv[i], "--play-replay") == 0 && i + 1 < argc)
+        {
+            // Headless, no window or audio
+            return snake_simulation__play_replay(argv[++i]) ? EXIT_SUCCESS : EXIT_FAILURE;
+        }
+    }
+
     if (!SDL_Init(SDL_INIT_VIDEO))
     {
         return SDL_APP_FAILURE;
@@ -428,9 +569,18 @@ int32 main(int32 argc, char* argv[])
             return SDL_APP_FAILURE;
         }
 
-        SDL_GL_SetSwapInterval(VSYNC_ENABLED);
+        bool32 is_vsync_on = SDL_GL_SetSwapInterval(VSYNC_ENABLED) && VSYNC_ENABLED;
+        if (!frame_pacer__init(&global_frame_pacer, is_vsync_on))
+        {
+            return SDL_APP_FAILURE;
+        }
+        frame_pacer__read_refresh_rate(&global_frame_pacer, global_window);
+        global_frame_pacer.is_late_latching = LATE_LATCH_ENABLED;
         // Enable multisampling in OpenGL
         glEnable(GL_MULTISAMPLE);
+
+        // Fresh context, nothing in the state cache can be trusted yet
+        gl_state__invalidate();
     }
 
     if (!TTF_Init())
@@ -486,138 +636,105 @@ int32 main(int32 argc, char* argv[])
         global_start_screen_scene = Scene();
         Start_Screen__State start_screen_state = {};
         global_start_screen_scene.state = (void*)&start_screen_state;
+        global_start_screen_scene.state_size = sizeof(start_screen_state);
         start_screen__reset_state(&global_start_screen_scene);
         global_start_screen_scene.reset_state = &start_screen__reset_state;
         global_start_screen_scene.handle_input = &start_screen__handle_input;
         global_start_screen_scene.update = &start_screen__update;
         global_start_screen_scene.render = &start_screen__render;
+        global_start_screen_scene.seconds_until_next_change = &start_screen__seconds_until_next_change;
     }
 
     {  // Gameplay Scene
         global_gameplay_scene = Scene();
         Gameplay__State gameplay_state = {};
         global_gameplay_scene.state = (void*)&gameplay_state;
+        global_gameplay_scene.state_size = sizeof(gameplay_state);
         gameplay__reset_state(&global_gameplay_scene);
         global_gameplay_scene.reset_state = &gameplay__reset_state;
         global_gameplay_scene.handle_input = &gameplay__handle_input;
         global_gameplay_scene.update = &gameplay__update;
         global_gameplay_scene.render = &gameplay__render;
+        global_gameplay_scene.seconds_until_next_change = &gameplay__seconds_until_next_change;
+        global_gameplay_scene.copy_state = &gameplay__copy_state;
     }
 
-    global_current_scene = &global_start_screen_scene;
-
-    bool32 success;
-#define INFO_LOG_LENGTH 512
-    char info_log[INFO_LOG_LENGTH];
-
-    // load and create a texture
-    // -------------------------
-    stbi_set_flip_vertically_on_load(true);  // tell stb_image.h to flip loaded texture's on the y-axis.
-    float borderColor[] = { 0.0f, 0.0f, 0.0f, 0.0f };
-
-    // texture 1
-    // ---------
-    glGenTextures(1, &global_snake_face_texture);
-    glBindTexture(GL_TEXTURE_2D, global_snake_face_texture);
-    // set the texture wrapping parameters
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_BORDER);
-    glTexParameterfv(GL_TEXTURE_2D, GL_TEXTURE_BORDER_COLOR, borderColor);
-
-    // set texture filtering parameters
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-    // load image, create texture and generate mipmaps
-    int width, height, nrChannels;
-    unsigned char* data = stbi_load("assets/images/snake/head.png", &width, &height, &nrChannels, 0);
-    if (data)
-    {
-        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, data);
-        // glGenerateMipmap(GL_TEXTURE_2D);
-    }
-    else
-    {
-        std::cout << "Failed to load texture" << std::endl;
-    }
-    stbi_image_free(data);
-
-    // texture 2
-    // ---------
-    glGenTextures(1, &global_snake_body_texture);
-    glBindTexture(GL_TEXTURE_2D, global_snake_body_texture);
-    // set the texture wrapping parameters
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_BORDER);
-    glTexParameterfv(GL_TEXTURE_2D, GL_TEXTURE_BORDER_COLOR, borderColor);
-
-    // set texture filtering parameters
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-    data = stbi_load("assets/images/snake/body.png", &width, &height, &nrChannels, 0);
-    if (data)
-    {
-        // note that the awesomeface.png has transparency and thus an alpha channel, so make sure to tell OpenGL the
-        // data type is of GL_RGBA
-        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, data);
-        // glGenerateMipmap(GL_TEXTURE_2D);
-    }
-    else
-    {
-        std::cout << "Failed to load texture" << std::endl;
+    {  // Versus Scene
+        global_versus_scene = Scene();
+        Versus__State versus_state = {};
+        global_versus_scene.state = (void*)&versus_state;
+        global_versus_scene.state_size = sizeof(versus_state);
+        versus__reset_state(&global_versus_scene);
+        global_versus_scene.reset_state = &versus__reset_state;
+        global_versus_scene.handle_input = &versus__handle_input;
+        global_versus_scene.update = &versus__update;
+        global_versus_scene.render = &versus__render;
+        global_versus_scene.seconds_until_next_change = &versus__seconds_until_next_change;
     }
-    stbi_image_free(data);
-
-    // texture 3
-    // ---------
-    glGenTextures(1, &global_egg_texture);
-    glBindTexture(GL_TEXTURE_2D, global_egg_texture);
-    // set the texture wrapping parameters
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_BORDER);
-    glTexParameterfv(GL_TEXTURE_2D, GL_TEXTURE_BORDER_COLOR, borderColor);
-
-    // set texture filtering parameters
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-    data = stbi_load("assets/images/snake/egg.png", &width, &height, &nrChannels, 0);
-    if (data)
-    {
-        // note that the awesomeface.png has transparency and thus an alpha channel, so make sure to tell OpenGL the
-        // data type is of GL_RGBA
-        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, data);
-        // glGenerateMipmap(GL_TEXTURE_2D);
+
+    {  // Arena Scene
+        global_arena_scene = Scene();
+        Arena__State arena_state = {};
+        global_arena_scene.state = (void*)&arena_state;
+        global_arena_scene.state_size = sizeof(arena_state);
+        arena__reset_state(&global_arena_scene);
+        global_arena_scene.reset_state = &arena__reset_state;
+        global_arena_scene.handle_input = &arena__handle_input;
+        global_arena_scene.update = &arena__update;
+        global_arena_scene.render = &arena__render;
+        global_arena_scene.seconds_until_next_change = &arena__seconds_until_next_change;
+        global_arena_scene.copy_state = &arena__copy_state;
     }
-    else
+
+    // Straight into the match with --host or --join
+    global_current_scene = global_netplay_session.transport.kind == NETPLAY_TRANSPORT_NONE ? &global_start_screen_scene
+                                                                                            : &global_versus_scene;
+
+    Tick_Jitter tick_jitter = {};
+    uint32 last_presented_visual_change_count = 0;
+    if (!input_latency__init(&global_input_latency))
     {
-        std::cout << "Failed to load texture" << std::endl;
+        return -1;
     }
-    stbi_image_free(data);
-
-    // texture 4
-    // ---------
-    glGenTextures(1, &global_snake_tail_texture);
-    glBindTexture(GL_TEXTURE_2D, global_snake_tail_texture);
-    // set the texture wrapping parameters
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_BORDER);
-    glTexParameterfv(GL_TEXTURE_2D, GL_TEXTURE_BORDER_COLOR, borderColor);
-
-    // set texture filtering parameters
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-    data = stbi_load("assets/images/snake/tail.png", &width, &height, &nrChannels, 0);
-    if (data)
+    if (SIMULATION_THREAD_ENABLED)
     {
-        // note that the awesomeface.png has transparency and thus an alpha channel, so make sure to tell OpenGL the
-        // data type is of GL_RGBA
-        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, data);
-        // glGenerateMipmap(GL_TEXTURE_2D);
+        if (!simulation_thread__start(&global_simulation_thread, master_timer.physics_simulation_elapsed_time__seconds))
+        {
+            return -1;
+        }
     }
-    else
+
+    bool32 success;
+#define INFO_LOG_LENGTH 512
+    char info_log[INFO_LOG_LENGTH];
+
+    thread_pool__start(&global_thread_pool, thread_pool__default_worker_count());
+
+    // load and pack the sprites into one texture
+    // ------------------------------------------
+    stbi_set_flip_vertically_on_load(true);  // tell stb_image.h to flip loaded texture's on the y-axis.
     {
-        std::cout << "Failed to load texture" << std::endl;
+        const Texture_Atlas__Load sprite_loads[] = {
+            {"snake_head", "assets/images/snake/head.png"},
+            {"snake_body", "assets/images/snake/body.png"},
+            {"snake_tail", "assets/images/snake/tail.png"},
+            {"egg", "assets/images/snake/egg.png"},
+        };
+        Texture_Atlas__Builder atlas_builder;
+        texture_atlas__add_images(
+            &atlas_builder, &global_thread_pool, sprite_loads, sizeof(sprite_loads) / sizeof(sprite_loads[0]));
+
+        if (!texture_atlas__build(&atlas_builder, &global_sprite_atlas))
+        {
+            thread_pool__stop(&global_thread_pool);  // Joinable threads left at exit abort
+            return -1;
+        }
+
+        global_snake_head_region = texture_atlas__get_region(&global_sprite_atlas, "snake_head");
+        global_snake_body_region = texture_atlas__get_region(&global_sprite_atlas, "snake_body");
+        global_snake_tail_region = texture_atlas__get_region(&global_sprite_atlas, "snake_tail");
+        global_egg_region = texture_atlas__get_region(&global_sprite_atlas, "egg");
     }
-    stbi_image_free(data);
     /*------------------------------------------------------------*/
     // compile and setup the shader
     // ----------------------------
@@ -626,101 +743,47 @@ int32 main(int32 argc, char* argv[])
 
     // FreeType
     // --------
-    FT_Library ft;
-    // All functions return a value different than 0 whenever an error occurred
-    if (FT_Init_FreeType(&ft))
+    if (!font__load_sdf(&global_font, &global_thread_pool, "assets/fonts/PixelHigh.ttf", 48 * FONT_SCALE_FACTOR))
     {
-        std::cout << "ERROR::FREETYPE: Could not init FreeType Library" << std::endl;
+        thread_pool__stop(&global_thread_pool);  // Joinable threads left at exit abort
         return -1;
     }
-
-    // find path to font
-    // std::string font_name = FileSystem::getPath("assets/fonts/Share_Tech_Mono/ShareTechMono-Regular.ttf");
-    // if (font_name.empty())
-    // {
-    //     std::cout << "ERROR::FREETYPE: Failed to load font_name" << std::endl;
-    //     return -1;
-    // }
-
-    // load font as face
-    FT_Face face;
-    if (FT_New_Face(ft, "assets/fonts/PixelHigh.ttf", 0, &face))
-    {
-        std::cout << "ERROR::FREETYPE: Failed to load font" << std::endl;
-        return -1;
-    }
-    else
-    {
-        // set size to load glyphs as
-        FT_Set_Pixel_Sizes(face, 0, 48 * FONT_SCALE_FACTOR);
-
-        // disable byte-alignment restriction
-        glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
-
-        // load first 128 characters of ASCII set
-        for (unsigned char c = 0; c < 128; c++)
-        {
-            // We're using signed distance fields!
-            FT_Int32 load_flags = FT_LOAD_RENDER | FT_LOAD_TARGET_(FT_RENDER_MODE_SDF);
-            // Load character glyph
-            if (FT_Load_Char(face, c, load_flags))
-            {
-                std::cout << "ERROR::FREETYTPE: Failed to load Glyph" << std::endl;
-                continue;
-            }
-            // generate texture
-            unsigned int texture;
-            glGenTextures(1, &texture);
-            glBindTexture(GL_TEXTURE_2D, texture);
-            glTexImage2D(GL_TEXTURE_2D,
-                         0,
-                         GL_RED,
-                         face->glyph->bitmap.width,
-                         face->glyph->bitmap.rows,
-                         0,
-                         GL_RED,
-                         GL_UNSIGNED_BYTE,
-                         face->glyph->bitmap.buffer);
-            // set texture options
-            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-            // now store character for later use
-            Character character = {texture,
-                                   glm::ivec2(face->glyph->bitmap.width, face->glyph->bitmap.rows),
-                                   glm::ivec2(face->glyph->bitmap_left, face->glyph->bitmap_top),
-                                   static_cast<unsigned int>(face->glyph->advance.x)};
-            Characters.insert(std::pair<char, Character>(c, character));
-        }
-        glBindTexture(GL_TEXTURE_2D, 0);
-    }
-    // destroy FreeType once we're finished
-    FT_Done_Face(face);
-    FT_Done_FreeType(ft);
-
-    // configure VAO/VBO for texture quads
-    // -----------------------------------
-    glGenVertexArrays(1, &FONT_VAO);
-    glGenBuffers(1, &FONT_VBO);
-    glBindVertexArray(FONT_VAO);
-    glBindBuffer(GL_ARRAY_BUFFER, FONT_VBO);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(float) * 6 * 4, NULL, GL_DYNAMIC_DRAW);
-    glEnableVertexAttribArray(0);
-    glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, 4 * sizeof(float), 0);
-    glBindBuffer(GL_ARRAY_BUFFER, 0);
-    glBindVertexArray(0);
+    stream_buffer__init(&global_stream_buffer, STREAM_BUFFER_DEFAULT_SIZE);
+    text_batch__init(&global_text_batch);
 
     /*------------------------------------------------------------*/
 
     Shader basic_shader("src/shaders/basic_shader.vs.glsl", "src/shaders/basic_shader.fs.glsl");
     global_basic_shader = &basic_shader;
 
-    Shader grid_shader("src/shaders/2d_texture.vs.glsl", "src/shaders/2d_texture.fs.glsl");
+    Shader grid_shader("src/shaders/grid.vs.glsl", "src/shaders/grid.fs.glsl");
     global_grid_shader = &grid_shader;
 
+    Shader sprite_shader("src/shaders/sprite_batch.vs.glsl", "src/shaders/2d_texture.fs.glsl");
+    global_sprite_shader = &sprite_shader;
+
+    Shader texture_shader("src/shaders/2d_texture.vs.glsl", "src/shaders/2d_texture.fs.glsl");
+    global_texture_shader = &texture_shader;
+
+    frame_uniforms__init();
+    frame_uniforms__attach(text_shader);
+    frame_uniforms__attach(basic_shader);
+    frame_uniforms__attach(grid_shader);
+    frame_uniforms__attach(sprite_shader);
+    frame_uniforms__attach(texture_shader);
+
+    // Every textured program samples from texture unit 0, set it once rather than on every draw
+    sprite_shader.use();
+    sprite_shader.setInt("texture1", 0);
+    texture_shader.use();
+    texture_shader.setInt("texture1", 0);
+    text_shader.use();
+    text_shader.setInt("text", 0);
+    gl_state__use_program(0);
+
     setupQuad();
     setup_square_buffers();
+    sprite_batch__init(&global_sprite_batch);
     adjust_viewport_to_window();
 
     while (global_running)
@@ -747,17 +810,22 @@ int32 main(int32 argc, char* argv[])
 
         {  // Input and event handling
             handle_events(&event, &input);
-            global_current_scene->handle_input(global_current_scene, &input);
+            if (SIMULATION_THREAD_ENABLED)
+            {
+                simulation_thread__push_input(&global_simulation_thread, &input);
+            }
+            else
+            {
+                global_current_scene->handle_input(global_current_scene, &input);
+            }
         }
 
+        if (!SIMULATION_THREAD_ENABLED)
         {  // Scene Manager
-            if (global_next_scene) {
-                global_current_scene = global_next_scene;
-                global_current_scene->reset_state(global_current_scene);
-                global_next_scene = 0;
-            }
+            scene_manager__switch_to_next_scene();
         }
 
+        if (!SIMULATION_THREAD_ENABLED)
         { // Update Scene
             // Gameplay_State state_to_render;
             // https://gafferongames.com/post/fix_your_timestep/
@@ -779,7 +847,11 @@ int32 main(int32 argc, char* argv[])
                                              SIMULATION_DELTA_TIME_S);
                 master_timer.physics_simulation_elapsed_time__seconds += SIMULATION_DELTA_TIME_S;
                 accumulator_s -= SIMULATION_DELTA_TIME_S;
+                input_latency__end_tick(&global_input_latency);
+                tick_jitter__record(&tick_jitter, SDL_GetPerformanceCounter(), master_timer.COUNTER_FREQUENCY);
             }
+            master_timer.tick_jitter_mean__ms = tick_jitter.last_mean__ms;
+            master_timer.tick_jitter_max__ms = tick_jitter.last_max__ms;
 
             // TODO: we can do some interpolation here if we ever need to make the rendering a bit smoother
             // real32 alpha = accumulator_s / SIMULATION_DELTA_TIME_S;
@@ -802,18 +874,55 @@ int32 main(int32 argc, char* argv[])
             ((real32)(counter_after_work - counter_now) / (real32)master_timer.COUNTER_FREQUENCY);
 //==============================
 
+        // With the simulation thread we draw its latest snapshot, never the live scene state it's busy updating
+        Scene* scene_to_render = global_current_scene;
+        Scene snapshot_scene;
+        const Simulation_Snapshot* snapshot = 0;
+        if (SIMULATION_THREAD_ENABLED)
+        {
+            snapshot = simulation_thread__latest_snapshot(&global_simulation_thread);
+            snapshot_scene = *snapshot->scene;
+            snapshot_scene.state = (void*)&snapshot->state[0];
+            snapshot_scene.has_visual_changes = snapshot->visual_change_count != last_presented_visual_change_count;
+            scene_to_render = &snapshot_scene;
+
+            master_timer.physics_simulation_elapsed_time__seconds = snapshot->simulation_time_elapsed__seconds;
+            master_timer.tick_jitter_mean__ms = snapshot->tick_jitter_mean__ms;
+            master_timer.tick_jitter_max__ms = snapshot->tick_jitter_max__ms;
+        }
+
+        bool32 should_present = 1;
+        if (RENDER_ON_CHANGE_ENABLED)
+        {
+            SDL_WindowFlags window_flags = SDL_GetWindowFlags(global_window);
+            bool32 window_is_visible =
+                !(window_flags & (SDL_WINDOW_MINIMIZED | SDL_WINDOW_OCCLUDED | SDL_WINDOW_HIDDEN));
+            // The debug overlay is live, so keep drawing every frame while it's up
+            bool32 has_changes =
+                scene_to_render->has_visual_changes || global_window_needs_redraw || global_display_debug_info;
+            should_present = window_is_visible && has_changes;
+        }
+
+        if (should_present)
         { // Write to render buffer
             // Clear the screen
             glClearColor(0.15f, 0.15f, 0.15f, 1.0f);
             glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-            global_current_scene->render(global_current_scene);
+            gl_state__begin_frame();
+            stream_buffer__begin_frame(&global_stream_buffer);
+            frame_uniforms__update(master_timer.physics_simulation_elapsed_time__seconds);
+
+            scene_to_render->render(scene_to_render);
 
             if (global_display_debug_info)
             {
                 display_debug_info_text(last_master_timer);
             }
 
+            // All of the frame's text goes out in one draw call, on top of everything else
+            text_batch__flush(&global_text_batch);
+
             display_timer_in_window_name(last_master_timer);
         }
 
@@ -824,6 +933,7 @@ int32 main(int32 argc, char* argv[])
             ((real32)(counter_after_writing_buffer - counter_after_work) / (real32)master_timer.COUNTER_FREQUENCY);
 //==============================
 
+        if (should_present)
         {
             GLenum error = glGetError();
             if (error != GL_NO_ERROR)
@@ -832,6 +942,18 @@ int32 main(int32 argc, char* argv[])
             }
             // Swap buffers
             SDL_GL_SwapWindow(global_window);
+            frame_pacer__presented(&global_frame_pacer, counter_now, SDL_GetPerformanceCounter());
+
+            // Whatever presses the frame was drawn after are on screen now (or as soon as the display flips)
+            uint64 drawn_tick = snapshot ? snapshot->input_latency_tick : global_input_latency.tick;
+            input_latency__presented(&global_input_latency, drawn_tick, SDL_GetTicksNS());
+
+            scene_to_render->has_visual_changes = 0;
+            global_window_needs_redraw = 0;
+            if (snapshot)
+            {
+                last_presented_visual_change_count = snapshot->visual_change_count;
+            }
         }
 
 //==============================
@@ -846,30 +968,24 @@ int32 main(int32 argc, char* argv[])
             ((real32)(counter_after_render - counter_after_writing_buffer) / (real32)master_timer.COUNTER_FREQUENCY);
 //==============================
 
-        {  // Sleep with busy-wait for precise timings
-            real64 TARGET_FRAME_DURATION__Millis = 1000 / TARGET_SCREEN_FPS;
-            real64 target_duration_ticks =
-                (TARGET_FRAME_DURATION__Millis * master_timer.COUNTER_FREQUENCY) / 1000;  // Convert to ticks
-            Uint64 elapsed_ticks = counter_after_render - counter_now;
-
-            if (elapsed_ticks < target_duration_ticks)
+        if (!should_present)
+        {  // Nothing new to show, sleep until there's input or the simulation is due to change something
+            if (SIMULATION_THREAD_ENABLED)
             {
-                real64 remaining_ticks = target_duration_ticks - (real64)elapsed_ticks;
-                real64 remaining_millis = 1000 * (remaining_ticks / master_timer.COUNTER_FREQUENCY);
-
-                if (remaining_millis > 2.f)
-                {
-                    // Precision can be ~1ms on sleep these days. I'm minusing a ms because i want to spin wait
-                    // for the remainder ms.
-                    SDL_Delay((uint32)(remaining_millis - 1.0f));
-                }
-
-                // Spin-wait for the remaining time (microsecond precision)
-                while (SDL_GetPerformanceCounter() - counter_now < target_duration_ticks)
-                {
-                    // Busy-wait for precise timing
-                }
+                SDL_WaitEvent(NULL);  // The simulation thread sends an event whenever it has something new
             }
+            else
+            {
+                wait_for_next_change(global_current_scene, accumulator_s);
+            }
+        }
+        else if (global_frame_pacer.is_late_latching)
+        {  // Sleep until the next frame only just has time to make the next vsync, so its input is as fresh as it gets
+            frame_pacer__wait_to_latch(&global_frame_pacer, &master_timer);
+        }
+        else
+        {  // Hold the frame to the display's refresh interval, sleeping for most of it
+            frame_pacer__wait(&global_frame_pacer, counter_now);
         }
 
         tick_debug_counter(master_timer);
@@ -886,6 +1002,10 @@ int32 main(int32 argc, char* argv[])
             ((real32)(counter_after_sleep - counter_after_render) / (real32)master_timer.COUNTER_FREQUENCY);
         master_timer.total_frame_time_elapsed__seconds =
             ((real32)(counter_after_sleep - counter_now) / (real32)master_timer.COUNTER_FREQUENCY);
+        if (should_present)
+        {
+            frame_pacer__end_frame(&global_frame_pacer, counter_now, counter_after_sleep);
+        }
 
         // Next iteration
         master_timer.last_frame_counter = counter_after_sleep;
@@ -895,6 +1015,13 @@ int32 main(int32 argc, char* argv[])
 //==============================
     } // end while (global_running)
 
+    if (SIMULATION_THREAD_ENABLED)
+    {
+        simulation_thread__stop(&global_simulation_thread);
+    }
+    thread_pool__stop(&global_thread_pool);
+    netplay_transport__close(&global_netplay_session.transport);
+
     TTF_Quit();
     SDL_DestroyWindow(global_window);
     SDL_Quit();
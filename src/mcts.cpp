@@ -0,0 +1,539 @@
+// Monte Carlo tree search player
+//
+// A search-based bot for benchmarking difficulty settings. Every grid jump it searches the moves ahead for a fixed
+// time budget and picks the direction whose subtree got the most visits.
+//
+// Each iteration clones a compact copy of the game (Mcts_State, about 1.6 KB whatever the snake's length), walks down
+// the tree picking children by UCB1 (leaving out moves that crash straight away, unless that's all there is), adds one
+// node, then plays a quick rollout from there: random moves that don't crash straight away, leaning toward the egg.
+// The rollout scores how soon it got to the egg and whether the snake is still alive at the end. Eggs that get eaten
+// during the search respawn from the search's own RNG, so it plans against where eggs could appear, not where the
+// game's RNG is going to put them.
+//
+// It's root-parallel: one independent tree per pool thread, searched in short slices on the work-stealing pool
+// (thread_pool.cpp) until the budget runs out. The visit counts at the roots are summed at the end. The trees share
+// nothing, so rollouts per second scale with the number of cores.
+//
+// Usage:
+//     mcts__init(&player, &pool, move_budget__ms);
+//     if (snake_simulation__jumps_next_step(&sim, dt))
+//         snake_simulation__queue_input(&sim, mcts__choose_direction(&player, &sim));
+
+#include <math.h>
+
+#define MCTS_MAX_CELLS 4096  // Biggest board the compact state fits (e.g. 64x64)
+#define MCTS_MAX_NODES_PER_TREE (64 * 1024)
+#define MCTS_MAX_TREE_DEPTH 64
+#define MCTS_ITERATIONS_PER_SLICE 32  // Between deadline checks, and chances for idle threads to steal
+// Values are 0 to 1, and the egg half of a value only varies by a few hundredths between neighbouring moves. Much more
+// exploration than this and the root's visit counts barely separate.
+#define MCTS_EXPLORATION 0.25f
+#define MCTS_DISCOUNT_RATE 2.0f  // An egg a board's width plus height away is worth about e^-2 of one right here
+#define MCTS_DEFAULT_MOVE_BUDGET__MS 4.0f
+
+struct Mcts_State
+{
+    uint16 x_grids;
+    uint16 y_grids;
+    int16 head_x;
+    int16 head_y;
+    int16 tail_x;  // Same as the head with no body
+    int16 tail_y;
+    int16 egg_x;
+    int16 egg_y;
+    uint16 length;       // Body parts behind the head
+    uint16 moves_first;  // Ring slot of the next move the tail makes
+    uint8 direction;     // Direction enum value
+    uint8 is_over;
+    uint8 has_won;  // Filled the board
+    uint32 rng;     // Where eggs respawn during the search
+
+    // The body as the moves its parts still have to make to catch up with the head, tail's first, 2 bits each (the
+    // direction - 1). That and the tail position are enough to walk it, and far smaller than a list of cells.
+    uint8 moves[MCTS_MAX_CELLS / 4];
+    uint64 occupied[MCTS_MAX_CELLS / 64];  // One bit per cell (y * x_grids + x)
+};
+
+struct Mcts_Node
+{
+    int32 children[4];  // By direction - 1, -1 until expanded
+    uint32 visit_count;
+    real32 total_value;
+};
+
+struct Mcts_Player;
+
+struct Mcts_Tree
+{
+    Mcts_Player* player;
+    std::vector<Mcts_Node> nodes;  // Reserved up front so a node pointer stays valid while the tree grows
+    uint32 rng;
+    uint64 iteration_count;  // This search
+};
+
+struct Mcts_Player
+{
+    Thread_Pool* pool;
+    real32 move_budget__ms;
+
+    std::vector<Mcts_Tree> trees;  // One per pool thread
+    Mcts_State root;
+    std::chrono::steady_clock::time_point deadline;
+    Thread_Pool__Counter searching;  // Slices still to run, so a search can share the pool with other work
+
+    // Last search, for the debug overlay and the headless runner
+    real32 last_rollouts_per_second;
+    uint32 last_tree_size;  // Nodes across all trees
+
+    uint64 total_rollouts;
+    real64 total_search__seconds;
+};
+
+//=======================================================
+// COMPACT STATE
+//=======================================================
+
+local_internal uint32 mcts__rand(uint32* rng)
+{
+    // xorshift32, the LCG's low bits are too regular for picking between a handful of moves
+    uint32 x = *rng;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    *rng = x;
+    return x;
+}
+
+local_internal uint32 mcts_state__cell(const Mcts_State* state, int32 x, int32 y)
+{
+    return (uint32)y * state->x_grids + (uint32)x;
+}
+
+local_internal bool32 mcts_state__is_occupied(const Mcts_State* state, uint32 cell)
+{
+    return (state->occupied[cell / 64] >> (cell % 64)) & 1;
+}
+
+local_internal void mcts_state__set_occupied(Mcts_State* state, uint32 cell, bool32 is_occupied)
+{
+    uint64 bit = (uint64)1 << (cell % 64);
+    state->occupied[cell / 64] = is_occupied ? state->occupied[cell / 64] | bit : state->occupied[cell / 64] & ~bit;
+}
+
+local_internal uint8 mcts_state__get_move(const Mcts_State* state, uint32 slot)
+{
+    slot %= MCTS_MAX_CELLS;
+    return (uint8)(((state->moves[slot / 4] >> ((slot % 4) * 2)) & 3) + 1);
+}
+
+local_internal void mcts_state__set_move(Mcts_State* state, uint32 slot, uint8 direction)
+{
+    slot %= MCTS_MAX_CELLS;
+    uint32 shift = (slot % 4) * 2;
+    state->moves[slot / 4] = (uint8)((state->moves[slot / 4] & ~(3 << shift)) | ((direction - 1) << shift));
+}
+
+local_internal void mcts__direction_step(uint8 direction, int32* x, int32* y)
+{
+    *x += direction == DIRECTION_EAST ? 1 : direction == DIRECTION_WEST ? -1 : 0;
+    *y += direction == DIRECTION_NORTH ? 1 : direction == DIRECTION_SOUTH ? -1 : 0;
+}
+
+local_internal uint8 mcts__opposite(uint8 direction)
+{
+    return (uint8)((direction + 1) % 4 + 1);  // North <-> south, east <-> west
+}
+
+// Returns 0 if the board is too big for the compact state
+bool32 mcts_state__from_simulation(Mcts_State* state, Snake_Simulation* sim, uint32 rng)
+{
+    if (sim->x_grids * sim->y_grids > MCTS_MAX_CELLS)
+    {
+        return 0;
+    }
+
+    memset(state->occupied, 0, sizeof(state->occupied));
+    state->x_grids = (uint16)sim->x_grids;
+    state->y_grids = (uint16)sim->y_grids;
+    state->head_x = (int16)sim->pos_x;
+    state->head_y = (int16)sim->pos_y;
+    state->egg_x = (int16)sim->blip_pos_x;
+    state->egg_y = (int16)sim->blip_pos_y;
+    state->length = (uint16)sim->next_snake_part_index;
+    state->moves_first = 0;
+    state->direction = (uint8)sim->current_direction;
+    state->is_over = (uint8)sim->game_over;
+    state->has_won = 0;
+    state->rng = rng ? rng : 1;
+
+    // Walk from the tail to the head, recording the move from each part to the next one up
+    int32 x = sim->pos_x;
+    int32 y = sim->pos_y;
+    if (state->length)
+    {
+        Snake_Part* tail = snake_simulation__part(sim, state->length - 1);
+        x = tail->pos_x;
+        y = tail->pos_y;
+    }
+    state->tail_x = (int16)x;
+    state->tail_y = (int16)y;
+
+    for (uint32 i = 0; i < state->length; i++)
+    {
+        uint32 part = state->length - 1 - i;
+        int32 next_x = part ? snake_simulation__part(sim, part - 1)->pos_x : sim->pos_x;
+        int32 next_y = part ? snake_simulation__part(sim, part - 1)->pos_y : sim->pos_y;
+
+        uint8 direction = next_x > x ? DIRECTION_EAST : next_x < x ? DIRECTION_WEST : next_y > y ? DIRECTION_NORTH
+                                                                                                  : DIRECTION_SOUTH;
+        mcts_state__set_move(state, i, direction);
+        mcts_state__set_occupied(state, mcts_state__cell(state, x, y), 1);
+        x = next_x;
+        y = next_y;
+    }
+    mcts_state__set_occupied(state, mcts_state__cell(state, sim->pos_x, sim->pos_y), 1);
+
+    return 1;
+}
+
+// Picks a free cell for the egg, roughly uniformly. Returns 0 if there isn't one.
+local_internal bool32 mcts_state__spawn_egg(Mcts_State* state)
+{
+    uint32 cell_count = (uint32)state->x_grids * state->y_grids;
+    uint32 free_count = cell_count - (state->length + 1);
+    if (!free_count)
+    {
+        return 0;
+    }
+
+    uint32 cell = 0;
+    bool32 is_found = 0;
+    for (uint32 attempt = 0; attempt < 8 && !is_found; attempt++)  // Plenty of room most of the game
+    {
+        cell = mcts__rand(&state->rng) % cell_count;
+        is_found = !mcts_state__is_occupied(state, cell);
+    }
+    if (!is_found)
+    {
+        uint32 skip = mcts__rand(&state->rng) % free_count;
+        for (cell = 0; cell < cell_count; cell++)
+        {
+            if (!mcts_state__is_occupied(state, cell) && skip-- == 0)
+            {
+                break;
+            }
+        }
+    }
+
+    state->egg_x = (int16)(cell % state->x_grids);
+    state->egg_y = (int16)(cell / state->x_grids);
+    return 1;
+}
+
+// One grid jump with the same rules as snake_simulation__step. Returns 1 if an egg got eaten.
+local_internal bool32 mcts_state__step(Mcts_State* state, uint8 action)
+{
+    if (action != DIRECTION_NONE && action != mcts__opposite(state->direction))
+    {
+        state->direction = action;
+    }
+
+    bool32 has_eaten = state->head_x == state->egg_x && state->head_y == state->egg_y;
+    mcts_state__set_move(state, state->moves_first + state->length, state->direction);
+    if (has_eaten)
+    {
+        if (!mcts_state__spawn_egg(state))
+        {
+            state->is_over = 1;
+            state->has_won = 1;
+        }
+        state->length++;
+    }
+    else
+    {
+        // The tail follows the oldest move
+        uint8 tail_move = mcts_state__get_move(state, state->moves_first);
+        mcts_state__set_occupied(state, mcts_state__cell(state, state->tail_x, state->tail_y), 0);
+        int32 tail_x = state->tail_x;
+        int32 tail_y = state->tail_y;
+        mcts__direction_step(tail_move, &tail_x, &tail_y);
+        state->tail_x = (int16)tail_x;
+        state->tail_y = (int16)tail_y;
+        state->moves_first = (uint16)((state->moves_first + 1) % MCTS_MAX_CELLS);
+    }
+
+    int32 x = state->head_x;
+    int32 y = state->head_y;
+    mcts__direction_step(state->direction, &x, &y);
+    state->head_x = (int16)x;
+    state->head_y = (int16)y;
+
+    if (x < 0 || x >= (int32)state->x_grids || y < 0 || y >= (int32)state->y_grids ||
+        mcts_state__is_occupied(state, mcts_state__cell(state, x, y)))
+    {
+        state->is_over = 1;
+    }
+    else
+    {
+        mcts_state__set_occupied(state, mcts_state__cell(state, x, y), 1);
+    }
+
+    return has_eaten;
+}
+
+local_internal bool32 mcts_state__is_safe(const Mcts_State* state, uint8 direction)
+{
+    int32 x = state->head_x;
+    int32 y = state->head_y;
+    mcts__direction_step(direction, &x, &y);
+    return x >= 0 && x < (int32)state->x_grids && y >= 0 && y < (int32)state->y_grids &&
+           !mcts_state__is_occupied(state, mcts_state__cell(state, x, y));
+}
+
+// Rollout policy: half the time the safe move that closes in on the egg, otherwise any safe move
+local_internal uint8 mcts__rollout_direction(Mcts_State* state, uint32* rng)
+{
+    uint8 safe_directions[3];
+    uint32 safe_count = 0;
+    uint8 toward_egg = DIRECTION_NONE;
+    int32 distance = abs(state->egg_x - state->head_x) + abs(state->egg_y - state->head_y);
+
+    for (uint8 direction = DIRECTION_NORTH; direction <= DIRECTION_WEST; direction++)
+    {
+        if (direction == mcts__opposite(state->direction) || !mcts_state__is_safe(state, direction))
+        {
+            continue;
+        }
+        safe_directions[safe_count++] = direction;
+
+        int32 x = state->head_x;
+        int32 y = state->head_y;
+        mcts__direction_step(direction, &x, &y);
+        if (abs(state->egg_x - x) + abs(state->egg_y - y) < distance)
+        {
+            toward_egg = direction;
+        }
+    }
+
+    if (!safe_count)
+    {
+        return state->direction;  // Nowhere to go
+    }
+    uint32 roll = mcts__rand(rng);
+    if (toward_egg != DIRECTION_NONE && (roll & 1))
+    {
+        return toward_egg;
+    }
+    return safe_directions[(roll >> 1) % safe_count];
+}
+
+//=======================================================
+// SEARCH
+//=======================================================
+
+local_internal int32 mcts__add_node(Mcts_Tree* tree)
+{
+    Mcts_Node node = {};
+    for (uint32 i = 0; i < 4; i++)
+    {
+        node.children[i] = -1;
+    }
+    tree->nodes.push_back(node);
+    return (int32)tree->nodes.size() - 1;
+}
+
+local_internal void mcts__iterate(Mcts_Tree* tree, const Mcts_State* root)
+{
+    Mcts_State state = *root;
+    int32 path[MCTS_MAX_TREE_DEPTH + 1];
+    uint32 path_length = 0;
+    path[path_length++] = 0;
+
+    real32 egg_value = 0;  // Discounted by how long the first egg took, later ones don't count
+    real32 discount = 1.0f;
+    real32 discount_factor = 1.0f - MCTS_DISCOUNT_RATE / ((real32)root->x_grids + root->y_grids);
+
+    {  // Selection and expansion
+        int32 node_index = 0;
+        while (!state.is_over && path_length <= MCTS_MAX_TREE_DEPTH)
+        {
+            Mcts_Node* node = &tree->nodes[node_index];
+            uint8 reverse = mcts__opposite(state.direction);
+
+            // Moves that crash straight away only score 0 and drag down everything near a wall, so they're left out
+            // unless there's nothing else
+            bool32 has_safe_move = 0;
+            for (uint8 direction = DIRECTION_NORTH; direction <= DIRECTION_WEST; direction++)
+            {
+                has_safe_move |= direction != reverse && mcts_state__is_safe(&state, direction);
+            }
+
+            // Try a random unexpanded move first, then the best by UCB1
+            uint8 unexpanded[4];
+            uint32 unexpanded_count = 0;
+            uint8 best_direction = DIRECTION_NONE;
+            real32 best_score = -1.0f;
+            real32 log_visits = logf((real32)(node->visit_count + 1));
+            for (uint8 direction = DIRECTION_NORTH; direction <= DIRECTION_WEST; direction++)
+            {
+                if (direction == reverse || (has_safe_move && !mcts_state__is_safe(&state, direction)))
+                {
+                    continue;
+                }
+                int32 child_index = node->children[direction - 1];
+                if (child_index < 0)
+                {
+                    unexpanded[unexpanded_count++] = direction;
+                    continue;
+                }
+                Mcts_Node* child = &tree->nodes[child_index];
+                real32 score = child->total_value / child->visit_count +
+                               MCTS_EXPLORATION * sqrtf(log_visits / child->visit_count);
+                if (score > best_score)
+                {
+                    best_score = score;
+                    best_direction = direction;
+                }
+            }
+
+            bool32 is_expanding = unexpanded_count && tree->nodes.size() < MCTS_MAX_NODES_PER_TREE;
+            uint8 direction = best_direction;
+            if (is_expanding)
+            {
+                direction = unexpanded[mcts__rand(&tree->rng) % unexpanded_count];
+                int32 child_index = mcts__add_node(tree);
+                tree->nodes[node_index].children[direction - 1] = child_index;
+            }
+            if (direction == DIRECTION_NONE)
+            {
+                break;  // Out of nodes and nothing expanded here yet, roll out from this node
+            }
+
+            bool32 has_eaten = mcts_state__step(&state, direction);
+            egg_value = egg_value == 0 && has_eaten ? discount : egg_value;
+            discount *= discount_factor;
+            node_index = tree->nodes[node_index].children[direction - 1];
+            path[path_length++] = node_index;
+
+            if (is_expanding)
+            {
+                break;
+            }
+        }
+    }
+
+    {  // Rollout, long enough to cross the board and get to an egg
+        uint32 rollout_depth = 2 * ((uint32)state.x_grids + state.y_grids);
+        for (uint32 i = 0; i < rollout_depth && !state.is_over; i++)
+        {
+            bool32 has_eaten = mcts_state__step(&state, mcts__rollout_direction(&state, &tree->rng));
+            egg_value = egg_value == 0 && has_eaten ? discount : egg_value;
+            discount *= discount_factor;
+        }
+    }
+
+    // Half for still being alive (or having won), half for getting to the egg quickly
+    bool32 is_alive = !state.is_over || state.has_won;
+    real32 value = (is_alive ? 0.5f : 0.0f) + 0.5f * egg_value;
+
+    for (uint32 i = 0; i < path_length; i++)
+    {
+        Mcts_Node* node = &tree->nodes[path[i]];
+        node->visit_count++;
+        node->total_value += value;
+    }
+    tree->iteration_count++;
+}
+
+// A pool task: searches one tree for a slice of iterations, then queues itself again until the budget is up
+local_internal void mcts__search_slice(Thread_Pool* pool, void* data)
+{
+    Mcts_Tree* tree = (Mcts_Tree*)data;
+    Mcts_Player* player = tree->player;
+
+    for (uint32 i = 0; i < MCTS_ITERATIONS_PER_SLICE; i++)
+    {
+        mcts__iterate(tree, &player->root);
+    }
+
+    if (std::chrono::steady_clock::now() < player->deadline)
+    {
+        thread_pool__submit_signal(pool, mcts__search_slice, tree, &player->searching);
+    }
+}
+
+void mcts__init(Mcts_Player* player, Thread_Pool* pool, real32 move_budget__ms)
+{
+    player->pool = pool;
+    player->move_budget__ms = move_budget__ms;
+    player->trees.resize(pool->queue_count);
+    for (uint32 i = 0; i < player->trees.size(); i++)
+    {
+        Mcts_Tree* tree = &player->trees[i];
+        tree->player = player;
+        tree->nodes.reserve(MCTS_MAX_NODES_PER_TREE);
+        tree->rng = 0x9E3779B9u * (i + 1);
+    }
+    player->last_rollouts_per_second = 0;
+    player->last_tree_size = 0;
+    player->total_rollouts = 0;
+    player->total_search__seconds = 0;
+}
+
+// Searches for move_budget__ms and returns the direction for the snake's next jump
+Direction mcts__choose_direction(Mcts_Player* player, Snake_Simulation* sim)
+{
+    if (!mcts_state__from_simulation(&player->root, sim, sim->rng ^ (sim->ticks * 0x85EBCA6Bu)))
+    {
+        return sim->current_direction;
+    }
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    player->deadline = start + std::chrono::microseconds((int64)(player->move_budget__ms * 1000.0f));
+
+    for (uint32 i = 0; i < player->trees.size(); i++)
+    {
+        Mcts_Tree* tree = &player->trees[i];
+        tree->nodes.clear();
+        tree->iteration_count = 0;
+        mcts__add_node(tree);
+        thread_pool__submit_signal(player->pool, mcts__search_slice, tree, &player->searching);
+    }
+    thread_pool__wait_for(player->pool, &player->searching);
+
+    real64 seconds = std::chrono::duration<real64>(std::chrono::steady_clock::now() - start).count();
+
+    // Root-parallel merge: the move the trees visited most between them
+    uint64 visits[4] = {};
+    uint64 rollouts = 0;
+    uint32 tree_size = 0;
+    for (uint32 i = 0; i < player->trees.size(); i++)
+    {
+        Mcts_Tree* tree = &player->trees[i];
+        for (uint32 direction = 0; direction < 4; direction++)
+        {
+            int32 child_index = tree->nodes[0].children[direction];
+            visits[direction] += child_index >= 0 ? tree->nodes[child_index].visit_count : 0;
+        }
+        rollouts += tree->iteration_count;
+        tree_size += (uint32)tree->nodes.size();
+    }
+
+    Direction best_direction = sim->current_direction;
+    uint64 best_visits = 0;
+    for (uint32 direction = 0; direction < 4; direction++)
+    {
+        if (visits[direction] > best_visits)
+        {
+            best_visits = visits[direction];
+            best_direction = (Direction)(direction + 1);
+        }
+    }
+
+    player->last_rollouts_per_second = seconds > 0 ? (real32)(rollouts / seconds) : 0.0f;
+    player->last_tree_size = tree_size;
+    player->total_rollouts += rollouts;
+    player->total_search__seconds += seconds;
+
+    return best_direction;
+}
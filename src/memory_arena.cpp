@@ -0,0 +1,71 @@
+// Memory arena
+//
+// One block allocated up front that callers carve pieces out of with a bump pointer. There's no freeing individual
+// pieces: clear the whole arena and push again (e.g. when a scene resets). Keeps per-tick code free of heap allocation.
+//
+// NOTE: No SDL in here, the headless runner uses it too.
+
+#define MEMORY_ARENA_DEFAULT_ALIGNMENT 16
+
+struct Memory_Arena
+{
+    uint8* base;
+    size_t size;  // In bytes
+    size_t used;  // In bytes
+};
+
+bool32 memory_arena__init(Memory_Arena* arena, size_t size)
+{
+    arena->base = (uint8*)malloc(size);
+    arena->size = arena->base ? size : 0;
+    arena->used = 0;
+    if (!arena->base)
+    {
+        fprintf(stderr, "ERROR::MEMORY_ARENA: Failed to allocate %zu bytes\n", size);
+        return 0;
+    }
+    return 1;
+}
+
+void memory_arena__free(Memory_Arena* arena)
+{
+    free(arena->base);
+    arena->base = 0;
+    arena->size = 0;
+    arena->used = 0;
+}
+
+// Makes sure the arena can hold at least `size` bytes, throwing away whatever was in it
+bool32 memory_arena__reserve(Memory_Arena* arena, size_t size)
+{
+    if (arena->size >= size)
+    {
+        arena->used = 0;
+        return 1;
+    }
+    memory_arena__free(arena);
+    return memory_arena__init(arena, size);
+}
+
+void memory_arena__clear(Memory_Arena* arena)
+{
+    arena->used = 0;
+}
+
+void* memory_arena__push(Memory_Arena* arena, size_t size, size_t alignment = MEMORY_ARENA_DEFAULT_ALIGNMENT)
+{
+    size_t start = (arena->used + alignment - 1) & ~(alignment - 1);
+    if (start + size > arena->size)
+    {
+        // Whoever sized the arena got their sums wrong
+        fprintf(stderr, "ERROR::MEMORY_ARENA: Pushing %zu bytes overflows a %zu byte arena\n", size, arena->size);
+        abort();
+    }
+    arena->used = start + size;
+    return arena->base + start;
+}
+
+#define memory_arena__push_array(arena, type, count) (type*)memory_arena__push((arena), sizeof(type) * (count))
+
+// How much room an array pushed with memory_arena__push_array needs, including worst case alignment padding
+#define memory_arena__array_size(type, count) (sizeof(type) * (count) + MEMORY_ARENA_DEFAULT_ALIGNMENT)
@@ -0,0 +1,706 @@
+// Netplay
+//
+// Head-to-head versus (versus_simulation.cpp) between two machines, with rollback so neither player ever waits on the
+// network to see their own input.
+//
+// Each tick, both sides step straight away with their own input. For the other player they guess "no turn", which is
+// what almost every tick is. Inputs go out stamped with their tick over UDP. Every packet repeats all the inputs the
+// other side hasn't acknowledged yet, so a lost packet only costs latency. When the real input for a past tick arrives
+// and differs from the guess, the session puts back the state it saved before that tick and re-simulates up to the
+// present with the right inputs, all within the same frame. States are saved every tick, which is cheap because the
+// versus state is one flat copy.
+//
+// A session never waits on the other side unless it gets NETPLAY_MAX_ROLLBACK_TICKS ahead of the remote inputs it has,
+// then it stalls until they catch up. To stop one machine from always running ahead (and always rolling back), each
+// packet says how far ahead its sender is. The side that's further ahead sits out the odd tick until the two even out.
+//
+// Every NETPLAY_CHECK_INTERVAL_TICKS, once both inputs for a tick are known, each side hashes the game and sends the
+// hash along, so the two notice if they ever stop playing the same game.
+//
+// The transport is either a UDP socket or an in-process loopback link. The loopback delays, jitters and drops packets
+// like a bad network would, so everything can be tested on one machine (headless --netplay-loopback).
+//
+// Usage:
+//     netplay_udp__open(&session.transport, port, 0, 0);  netplay__host(&session, x_grids, y_grids, seed);
+//     netplay_udp__open(&session.transport, 0, host, port);  netplay__join(&session);
+//     every tick:
+//         if (netplay__advance(&session, local_input, dt))
+//             local_input = DIRECTION_NONE;  // Used up, otherwise hold on to it for the next try
+//         draw session.sim
+//
+// Needs replay.cpp (packet encoding) and versus_simulation.cpp included before it.
+
+#if defined(_WIN32)
+#include <winsock2.h>
+#include <ws2tcpip.h>
+typedef SOCKET Netplay_Socket;
+typedef int Netplay_Address_Size;
+#define NETPLAY_INVALID_SOCKET INVALID_SOCKET
+#else
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+typedef int Netplay_Socket;
+typedef socklen_t Netplay_Address_Size;
+#define NETPLAY_INVALID_SOCKET -1
+#endif
+
+#define NETPLAY_VERSION 1
+#define NETPLAY_DEFAULT_PORT 27015
+#define NETPLAY_MAX_ROLLBACK_TICKS 32       // How far past the remote inputs it has a session runs before it stalls
+#define NETPLAY_SAVED_STATE_COUNT 64        // Ring of states before each tick, has to cover the rollback window
+#define NETPLAY_INPUT_HISTORY_TICKS 128     // Ring of inputs, unacknowledged local ones get resent from it
+#define NETPLAY_CHECK_INTERVAL_TICKS 16     // Ticks between hash checks
+#define NETPLAY_CHECK_HISTORY 8             // Own hashes kept around for when the remote one comes in late
+#define NETPLAY_TIME_SYNC_INTERVAL_TICKS 10  // At most one tick sat out this often
+#define NETPLAY_MAX_PACKET_SIZE 256
+#define NETPLAY_NO_CHECK 0xFFFFFFFFu
+
+typedef enum
+{
+    NETPLAY_PACKET_HELLO = 1,  // Joining side, until it gets a welcome
+    NETPLAY_PACKET_WELCOME,    // Host, with the board and seed, until the first inputs come back
+    NETPLAY_PACKET_INPUTS,
+} Netplay_Packet_Type;
+
+//=======================================================
+// TRANSPORTS
+//=======================================================
+
+typedef enum
+{
+    NETPLAY_TRANSPORT_NONE,
+    NETPLAY_TRANSPORT_UDP,
+    NETPLAY_TRANSPORT_LOOPBACK,
+} Netplay_Transport_Kind;
+
+struct Netplay_Loopback_Packet
+{
+    real64 delivery_time__ms;
+    uint32 size;
+    uint8 data[NETPLAY_MAX_PACKET_SIZE];
+};
+
+// Both ends of a pretend network in one process. Whoever runs the two sessions moves now__ms along.
+struct Netplay_Loopback
+{
+    real32 latency__ms;  // One way
+    real32 jitter__ms;   // Up to this much extra per packet, so they can arrive out of order
+    real32 loss;         // Chance a packet gets dropped, 0 to 1
+    uint32 rng;
+
+    real64 now__ms;
+    std::vector<Netplay_Loopback_Packet> in_flight[2];  // On their way to end 0 and end 1
+
+    uint64 sent_count;
+    uint64 dropped_count;
+};
+
+struct Netplay_Transport
+{
+    Netplay_Transport_Kind kind;
+
+    // UDP
+    Netplay_Socket socket;
+    sockaddr_in peer;  // The host learns it from the first packet that comes in
+    bool32 has_peer;
+
+    // Loopback
+    Netplay_Loopback* loopback;
+    uint32 loopback_end;
+};
+
+void netplay_transport__close(Netplay_Transport* transport)
+{
+    if (transport->kind == NETPLAY_TRANSPORT_UDP)
+    {
+#if defined(_WIN32)
+        if (transport->socket != NETPLAY_INVALID_SOCKET)
+        {
+            closesocket(transport->socket);
+        }
+        WSACleanup();
+#else
+        if (transport->socket != NETPLAY_INVALID_SOCKET)
+        {
+            close(transport->socket);
+        }
+#endif
+    }
+    transport->kind = NETPLAY_TRANSPORT_NONE;
+}
+
+// Binds port (0 for any) and, if peer_host is set, sends to peer_host:peer_port. Returns 0 on failure.
+bool32 netplay_udp__open(Netplay_Transport* transport, uint16 port, const char* peer_host, uint16 peer_port)
+{
+#if defined(_WIN32)
+    WSADATA wsa_data;
+    if (WSAStartup(MAKEWORD(2, 2), &wsa_data) != 0)
+    {
+        fprintf(stderr, "ERROR::NETPLAY: Winsock didn't start\n");
+        return 0;
+    }
+#endif
+
+    transport->kind = NETPLAY_TRANSPORT_UDP;
+    transport->has_peer = 0;
+    transport->socket = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+    if (transport->socket == NETPLAY_INVALID_SOCKET)
+    {
+        fprintf(stderr, "ERROR::NETPLAY: Couldn't create a UDP socket\n");
+        netplay_transport__close(transport);
+        return 0;
+    }
+
+    sockaddr_in address = {};
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_ANY);
+    address.sin_port = htons(port);
+    if (bind(transport->socket, (sockaddr*)&address, (Netplay_Address_Size)sizeof(address)) != 0)
+    {
+        fprintf(stderr, "ERROR::NETPLAY: Couldn't bind UDP port %u\n", port);
+        netplay_transport__close(transport);
+        return 0;
+    }
+
+#if defined(_WIN32)
+    u_long is_non_blocking = 1;
+    ioctlsocket(transport->socket, FIONBIO, &is_non_blocking);
+#else
+    fcntl(transport->socket, F_SETFL, fcntl(transport->socket, F_GETFL, 0) | O_NONBLOCK);
+#endif
+
+    if (peer_host)
+    {
+        addrinfo hints = {};
+        hints.ai_family = AF_INET;
+        hints.ai_socktype = SOCK_DGRAM;
+        addrinfo* found = 0;
+        if (getaddrinfo(peer_host, 0, &hints, &found) != 0 || !found)
+        {
+            fprintf(stderr, "ERROR::NETPLAY: Couldn't find host %s\n", peer_host);
+            netplay_transport__close(transport);
+            return 0;
+        }
+        memcpy(&transport->peer, found->ai_addr, sizeof(transport->peer));
+        transport->peer.sin_port = htons(peer_port);
+        transport->has_peer = 1;
+        freeaddrinfo(found);
+    }
+
+    return 1;
+}
+
+void netplay_loopback__connect(Netplay_Loopback* loopback, Netplay_Transport* a, Netplay_Transport* b)
+{
+    a->kind = NETPLAY_TRANSPORT_LOOPBACK;
+    a->loopback = loopback;
+    a->loopback_end = 0;
+    b->kind = NETPLAY_TRANSPORT_LOOPBACK;
+    b->loopback = loopback;
+    b->loopback_end = 1;
+}
+
+local_internal real32 netplay_loopback__random(Netplay_Loopback* loopback)
+{
+    return (real32)(snake_rng__next(&loopback->rng) >> 8) / (real32)(1 << 24);  // The LCG's top bits, 0 to 1
+}
+
+void netplay_transport__send(Netplay_Transport* transport, const uint8* data, uint32 size)
+{
+    assert(size <= NETPLAY_MAX_PACKET_SIZE);
+
+    if (transport->kind == NETPLAY_TRANSPORT_UDP && transport->has_peer)
+    {
+        sendto(transport->socket,
+               (const char*)data,
+               (int)size,
+               0,
+               (sockaddr*)&transport->peer,
+               (Netplay_Address_Size)sizeof(transport->peer));
+    }
+    else if (transport->kind == NETPLAY_TRANSPORT_LOOPBACK)
+    {
+        Netplay_Loopback* loopback = transport->loopback;
+        loopback->sent_count++;
+        if (netplay_loopback__random(loopback) < loopback->loss)
+        {
+            loopback->dropped_count++;
+            return;
+        }
+
+        Netplay_Loopback_Packet packet;
+        packet.delivery_time__ms =
+            loopback->now__ms + loopback->latency__ms + loopback->jitter__ms * netplay_loopback__random(loopback);
+        packet.size = size;
+        memcpy(packet.data, data, size);
+        loopback->in_flight[1 - transport->loopback_end].push_back(packet);
+    }
+}
+
+// Copies the next packet that has arrived into buffer and returns its size, or 0 if there isn't one
+uint32 netplay_transport__receive(Netplay_Transport* transport, uint8* buffer, uint32 capacity)
+{
+    if (transport->kind == NETPLAY_TRANSPORT_UDP)
+    {
+        for (;;)
+        {
+            sockaddr_in from = {};
+            Netplay_Address_Size from_size = (Netplay_Address_Size)sizeof(from);
+            int received =
+                (int)recvfrom(transport->socket, (char*)buffer, (int)capacity, 0, (sockaddr*)&from, &from_size);
+            if (received <= 0)
+            {
+                return 0;  // Nothing waiting (or an error, which for UDP means the same)
+            }
+
+            if (!transport->has_peer)
+            {
+                transport->peer = from;
+                transport->has_peer = 1;
+            }
+            if (from.sin_addr.s_addr == transport->peer.sin_addr.s_addr && from.sin_port == transport->peer.sin_port)
+            {
+                return (uint32)received;
+            }
+            // Someone else, ignore it
+        }
+    }
+    else if (transport->kind == NETPLAY_TRANSPORT_LOOPBACK)
+    {
+        // The earliest one that's due, late ones can overtake it
+        Netplay_Loopback* loopback = transport->loopback;
+        std::vector<Netplay_Loopback_Packet>* in_flight = &loopback->in_flight[transport->loopback_end];
+        uint32 earliest = (uint32)in_flight->size();
+        for (uint32 i = 0; i < in_flight->size(); i++)
+        {
+            real64 delivery_time__ms = (*in_flight)[i].delivery_time__ms;
+            if (delivery_time__ms <= loopback->now__ms &&
+                (earliest == in_flight->size() || delivery_time__ms < (*in_flight)[earliest].delivery_time__ms))
+            {
+                earliest = i;
+            }
+        }
+        if (earliest == in_flight->size() || (*in_flight)[earliest].size > capacity)
+        {
+            return 0;
+        }
+
+        uint32 size = (*in_flight)[earliest].size;
+        memcpy(buffer, (*in_flight)[earliest].data, size);
+        (*in_flight)[earliest] = in_flight->back();
+        in_flight->pop_back();
+        return size;
+    }
+
+    return 0;
+}
+
+//=======================================================
+// SESSION
+//=======================================================
+
+struct Netplay_Stats
+{
+    uint64 tick_count;       // Ticks the game moved on
+    uint64 stall_count;      // Advances that waited because the remote inputs were too far behind
+    uint64 time_sync_count;  // Ticks sat out to let the other side catch up
+    uint64 rollback_count;
+    uint64 resimulated_tick_count;
+    uint32 max_resimulated_ticks;  // In one advance
+    real64 resimulate__seconds;
+    real64 max_resimulate__seconds;
+
+    uint64 hash_check_count;
+    uint64 desync_count;
+    uint64 packets_sent;
+    uint64 packets_received;
+};
+
+struct Netplay_Check
+{
+    uint32 tick;  // NETPLAY_NO_CHECK if unused
+    uint64 hash;
+};
+
+struct Netplay_Session
+{
+    Netplay_Transport transport;
+    bool32 is_host;
+    bool32 is_started;        // Both sides know the board and the seed
+    bool32 has_peer_started;  // Host: the joining side has started, so the welcomes can stop
+    uint32 local_player;      // The host is player 0
+    uint32 x_grids;
+    uint32 y_grids;
+    uint32 seed;
+
+    Versus_Simulation sim;     // The present, with guesses for remote inputs that haven't come in
+    uint32 tick;               // Ticks simulated
+    uint32 remote_tick_count;  // Remote inputs known for ticks [0, remote_tick_count)
+    uint32 acked_tick_count;   // Local inputs the other side has
+    int32 remote_advantage;    // How far the other side said it was ahead of our inputs
+    uint32 time_sync_tick;     // Last tick sat out
+    bool32 needs_rollback;
+    uint32 rollback_tick;  // Oldest tick whose guess turned out wrong
+
+    uint8 inputs[NETPLAY_INPUT_HISTORY_TICKS][VERSUS_PLAYER_COUNT];  // By tick
+    Versus_Simulation saved[NETPLAY_SAVED_STATE_COUNT];              // The state before each tick, by tick
+
+    Netplay_Check checks[NETPLAY_CHECK_HISTORY];  // Own hashes, by tick / NETPLAY_CHECK_INTERVAL_TICKS
+    uint32 next_check_tick;
+    Netplay_Check latest_check;  // Sent with every packet
+    Netplay_Check remote_check;  // Newest one from the other side, compared as soon as there's an own one
+    uint32 compared_check_tick;  // Newest tick compared so far, + 1
+
+    Netplay_Stats stats;
+    std::vector<uint8> packet;  // Being written or read
+};
+
+local_internal void netplay__begin(Netplay_Session* session)
+{
+    session->tick = 0;
+    session->remote_tick_count = 0;
+    session->acked_tick_count = 0;
+    session->remote_advantage = 0;
+    session->time_sync_tick = NETPLAY_NO_CHECK;
+    session->needs_rollback = 0;
+    session->next_check_tick = 0;
+    session->latest_check.tick = NETPLAY_NO_CHECK;
+    session->remote_check.tick = NETPLAY_NO_CHECK;
+    session->compared_check_tick = 0;
+    for (uint32 i = 0; i < NETPLAY_CHECK_HISTORY; i++)
+    {
+        session->checks[i].tick = NETPLAY_NO_CHECK;
+    }
+    session->stats = Netplay_Stats();
+    session->is_started = versus_simulation__reset(&session->sim, session->x_grids, session->y_grids, session->seed);
+}
+
+// The transport has to be set up already. The game starts once someone joins.
+void netplay__host(Netplay_Session* session, uint32 x_grids, uint32 y_grids, uint32 seed)
+{
+    session->is_host = 1;
+    session->is_started = 0;
+    session->has_peer_started = 0;
+    session->local_player = 0;
+    session->x_grids = x_grids;
+    session->y_grids = y_grids;
+    session->seed = seed;
+}
+
+// The transport has to be set up already, pointing at the host. The game starts once the host answers.
+void netplay__join(Netplay_Session* session)
+{
+    session->is_host = 0;
+    session->is_started = 0;
+    session->local_player = 1;
+}
+
+//=======================================================
+// PACKETS
+//=======================================================
+
+local_internal void netplay__begin_packet(Netplay_Session* session, Netplay_Packet_Type type)
+{
+    session->packet.clear();
+    session->packet.push_back('S');
+    session->packet.push_back('N');
+    session->packet.push_back('K');
+    session->packet.push_back('N');
+    session->packet.push_back(NETPLAY_VERSION);
+    session->packet.push_back((uint8)type);
+}
+
+local_internal void netplay__send_packet(Netplay_Session* session)
+{
+    netplay_transport__send(&session->transport, &session->packet[0], (uint32)session->packet.size());
+    session->stats.packets_sent++;
+}
+
+// Every local input the other side hasn't acknowledged, plus what it needs for acks, time sync and hash checks
+local_internal void netplay__send_inputs(Netplay_Session* session)
+{
+    uint32 first_tick = session->acked_tick_count;
+    uint32 count = session->tick - first_tick;
+    assert(count <= NETPLAY_INPUT_HISTORY_TICKS);
+
+    netplay__begin_packet(session, NETPLAY_PACKET_INPUTS);
+    replay__write_u32(&session->packet, first_tick);
+    replay__write_u32(&session->packet, count);
+    replay__write_u32(&session->packet, session->remote_tick_count);
+    replay__write_u32(&session->packet, (uint32)(int32)(session->tick - session->remote_tick_count));
+    replay__write_u32(&session->packet, session->latest_check.tick);
+    replay__write_u64(&session->packet, session->latest_check.hash);
+    for (uint32 tick = first_tick; tick < session->tick; tick++)
+    {
+        session->packet.push_back(session->inputs[tick % NETPLAY_INPUT_HISTORY_TICKS][session->local_player]);
+    }
+    netplay__send_packet(session);
+}
+
+local_internal void netplay__compare_checks(Netplay_Session* session)
+{
+    Netplay_Check* remote = &session->remote_check;
+    if (remote->tick == NETPLAY_NO_CHECK || remote->tick < session->compared_check_tick)
+    {
+        return;
+    }
+
+    Netplay_Check* own = &session->checks[(remote->tick / NETPLAY_CHECK_INTERVAL_TICKS) % NETPLAY_CHECK_HISTORY];
+    if (own->tick != remote->tick)
+    {
+        return;  // Haven't got there yet (or it's too old to tell)
+    }
+
+    session->stats.hash_check_count++;
+    if (own->hash != remote->hash)
+    {
+        if (!session->stats.desync_count)
+        {
+            fprintf(stderr, "ERROR::NETPLAY: The two games stopped matching at tick %u\n", own->tick);
+        }
+        session->stats.desync_count++;
+    }
+    session->compared_check_tick = remote->tick + 1;
+}
+
+local_internal void netplay__read_inputs(Netplay_Session* session, Replay__Reader* reader)
+{
+    uint32 first_tick = (uint32)replay__read_fixed(reader, 4);
+    uint32 count = (uint32)replay__read_fixed(reader, 4);
+    uint32 ack = (uint32)replay__read_fixed(reader, 4);
+    int32 advantage = (int32)(uint32)replay__read_fixed(reader, 4);
+    Netplay_Check check;
+    check.tick = (uint32)replay__read_fixed(reader, 4);
+    check.hash = replay__read_fixed(reader, 8);
+    if (reader->has_failed || reader->end - reader->at < (ptrdiff_t)count)
+    {
+        return;
+    }
+
+    if (ack > session->acked_tick_count && ack <= session->tick)
+    {
+        session->acked_tick_count = ack;
+    }
+    if (first_tick + count >= session->remote_tick_count)
+    {
+        session->remote_advantage = advantage;  // From the newest packet (or near enough, they can come out of order)
+    }
+
+    uint32 remote_player = 1 - session->local_player;
+    for (uint32 i = 0; i < count; i++)
+    {
+        uint32 tick = first_tick + i;
+        if (tick != session->remote_tick_count)
+        {
+            continue;  // Already have it (a gap can't happen, they always resend from our ack)
+        }
+
+        uint8 input = reader->at[i] <= DIRECTION_WEST ? reader->at[i] : (uint8)DIRECTION_NONE;
+        uint8* slot = &session->inputs[tick % NETPLAY_INPUT_HISTORY_TICKS][remote_player];
+        if (tick < session->tick && *slot != input)
+        {
+            // Guessed wrong, everything from that tick on has to be simulated again
+            if (!session->needs_rollback || tick < session->rollback_tick)
+            {
+                session->rollback_tick = tick;
+            }
+            session->needs_rollback = 1;
+        }
+        *slot = input;
+        session->remote_tick_count++;
+    }
+
+    if (check.tick != NETPLAY_NO_CHECK && check.tick % NETPLAY_CHECK_INTERVAL_TICKS == 0 &&
+        (session->remote_check.tick == NETPLAY_NO_CHECK || check.tick > session->remote_check.tick))
+    {
+        session->remote_check = check;
+    }
+}
+
+local_internal void netplay__receive(Netplay_Session* session)
+{
+    uint8 buffer[NETPLAY_MAX_PACKET_SIZE];
+    for (;;)
+    {
+        uint32 size = netplay_transport__receive(&session->transport, buffer, sizeof(buffer));
+        if (!size)
+        {
+            break;
+        }
+        if (size < 6 || buffer[0] != 'S' || buffer[1] != 'N' || buffer[2] != 'K' || buffer[3] != 'N' ||
+            buffer[4] != NETPLAY_VERSION)
+        {
+            continue;  // Not ours
+        }
+        session->stats.packets_received++;
+
+        Replay__Reader reader = {buffer + 6, buffer + size, 0};
+        switch (buffer[5])
+        {
+            case NETPLAY_PACKET_HELLO:
+            {
+                if (session->is_host && !session->is_started)
+                {
+                    netplay__begin(session);
+                }
+            }
+            break;
+            case NETPLAY_PACKET_WELCOME:
+            {
+                if (!session->is_host && !session->is_started)
+                {
+                    session->x_grids = (uint32)replay__read_fixed(&reader, 2);
+                    session->y_grids = (uint32)replay__read_fixed(&reader, 2);
+                    session->seed = (uint32)replay__read_fixed(&reader, 4);
+                    if (!reader.has_failed)
+                    {
+                        netplay__begin(session);
+                    }
+                }
+            }
+            break;
+            case NETPLAY_PACKET_INPUTS:
+            {
+                if (session->is_started)
+                {
+                    session->has_peer_started = 1;
+                    netplay__read_inputs(session, &reader);
+                }
+            }
+            break;
+        }
+    }
+}
+
+//=======================================================
+// ROLLBACK
+//=======================================================
+
+local_internal Versus_Simulation* netplay__saved_state(Netplay_Session* session, uint32 tick)
+{
+    assert(session->tick - tick < NETPLAY_SAVED_STATE_COUNT);
+    return &session->saved[tick % NETPLAY_SAVED_STATE_COUNT];
+}
+
+local_internal void netplay__roll_back(Netplay_Session* session, real32 dt_s)
+{
+    if (!session->needs_rollback)
+    {
+        return;
+    }
+    session->needs_rollback = 0;
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+    uint32 from_tick = session->rollback_tick;
+    memcpy(&session->sim, netplay__saved_state(session, from_tick), sizeof(session->sim));
+    for (uint32 tick = from_tick; tick < session->tick; tick++)
+    {
+        if (tick != from_tick)
+        {
+            memcpy(netplay__saved_state(session, tick), &session->sim, sizeof(session->sim));
+        }
+        versus_simulation__step(&session->sim, session->inputs[tick % NETPLAY_INPUT_HISTORY_TICKS], dt_s);
+    }
+
+    real64 seconds = std::chrono::duration<real64>(std::chrono::steady_clock::now() - start).count();
+    uint32 resimulated_tick_count = session->tick - from_tick;
+    Netplay_Stats* stats = &session->stats;
+    stats->rollback_count++;
+    stats->resimulated_tick_count += resimulated_tick_count;
+    stats->max_resimulated_ticks =
+        resimulated_tick_count > stats->max_resimulated_ticks ? resimulated_tick_count : stats->max_resimulated_ticks;
+    stats->resimulate__seconds += seconds;
+    stats->max_resimulate__seconds =
+        seconds > stats->max_resimulate__seconds ? seconds : stats->max_resimulate__seconds;
+}
+
+// Hashes the ticks due a check that both players' inputs are known for
+local_internal void netplay__record_checks(Netplay_Session* session)
+{
+    uint32 confirmed_tick = session->remote_tick_count < session->tick ? session->remote_tick_count : session->tick;
+    for (; session->next_check_tick <= confirmed_tick; session->next_check_tick += NETPLAY_CHECK_INTERVAL_TICKS)
+    {
+        uint32 tick = session->next_check_tick;
+        const Versus_Simulation* state = tick == session->tick ? &session->sim : netplay__saved_state(session, tick);
+
+        Netplay_Check* check = &session->checks[(tick / NETPLAY_CHECK_INTERVAL_TICKS) % NETPLAY_CHECK_HISTORY];
+        check->tick = tick;
+        check->hash = versus_simulation__hash(state);
+        session->latest_check = *check;
+    }
+    netplay__compare_checks(session);
+}
+
+// Call once per simulation tick. Returns 1 if the game moved on a tick using local_input, 0 if it's waiting on the
+// other side (still connecting, too far ahead) and local_input should be tried again next time.
+bool32 netplay__advance(Netplay_Session* session, Direction local_input, real32 dt_s)
+{
+    netplay__receive(session);
+
+    if (!session->is_started)
+    {
+        if (!session->is_host)
+        {
+            netplay__begin_packet(session, NETPLAY_PACKET_HELLO);
+            netplay__send_packet(session);
+        }
+        return 0;
+    }
+
+    if (session->is_host && !session->has_peer_started)
+    {
+        netplay__begin_packet(session, NETPLAY_PACKET_WELCOME);
+        replay__write_u32(&session->packet, session->x_grids | (session->y_grids << 16));
+        replay__write_u32(&session->packet, session->seed);
+        netplay__send_packet(session);
+    }
+
+    netplay__roll_back(session, dt_s);
+    netplay__record_checks(session);
+
+    {  // Wait if the other side is too far behind, or sit out a tick if we keep running ahead of it
+        int32 advantage = (int32)(session->tick - session->remote_tick_count);
+        bool32 is_too_far_ahead = advantage >= NETPLAY_MAX_ROLLBACK_TICKS ||
+                                  session->tick - session->acked_tick_count + NETPLAY_MAX_ROLLBACK_TICKS >=
+                                      NETPLAY_INPUT_HISTORY_TICKS;
+        bool32 should_sync = (advantage - session->remote_advantage) / 2 >= 1 &&
+                             session->tick % NETPLAY_TIME_SYNC_INTERVAL_TICKS == 0 &&
+                             session->tick != session->time_sync_tick;
+        if (is_too_far_ahead || should_sync)
+        {
+            if (is_too_far_ahead)
+            {
+                session->stats.stall_count++;
+            }
+            else
+            {
+                session->stats.time_sync_count++;
+                session->time_sync_tick = session->tick;
+            }
+            netplay__send_inputs(session);
+            return 0;
+        }
+    }
+
+    {  // Step with our input and the remote one, or the guess for it
+        uint8* inputs = session->inputs[session->tick % NETPLAY_INPUT_HISTORY_TICKS];
+        inputs[session->local_player] = (uint8)local_input;
+        if (session->tick >= session->remote_tick_count)
+        {
+            inputs[1 - session->local_player] = DIRECTION_NONE;
+        }
+
+        memcpy(netplay__saved_state(session, session->tick), &session->sim, sizeof(session->sim));
+        versus_simulation__step(&session->sim, inputs, dt_s);
+        session->tick++;
+        session->stats.tick_count++;
+    }
+
+    netplay__send_inputs(session);
+    return 1;
+}
@@ -0,0 +1,278 @@
+// Replays
+//
+// A game (snake_simulation.cpp) only depends on the LCG seed, the board size, the fixed simulation step and the
+// directions pushed into the input queue, so that's all a replay stores. Inputs are stamped with the simulation tick
+// they were queued before (ticks only count steps while the game was running, so pausing doesn't matter).
+//
+// File layout (all varints are LEB128):
+//     "SNKR" magic, u8 version
+//     varint seed, varint x_grids, varint y_grids, u32 simulation step (float bits, little endian)
+//     varint input count, then per input: varint ((tick - previous input's tick) << 2 | direction - 1)
+//     varint final tick, u64 final state hash (little endian)
+
+#define REPLAY_VERSION 2  // 2: eggs spawn in the n-th free cell in cell order
+
+struct Replay_Input
+{
+    uint32 tick;
+    uint8 direction;  // Direction enum value (north, east, south or west)
+};
+
+struct Replay
+{
+    uint32 seed;
+    uint32 x_grids;
+    uint32 y_grids;
+    real32 simulation_delta_time__seconds;
+    std::vector<Replay_Input> inputs;
+
+    uint32 final_tick;
+    uint64 final_state_hash;
+};
+
+local_internal void replay__write_varint(std::vector<uint8>* bytes, uint64 value)
+{
+    while (value >= 0x80)
+    {
+        bytes->push_back((uint8)(value | 0x80));
+        value >>= 7;
+    }
+    bytes->push_back((uint8)value);
+}
+
+local_internal void replay__write_u32(std::vector<uint8>* bytes, uint32 value)
+{
+    for (uint32 i = 0; i < 4; i++)
+    {
+        bytes->push_back((uint8)(value >> (8 * i)));
+    }
+}
+
+local_internal void replay__write_u64(std::vector<uint8>* bytes, uint64 value)
+{
+    for (uint32 i = 0; i < 8; i++)
+    {
+        bytes->push_back((uint8)(value >> (8 * i)));
+    }
+}
+
+struct Replay__Reader
+{
+    const uint8* at;
+    const uint8* end;
+    bool32 has_failed;  // Ran off the end of the data
+};
+
+local_internal uint64 replay__read_varint(Replay__Reader* reader)
+{
+    uint64 value = 0;
+    for (uint32 shift = 0; shift < 64; shift += 7)
+    {
+        if (reader->at >= reader->end)
+        {
+            reader->has_failed = 1;
+            return 0;
+        }
+        uint8 byte = *reader->at++;
+        value |= (uint64)(byte & 0x7F) << shift;
+        if (!(byte & 0x80))
+        {
+            return value;
+        }
+    }
+    reader->has_failed = 1;
+    return 0;
+}
+
+local_internal uint64 replay__read_fixed(Replay__Reader* reader, uint32 byte_count)
+{
+    if (reader->end - reader->at < (ptrdiff_t)byte_count)
+    {
+        reader->has_failed = 1;
+        return 0;
+    }
+    uint64 value = 0;
+    for (uint32 i = 0; i < byte_count; i++)
+    {
+        value |= (uint64)reader->at[i] << (8 * i);
+    }
+    reader->at += byte_count;
+    return value;
+}
+
+void replay__encode(const Replay* replay, std::vector<uint8>* bytes)
+{
+    bytes->clear();
+    bytes->push_back('S');
+    bytes->push_back('N');
+    bytes->push_back('K');
+    bytes->push_back('R');
+    bytes->push_back(REPLAY_VERSION);
+
+    replay__write_varint(bytes, replay->seed);
+    replay__write_varint(bytes, replay->x_grids);
+    replay__write_varint(bytes, replay->y_grids);
+    uint32 step_bits;
+    memcpy(&step_bits, &replay->simulation_delta_time__seconds, sizeof(step_bits));
+    replay__write_u32(bytes, step_bits);
+
+    replay__write_varint(bytes, replay->inputs.size());
+    uint32 previous_tick = 0;
+    for (uint32 i = 0; i < replay->inputs.size(); i++)
+    {
+        const Replay_Input* input = &replay->inputs[i];
+        uint64 delta = input->tick - previous_tick;
+        replay__write_varint(bytes, (delta << 2) | (uint64)((input->direction - 1) & 0x3));
+        previous_tick = input->tick;
+    }
+
+    replay__write_varint(bytes, replay->final_tick);
+    replay__write_u64(bytes, replay->final_state_hash);
+}
+
+bool32 replay__decode(Replay* replay, const uint8* data, size_t size)
+{
+    if (size < 5 || memcmp(data, "SNKR", 4) != 0 || data[4] != REPLAY_VERSION)
+    {
+        fprintf(stderr, "ERROR::REPLAY: Not a version %d replay\n", REPLAY_VERSION);
+        return 0;
+    }
+
+    Replay__Reader reader = {};
+    reader.at = data + 5;
+    reader.end = data + size;
+
+    replay->seed = (uint32)replay__read_varint(&reader);
+    replay->x_grids = (uint32)replay__read_varint(&reader);
+    replay->y_grids = (uint32)replay__read_varint(&reader);
+    uint32 step_bits = (uint32)replay__read_fixed(&reader, 4);
+    memcpy(&replay->simulation_delta_time__seconds, &step_bits, sizeof(step_bits));
+
+    uint64 input_count = replay__read_varint(&reader);
+    if (input_count > size)
+    {
+        reader.has_failed = 1;  // Every input takes at least a byte
+    }
+    replay->inputs.clear();
+    uint32 tick = 0;
+    for (uint64 i = 0; i < input_count && !reader.has_failed; i++)
+    {
+        uint64 packed = replay__read_varint(&reader);
+        tick += (uint32)(packed >> 2);
+
+        Replay_Input input = {};
+        input.tick = tick;
+        input.direction = (uint8)((packed & 0x3) + 1);
+        replay->inputs.push_back(input);
+    }
+
+    replay->final_tick = (uint32)replay__read_varint(&reader);
+    replay->final_state_hash = replay__read_fixed(&reader, 8);
+
+    if (reader.has_failed)
+    {
+        fprintf(stderr, "ERROR::REPLAY: Replay data is truncated\n");
+        return 0;
+    }
+    return 1;
+}
+
+bool32 replay__save(const Replay* replay, const char* path)
+{
+    std::vector<uint8> bytes;
+    replay__encode(replay, &bytes);
+
+    FILE* file = fopen(path, "wb");
+    if (!file)
+    {
+        fprintf(stderr, "ERROR::REPLAY: Couldn't open %s for writing\n", path);
+        return 0;
+    }
+    size_t written = fwrite(&bytes[0], 1, bytes.size(), file);
+    fclose(file);
+    return written == bytes.size();
+}
+
+bool32 replay__load(Replay* replay, const char* path)
+{
+    FILE* file = fopen(path, "rb");
+    if (!file)
+    {
+        fprintf(stderr, "ERROR::REPLAY: Couldn't open %s\n", path);
+        return 0;
+    }
+
+    std::vector<uint8> bytes;
+    uint8 buffer[4096];
+    size_t read;
+    while ((read = fread(buffer, 1, sizeof(buffer), file)) > 0)
+    {
+        bytes.insert(bytes.end(), buffer, buffer + read);
+    }
+    fclose(file);
+
+    if (bytes.empty())
+    {
+        fprintf(stderr, "ERROR::REPLAY: %s is empty\n", path);
+        return 0;
+    }
+    return replay__decode(replay, &bytes[0], bytes.size());
+}
+
+// Records every game while a path is set (--record-replay), the file is written when the game ends
+struct Replay_Recorder
+{
+    const char* path;
+    bool32 is_recording;
+    Replay replay;
+};
+
+Replay_Recorder global_replay_recorder;
+
+void replay_recorder__begin(Replay_Recorder* recorder,
+                           uint32 seed,
+                           uint32 x_grids,
+                           uint32 y_grids,
+                           real32 simulation_delta_time__seconds)
+{
+    if (!recorder->path)
+    {
+        return;
+    }
+    recorder->is_recording = 1;
+    recorder->replay.seed = seed;
+    recorder->replay.x_grids = x_grids;
+    recorder->replay.y_grids = y_grids;
+    recorder->replay.simulation_delta_time__seconds = simulation_delta_time__seconds;
+    recorder->replay.inputs.clear();
+}
+
+void replay_recorder__add_input(Replay_Recorder* recorder, uint32 tick, uint8 direction)
+{
+    if (recorder->is_recording)
+    {
+        Replay_Input input = {};
+        input.tick = tick;
+        input.direction = direction;
+        recorder->replay.inputs.push_back(input);
+    }
+}
+
+void replay_recorder__finish(Replay_Recorder* recorder, uint32 final_tick, uint64 final_state_hash)
+{
+    if (!recorder->is_recording)
+    {
+        return;
+    }
+    recorder->is_recording = 0;
+    recorder->replay.final_tick = final_tick;
+    recorder->replay.final_state_hash = final_state_hash;
+
+    if (replay__save(&recorder->replay, recorder->path))
+    {
+        printf("Saved replay to %s (%u inputs, %u ticks)\n",
+               recorder->path,
+               (uint32)recorder->replay.inputs.size(),
+               final_tick);
+    }
+}
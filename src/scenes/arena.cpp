@@ -0,0 +1,239 @@
+#include <SDL3/SDL.h>
+
+#include "../audio.h"
+#include "../common.h"
+
+// Thousands of AI snakes on a 2 pixel grid (see arena_simulation.cpp), picked on the start screen. Nobody steers, it's
+// there to watch and to load the job system: every jump is spread over global_thread_pool. Too many cells for a sprite
+// each, so the board gets turned into a texture with a pixel per cell and drawn as one quad.
+
+#define ARENA_SCENE_SNAKE_COUNT 10000
+#define ARENA_SCENE_EGG_COUNT 5000
+#define ARENA_SCENE_BLOCK_SIZE 2  // Pixels per cell, 640x360 cells on the logical screen
+
+struct Arena__State
+{
+    bool32 is_starting;
+    Arena_Simulation simulation;  // Only cells is kept in the copies rendered from the simulation thread
+    real32 jump__ms;              // How long the last jump took, for the debug overlay
+    real32 max_jump__ms;
+};
+
+GLuint global_arena_texture;             // Made on the first render
+std::vector<uint8> global_arena_pixels;  // RGBA, one pixel per cell
+
+void arena__reset_state(Scene* scene)
+{
+    Arena__State* state = (Arena__State*)scene->state;
+    Arena_Simulation* sim = &state->simulation;
+    if (!sim->cells &&
+        !arena_simulation__init(sim,
+                                ARENA_SCENE_SNAKE_COUNT,
+                                ARENA_SCENE_EGG_COUNT,
+                                LOGICAL_WIDTH / ARENA_SCENE_BLOCK_SIZE,
+                                LOGICAL_HEIGHT / ARENA_SCENE_BLOCK_SIZE))
+    {
+        global_running = 0;
+        return;
+    }
+    arena_simulation__reset(sim, (uint32)SDL_GetTicksNS());
+    state->is_starting = 1;
+    state->jump__ms = 0.0f;
+    state->max_jump__ms = 0.0f;
+    scene->has_visual_changes = 1;
+}
+
+void arena__handle_input(Scene* scene, Input* input)
+{
+    if (pressed(BUTTON_ESCAPE))
+    {
+        global_next_scene = &global_start_screen_scene;
+    }
+}
+
+//=======================================================
+// UPDATE
+//=======================================================
+
+void arena__update(struct Scene* scene, real64 simulation_time_elapsed, real32 dt_s)
+{
+    Arena__State* state = (Arena__State*)scene->state;
+
+    if (state->is_starting)
+    {
+        state->is_starting = 0;
+        play_music(global_audio_context.gameplay_background_music);
+        set_music_volume(100.f);
+    }
+
+    Uint64 counter_before = SDL_GetPerformanceCounter();
+    if (arena_simulation__step(&state->simulation, &global_thread_pool, dt_s))
+    {
+        Uint64 counter_after = SDL_GetPerformanceCounter();
+        state->jump__ms = (real32)(counter_after - counter_before) * 1000.0f / (real32)SDL_GetPerformanceFrequency();
+        state->max_jump__ms = SDL_max(state->max_jump__ms, state->jump__ms);
+        scene->has_visual_changes = 1;
+    }
+}
+
+// Only the grid is needed to draw, the per-snake arrays stay behind
+void arena__copy_state(Scene* scene, std::vector<uint8>* snapshot)
+{
+    Arena__State* state = (Arena__State*)scene->state;
+    uint32 cell_count = state->simulation.cell_count;
+
+    snapshot->resize(sizeof(Arena__State) + cell_count * sizeof(uint32));
+    Arena__State* copy = (Arena__State*)&(*snapshot)[0];
+    memcpy(copy, state, sizeof(Arena__State));
+
+    Arena_Simulation* sim = &copy->simulation;
+    sim->cells = (uint32*)(copy + 1);
+    memcpy(sim->cells, state->simulation.cells, cell_count * sizeof(uint32));
+
+    // Not needed to draw and not copied
+    sim->direction = 0;
+    sim->body_head = 0;
+    sim->will_eat = 0;
+    sim->will_die = 0;
+    sim->length = 0;
+    sim->respawn_jumps = 0;
+    sim->target_cell = 0;
+    sim->goal_cell = 0;
+    sim->snake_rng = 0;
+    sim->body = 0;
+    sim->arena = Memory_Arena();
+}
+
+real32 arena__seconds_until_next_change(Scene* scene)
+{
+    Arena__State* state = (Arena__State*)scene->state;
+    return state->simulation.time_until_jump__seconds;
+}
+
+//=======================================================
+// RENDER
+//=======================================================
+
+void arena__render(Scene* scene)
+{
+    Arena__State* state = (Arena__State*)scene->state;
+    Arena_Simulation* sim = &state->simulation;
+
+    {  // One pixel per cell, the snakes get one of a few colors each
+        const uint8 snake_colors[8][3] = {
+            {86, 180, 233},
+            {230, 159, 0},
+            {0, 158, 115},
+            {204, 121, 167},
+            {240, 228, 66},
+            {213, 94, 0},
+            {0, 114, 178},
+            {170, 220, 120},
+        };
+        global_arena_pixels.resize((size_t)sim->cell_count * 4);
+        uint8* pixel = &global_arena_pixels[0];
+        for (uint32 cell = 0; cell < sim->cell_count; cell++, pixel += 4)
+        {
+            uint32 occupant = sim->cells[cell];
+            if (occupant == ARENA_EMPTY)
+            {
+                pixel[0] = pixel[1] = pixel[2] = 41;  // The grid's fill grey
+            }
+            else if (occupant == ARENA_EGG)
+            {
+                pixel[0] = pixel[1] = pixel[2] = 255;
+            }
+            else
+            {
+                const uint8* color = snake_colors[((occupant - 1) * 2654435761u) >> 29];
+                pixel[0] = color[0];
+                pixel[1] = color[1];
+                pixel[2] = color[2];
+            }
+            pixel[3] = 255;
+        }
+    }
+
+    if (!global_arena_texture)
+    {
+        glGenTextures(1, &global_arena_texture);
+        gl_state__bind_texture_2d(0, global_arena_texture);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glTexImage2D(GL_TEXTURE_2D,
+                     0,
+                     GL_RGBA,
+                     (GLsizei)sim->x_grids,
+                     (GLsizei)sim->y_grids,
+                     0,
+                     GL_RGBA,
+                     GL_UNSIGNED_BYTE,
+                     &global_arena_pixels[0]);
+    }
+    else
+    {
+        gl_state__bind_texture_2d(0, global_arena_texture);
+        glTexSubImage2D(GL_TEXTURE_2D,
+                        0,
+                        0,
+                        0,
+                        (GLsizei)sim->x_grids,
+                        (GLsizei)sim->y_grids,
+                        GL_RGBA,
+                        GL_UNSIGNED_BYTE,
+                        &global_arena_pixels[0]);
+    }
+
+    {  // Row 0 of the texture is the bottom row of cells, same as the screen
+        setupGeometryRenderingState();
+        global_texture_shader->use();
+
+        real32 width = (real32)(sim->x_grids * ARENA_SCENE_BLOCK_SIZE);
+        real32 height = (real32)(sim->y_grids * ARENA_SCENE_BLOCK_SIZE);
+        glm::mat4 model = glm::mat4(1.0f);
+        model = glm::translate(model, glm::vec3(width / 2.0f, height / 2.0f, 0.0f));
+        model = glm::scale(model, glm::vec3(width, height, 1.0f));
+        global_texture_shader->setMat4("model", model);
+        global_texture_shader->setVec4("uv_rect", 0.0f, 0.0f, 1.0f, 1.0f);
+
+        gl_state__bind_vertex_array(quadVAO);
+        glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
+    }
+
+    {  // Head count
+        char alive_text[64];
+        snprintf(alive_text,
+                 sizeof(alive_text),
+                 "%u / %u ALIVE, LONGEST %u",
+                 sim->stats.alive_count,
+                 sim->snake_count,
+                 sim->stats.longest_length);
+        real32 text_scale = 0.5f / FONT_SCALE_FACTOR;
+        const Text_Layout* layout = text_layout__get(&global_font, alive_text, text_scale);
+        real32 x = ((real32)LOGICAL_WIDTH - layout->width) / 2.0f;
+        real32 y = (real32)LOGICAL_HEIGHT - 20.0f - layout->height / 2.0f;
+        text_layout__draw(*global_text_shader, layout, x, y, white);
+    }
+
+    if (global_display_debug_info)
+    {  // Whether the jumps keep up
+        char arena_text[128];
+        snprintf(arena_text,
+                 sizeof(arena_text),
+                 "ARENA %.2f ms/jump (max %.2f), %u threads, %llu eaten, %llu died (%llu head-on)",
+                 state->jump__ms,
+                 state->max_jump__ms,
+                 global_thread_pool.queue_count,
+                 (unsigned long long)sim->stats.eaten_egg_count,
+                 (unsigned long long)sim->stats.death_count,
+                 (unsigned long long)sim->stats.head_on_count);
+
+        real32 text_scale = 0.5f / FONT_SCALE_FACTOR;
+        const Text_Layout* layout = text_layout__get(&global_font, arena_text, text_scale);
+        real32 x = (real32)LOGICAL_WIDTH * 0.05f;
+        real32 y = (real32)LOGICAL_HEIGHT - 5.0f - layout->height;
+        text_layout__draw(*global_text_shader, layout, x, y, white);
+    }
+}
@@ -23,44 +23,26 @@ Screen_Space_Position map_world_space_position_to_screen_space_position(real32 w
     return result;
 }
 
-typedef enum
-{
-    DIRECTION_NONE,  // Represents no movement
-    DIRECTION_NORTH,
-    DIRECTION_EAST,
-    DIRECTION_SOUTH,
-    DIRECTION_WEST
-} Direction;
-
-struct Snake_Part
-{
-    int32 pos_x;
-    int32 pos_y;
-    Direction direction;
-};
-
-#define MAX_TAIL_LENGTH 1000
-
 struct Gameplay__State
 {
     bool32 is_starting;
-    bool32 game_over;
     bool32 is_paused;
 
-    int32 pos_x;
-    int32 pos_y;
-
-    Snake_Part snake_parts[MAX_TAIL_LENGTH];
-    uint32 next_snake_part_index;
+    // The game itself, the scene just feeds it input, steps it and turns its events into sounds
+    Snake_Simulation simulation;
 
-    Direction current_direction;
-    Direction proposed_direction;
+    // With the autopilot on: how long a finished game stays up before the next one starts, and the planner timings
+    // (copied here so they make it into render snapshots)
+    bool32 is_autopilot_enabled;
+    real32 autopilot_restart_countdown__seconds;
+    real32 autopilot_plan_mean__us;
+    real32 autopilot_plan_max__us;
+    bool32 is_mcts_enabled;
+    real32 mcts_rollouts_per_second;
+    uint32 mcts_tree_size;
 
-    real32 time_until_grid_jump__seconds;
-    real32 set_time_until_grid_jump__seconds;
-
-    int32 blip_pos_x;
-    int32 blip_pos_y;
+    // When each press in the simulation's input queue happened, in the same slots (0 for the autopilot's)
+    Uint64 input_event_times__ns[SNAKE_MAX_QUEUED_INPUTS];
 
     // Overload * operator for scalar multiplication
     Gameplay__State operator*(real32 scalar) const
@@ -86,60 +68,83 @@ struct Gameplay__State
     }
 };
 
-// TODO move this somewhere
-// TODO should this be part of Gameplay__State?
-#define MAX_INPUTS 10
-Direction input_queue[MAX_INPUTS];
-int32 head = 0;  // Points to the current input to be processed
-int32 tail = 0;  // Points to the next free spot for adding input
+#define GAMEPLAY_AUTOPILOT_RESTART_DELAY__SECONDS 3.0f
+
+uint32 seed = 12345;  // Seed for the next game, moves on every reset so each game gets different eggs
 
-void add_input(Direction dir)
+void gameplay__reset_state(Scene* scene)
 {
-    int32 next_tail = (tail + 1) % MAX_INPUTS;
-    if (next_tail != head)  // Only add if there's space in the queue
+    Gameplay__State* state = (Gameplay__State*)scene->state;
+
+    if (global_autopilot_enabled && global_autopilot_uses_mcts && global_mcts_player.trees.empty())
     {
-        input_queue[tail] = dir;
-        tail = next_tail;
+        mcts__init(&global_mcts_player, &global_thread_pool, MCTS_DEFAULT_MOVE_BUDGET__MS);
     }
+    else if (global_autopilot_enabled && !global_autopilot_uses_mcts &&
+             !autopilot__init(&global_autopilot, X_GRIDS, Y_GRIDS))
+    {
+        global_autopilot_enabled = 0;  // Board it can't handle, let the player have it
+    }
+
+    state->is_starting = 1;
+    state->is_autopilot_enabled = global_autopilot_enabled;
+    state->is_mcts_enabled = global_autopilot_enabled && global_autopilot_uses_mcts;
+    state->is_paused = !state->is_autopilot_enabled;  // Nobody is going to press space to start
+    state->autopilot_restart_countdown__seconds = GAMEPLAY_AUTOPILOT_RESTART_DELAY__SECONDS;
+
+    if (!snake_simulation__reset(&state->simulation, X_GRIDS, Y_GRIDS, seed))
+    {
+        SDL_assert_release(!"Not enough memory for the board");
+    }
+    replay_recorder__begin(&global_replay_recorder, seed, X_GRIDS, Y_GRIDS, SIMULATION_DELTA_TIME_S);
+    snake_rng__next(&seed);
+
+    scene->has_visual_changes = 1;
 }
 
-Direction get_next_input()
+// Everything the player steers with goes through here so replays see exactly the same inputs
+void gameplay__queue_input(Gameplay__State* state, Direction direction, Uint64 event__ns)
 {
-    if (head == tail)
+    int32 slot = state->simulation.input_tail;
+    snake_simulation__queue_input(&state->simulation, direction);
+    if (state->simulation.input_tail != slot)
     {
-        // No inputs available, return current direction
-        return DIRECTION_NONE;
+        state->input_event_times__ns[slot] = event__ns;
     }
-    Direction dir = input_queue[head];
-    head = (head + 1) % MAX_INPUTS;
-    return dir;
+    replay_recorder__add_input(&global_replay_recorder, state->simulation.ticks, (uint8)direction);
 }
 
-void gameplay__reset_state(Scene* scene)
+local_internal Direction gameplay__button_direction(uint32 button)
 {
-    Gameplay__State* state = (Gameplay__State*)scene->state;
-
-    head = 0;
-    tail = 0;
-
-    state->is_starting = 1;
-    state->is_paused = 1;
-    state->game_over = 0;
-
-    state->pos_x = X_GRIDS / 2;
-    state->pos_y = Y_GRIDS / 4;
-    state->current_direction = DIRECTION_NORTH;
-    state->next_snake_part_index = 0;
-
-    state->set_time_until_grid_jump__seconds = .1f;
-    state->time_until_grid_jump__seconds = state->set_time_until_grid_jump__seconds;
-
-    state->blip_pos_x = X_GRIDS / 2;
-    state->blip_pos_y = Y_GRIDS / 2;
+    switch (button)
+    {
+        case BUTTON_W:
+        case BUTTON_UP:
+        {
+            return DIRECTION_NORTH;
+        }
+        case BUTTON_A:
+        case BUTTON_LEFT:
+        {
+            return DIRECTION_WEST;
+        }
+        case BUTTON_S:
+        case BUTTON_DOWN:
+        {
+            return DIRECTION_SOUTH;
+        }
+        case BUTTON_D:
+        case BUTTON_RIGHT:
+        {
+            return DIRECTION_EAST;
+        }
+    }
+    return DIRECTION_NONE;
 }
 
-#define DYNAMIC_SCORE_LENGTH 5 + 7 // TODO: 7 is accounting for "Score: "
-global_variable char global_dynamic_score_text[DYNAMIC_SCORE_LENGTH]; // Make sure the buffer is large enough
+#define DYNAMIC_SCORE_LENGTH (sizeof("Score: ") + 10)  // Room for every digit of a uint32
+global_variable char global_dynamic_score_text[DYNAMIC_SCORE_LENGTH];
+global_variable int64 global_dynamic_score_text_value = -1;  // Score the text was last formatted for
 
 void gameplay__handle_input(Scene* scene, Input* input)
 {
@@ -150,35 +155,26 @@ void gameplay__handle_input(Scene* scene, Input* input)
         global_next_scene = &global_start_screen_scene;
     }
 
-    if (pressed(BUTTON_SPACE) && !state->game_over)
+    if (pressed(BUTTON_SPACE) && !state->simulation.game_over)
     {
         state->is_paused = !state->is_paused;
+        scene->has_visual_changes = 1;
     }
 
-    if (!state->is_paused)
+    if (!state->is_paused && !state->is_autopilot_enabled)  // The autopilot's plan falls apart if anyone else steers
     {
-        if (pressed(BUTTON_W) || pressed(BUTTON_UP))
-        {
-            add_input(DIRECTION_NORTH);
-        }
-
-        if (pressed(BUTTON_A) || pressed(BUTTON_LEFT))
-        {
-            add_input(DIRECTION_WEST);
-        }
-
-        if (pressed(BUTTON_S) || pressed(BUTTON_DOWN))
+        // Every press since the last frame in the order they happened, each with its event time
+        for (uint32 i = 0; i < input->press_count; i++)
         {
-            add_input(DIRECTION_SOUTH);
-        }
-
-        if (pressed(BUTTON_D) || pressed(BUTTON_RIGHT))
-        {
-            add_input(DIRECTION_EAST);
+            Direction direction = gameplay__button_direction(input->presses[i].button);
+            if (direction != DIRECTION_NONE)
+            {
+                gameplay__queue_input(state, direction, input->presses[i].timestamp__ns);
+            }
         }
     }
 
-    if (state->game_over && pressed(BUTTON_ENTER))
+    if (state->simulation.game_over && pressed(BUTTON_ENTER))
     {
         gameplay__reset_state(scene);
         state->is_paused = 0;
@@ -189,27 +185,10 @@ void gameplay__handle_input(Scene* scene, Input* input)
 // UPDATE
 //=======================================================
 
-// Define parameters for the LCG
-uint32 seed = 12345;  // Initial seed value
-#define LCG_A 1664525u
-#define LCG_C 1013904223u
-
-// Function to generate a pseudorandom number using LCG
-uint32 custom_rand()
-{
-    seed = LCG_A * seed + LCG_C;
-    return seed;
-}
-
-// Function to generate a number between 0 and max - 1 (inclusive)
-uint32 custom_rand_range(uint32 max)
-{
-    return custom_rand() % (max);
-}
-
 void gameplay__update(struct Scene* scene, real64 simulation_time_elapsed, real32 dt_s)
 {
     Gameplay__State* state = (Gameplay__State*)scene->state;
+    Snake_Simulation* sim = &state->simulation;
 
     if (state->is_starting)
     {
@@ -218,167 +197,107 @@ void gameplay__update(struct Scene* scene, real64 simulation_time_elapsed, real3
         set_music_volume(100.f);
     }
 
-    if (state->game_over || state->is_paused)
+    if (state->is_autopilot_enabled && sim->game_over && !state->is_paused)
     {
+        state->autopilot_restart_countdown__seconds -= dt_s;
+        if (state->autopilot_restart_countdown__seconds <= 0)
+        {
+            gameplay__reset_state(scene);
+        }
         return;
     }
 
-    state->time_until_grid_jump__seconds -= dt_s;
-
-    if (state->time_until_grid_jump__seconds <= 0)
+    if (sim->game_over || state->is_paused)
     {
-        Direction proposed_direction = get_next_input();
-
-        switch (proposed_direction)
-        {
-            case DIRECTION_NORTH:
-            {
-                if (state->current_direction != DIRECTION_SOUTH)
-                {
-                    state->current_direction = DIRECTION_NORTH;
-                }
-            }
-            break;
-            case DIRECTION_EAST:
-            {
-                if (state->current_direction != DIRECTION_WEST)
-                {
-                    state->current_direction = DIRECTION_EAST;
-                }
-            }
-            break;
-            case DIRECTION_SOUTH:
-            {
-                if (state->current_direction != DIRECTION_NORTH)
-                {
-                    state->current_direction = DIRECTION_SOUTH;
-                }
-            }
-            break;
-            case DIRECTION_WEST:
-            {
-                if (state->current_direction != DIRECTION_EAST)
-                {
-                    state->current_direction = DIRECTION_WEST;
-                }
-            }
-            break;
-        }
-
-        {  // Blip collision
-            if (state->pos_x == state->blip_pos_x && state->pos_y == state->blip_pos_y)
-            {
-                play_sound_effect(global_audio_context.effect_beep_2);
-
-                {  // Grow snake part
-                    Snake_Part new_snake_part = {};
-                    Snake_Part* last_snake_part = &state->snake_parts[state->next_snake_part_index];
-                    new_snake_part.pos_x = last_snake_part->pos_x;
-                    new_snake_part.pos_y = last_snake_part->pos_y;
-                    new_snake_part.direction = last_snake_part->direction;
-                    state->next_snake_part_index++;
-
-                    if (!(state->next_snake_part_index < MAX_TAIL_LENGTH))
-                    {
-                        SDL_SetError("Snake tail must never get this long! %d", state->next_snake_part_index);
-                        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "%s", SDL_GetError());
-                        SDL_assert_release(state->next_snake_part_index < MAX_TAIL_LENGTH);
-                    }
-                }
-
-                {  // Randomly spawn blip somewhere else
-                    uint32 random_x = custom_rand_range(X_GRIDS);
-                    state->blip_pos_x = random_x;
-
-                    uint32 random_y = custom_rand_range(Y_GRIDS);
-                    state->blip_pos_y = random_y;
-                }
-
-                state->set_time_until_grid_jump__seconds -= 0.0005f;
-            }
-        }
+        return;
+    }
 
-        for (int32 i = state->next_snake_part_index - 1; i >= 0; i--)
-        {
-            Snake_Part* current_snake_part = &state->snake_parts[i];
+    if (state->is_mcts_enabled && snake_simulation__jumps_next_step(sim, dt_s))
+    {
+        gameplay__queue_input(state, mcts__choose_direction(&global_mcts_player, sim), 0);
+        state->mcts_rollouts_per_second = global_mcts_player.last_rollouts_per_second;
+        state->mcts_tree_size = global_mcts_player.last_tree_size;
+    }
+    else if (state->is_autopilot_enabled && snake_simulation__jumps_next_step(sim, dt_s))
+    {
+        gameplay__queue_input(state, autopilot__choose_direction(&global_autopilot, sim), 0);
+        state->autopilot_plan_mean__us = autopilot__plan_mean__us(&global_autopilot);
+        state->autopilot_plan_max__us = global_autopilot.plan_max__us;
+    }
 
-            if (i == 0)
-            {
-                current_snake_part->pos_x = state->pos_x;
-                current_snake_part->pos_y = state->pos_y;
-                current_snake_part->direction = state->current_direction;
-            }
-            else
-            {
-                Snake_Part* previous_snake_part = &state->snake_parts[i - 1];
-                current_snake_part->pos_x = previous_snake_part->pos_x;
-                current_snake_part->pos_y = previous_snake_part->pos_y;
-                current_snake_part->direction = previous_snake_part->direction;
-            }
-        }
+    int32 input_head = sim->input_head;
+    if (snake_simulation__step(sim, dt_s))
+    {
+        scene->has_visual_changes = 1;  // The snake moved
+    }
+    if (sim->input_head != input_head && state->input_event_times__ns[input_head])
+    {  // The jump took a press, it's on screen once this tick is
+        input_latency__applied(&global_input_latency, state->input_event_times__ns[input_head], SDL_GetTicksNS());
+    }
 
-        switch (state->current_direction)
+    for (uint32 i = 0; i < sim->event_count; i++)
+    {
+        switch (sim->events[i])
         {
-            case DIRECTION_NORTH:
-            {
-                if (state->current_direction != DIRECTION_SOUTH)
-                {
-                    state->pos_y++;
-                }
-            }
-            break;
-            case DIRECTION_EAST:
+            case SNAKE_EVENT_ATE_EGG:
             {
-                if (state->current_direction != DIRECTION_WEST)
-                {
-                    state->pos_x++;
-                }
+                play_sound_effect(global_audio_context.effect_beep_2);
             }
             break;
-            case DIRECTION_SOUTH:
+            case SNAKE_EVENT_GAME_OVER:
             {
-                if (state->current_direction != DIRECTION_NORTH)
-                {
-                    state->pos_y--;
-                }
+                play_sound_effect(global_audio_context.effect_boom);
+                replay_recorder__finish(&global_replay_recorder, sim->ticks, snake_simulation__hash(sim));
             }
             break;
-            case DIRECTION_WEST:
+            case SNAKE_EVENT_WON:
             {
-                if (state->current_direction != DIRECTION_EAST)
-                {
-                    state->pos_x--;
-                }
+                play_sound_effect(global_audio_context.effect_beep_2);
+                replay_recorder__finish(&global_replay_recorder, sim->ticks, snake_simulation__hash(sim));
             }
             break;
         }
+    }
+}
 
-        {  // End Game if player crashes
-            for (uint32 i = 0; i < state->next_snake_part_index; i++)
-            {
-                Snake_Part* current_snake_part = &state->snake_parts[i];
-                if (state->pos_x == current_snake_part->pos_x && state->pos_y == current_snake_part->pos_y)
-                {
-                    state->game_over = 1;
-                    break;
-                }
-            }
+// Snapshot for the render thread: the state followed by the body parts in order, so it doesn't point into the arena
+// the simulation keeps writing to
+void gameplay__copy_state(Scene* scene, std::vector<uint8>* snapshot)
+{
+    Gameplay__State* state = (Gameplay__State*)scene->state;
+    uint32 part_count = state->simulation.next_snake_part_index;
 
-            if (state->pos_x < 0 || state->pos_x >= (int32)X_GRIDS || state->pos_y < 0 || state->pos_y >= (int32)Y_GRIDS)
-            {
-                state->game_over = 1;
-            }
+    snapshot->resize(sizeof(Gameplay__State) + SDL_max(part_count, 1u) * sizeof(Snake_Part));
+    Gameplay__State* copy = (Gameplay__State*)&(*snapshot)[0];
+    memcpy(copy, state, sizeof(Gameplay__State));
 
-            if (state->game_over)
-            {
-                play_sound_effect(global_audio_context.effect_boom);
-            }
-        }
+    Snake_Simulation* sim = &copy->simulation;
+    sim->snake_parts = (Snake_Part*)(copy + 1);
+    sim->snake_parts_capacity = SDL_max(part_count, 1u);
+    sim->snake_parts_first = 0;
+    for (uint32 i = 0; i < part_count; i++)
+    {
+        sim->snake_parts[i] = *snake_simulation__part(&state->simulation, i);
+    }
 
-        state->time_until_grid_jump__seconds = state->set_time_until_grid_jump__seconds;
-        // printf("x: %d, y: %d, %d, %d\n", state->pos_x, state->pos_y, state->current_direction,
-        // state->proposed_direction);
+    // Not needed to draw and not copied
+    sim->occupied_cells = 0;
+    sim->arena = Memory_Arena();
+}
+
+real32 gameplay__seconds_until_next_change(Scene* scene)
+{
+    Gameplay__State* state = (Gameplay__State*)scene->state;
+    if (state->is_paused)
+    {
+        return -1.0f;  // Frozen until the player does something
     }
+    if (state->simulation.game_over)
+    {
+        // The autopilot starts the next game by itself
+        return state->is_autopilot_enabled ? state->autopilot_restart_countdown__seconds : -1.0f;
+    }
+    return state->simulation.time_until_grid_jump__seconds;
 }
 
 //=======================================================
@@ -391,54 +310,40 @@ void drawSquare(Shader& shader, float x, float y, float size, glm::vec3 color)
 
     // Draw the square
     shader.use();
-
-    glm::mat4 projection = glm::ortho(0.0f, (real32)LOGICAL_WIDTH, 0.0f, (real32)LOGICAL_HEIGHT);
-    glUniformMatrix4fv(glGetUniformLocation(shader.ID, "projection"), 1, GL_FALSE, glm::value_ptr(projection));
-    glUniform3f(glGetUniformLocation(shader.ID, "color"), color.r, color.g, color.b);
+    shader.setVec3("color", color);
 
     // Create the model matrix for position and size
     glm::mat4 model = glm::mat4(1.0f);                       // Identity matrix
     model = glm::translate(model, glm::vec3(x, y, 0.0f));    // Translate to position (x, y)
     model = glm::scale(model, glm::vec3(size, size, 1.0f));  // Scale to the desired size
-    glUniformMatrix4fv(glGetUniformLocation(shader.ID, "model"), 1, GL_FALSE, glm::value_ptr(model));
+    shader.setMat4("model", model);
 
-    glBindVertexArray(global_square_VAO);
+    gl_state__bind_vertex_array(global_square_VAO);
     glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
-    
-    glBindVertexArray(0); // Unbind for safety
 }
 
-void draw_texture(Shader& shader, uint32 texture_id, real32 x, real32 y, real32 angle__degrees, real32 size)
+void draw_texture(Shader& shader, const Atlas_Region* region, real32 x, real32 y, real32 angle__degrees, real32 size)
 {
-    setupGeometryRenderingState();
+    setupTextRenderingState();  // Sprites need alpha blending too
 
     // Draw the square
     shader.use();
 
-    glm::mat4 projection = glm::ortho(0.0f, (real32)LOGICAL_WIDTH, 0.0f, (real32)LOGICAL_HEIGHT);
-    glUniformMatrix4fv(glGetUniformLocation(shader.ID, "projection"), 1, GL_FALSE, glm::value_ptr(projection));
-
     // Create the model matrix for position and size
     glm::mat4 model = glm::mat4(1.0f);                       // Identity matrix
     model = glm::translate(model, glm::vec3(x, y, 0.0f));    // Translate to position (x, y) 
     model = glm::scale(model, glm::vec3(size, size, 1.0f));  // Scale to the desired size
     real32 angle__radians = glm::radians(angle__degrees);
     model = glm::rotate(model, angle__radians, glm::vec3(0.0f, 0.0f, 1.0f));
-    glUniformMatrix4fv(glGetUniformLocation(shader.ID, "model"), 1, GL_FALSE, glm::value_ptr(model));
-
-    glEnable(GL_BLEND);
-    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    shader.setMat4("model", model);
 
     // bind textures on corresponding texture units
-    glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_2D, texture_id);
-    glUniform1i(glGetUniformLocation(shader.ID, "texture1"), 0); // Tell the shader to use texture unit 0
+    gl_state__bind_texture_2d(0, region->texture_id);
+    shader.setVec4("uv_rect", region->u0, region->v0, region->u1, region->v1);
 
      // Render a quad that covers the screen or the grid's intended area
-    glBindVertexArray(quadVAO);  // Assume a preconfigured VAO for a full-screen quad
+    gl_state__bind_vertex_array(quadVAO);  // Assume a preconfigured VAO for a full-screen quad
     glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
-    
-    glBindVertexArray(0); // Unbind for safety
 }
 
 real32 get_angle_from_direction(Direction direction)
@@ -467,164 +372,64 @@ real32 get_angle_from_direction(Direction direction)
     return angle__degrees;
 }
 
-void drawGrid(Shader& shader,
-              int xGrids,
-              int yGrids,
-              float gridSize,
-              float borderThickness,
-              glm::vec3 borderColor,
-              glm::vec3 fillColor)
-{
-    // Loop through all grid cells
-    for (int row = 0; row < yGrids; row++)
-    {
-        for (int col = 0; col < xGrids; col++)
-        {
-            // Calculate the position of the current grid cell
-            float x = (col + 1) * gridSize - (gridSize / 2);
-            float y = (row + 1) * gridSize - (gridSize / 2);
-
-            drawSquare(shader, x, y, gridSize, borderColor);
-            drawSquare(shader, x, y, gridSize - borderThickness, fillColor);
-        }
-    }
-}
-
-GLuint gridFBO, gridTexture;
-
-void createGridFramebuffer(int gridWidth, int gridHeight)
-{
-    // Generate and bind the framebuffer
-    glGenFramebuffers(1, &gridFBO);
-    glBindFramebuffer(GL_FRAMEBUFFER, gridFBO);
-
-    // Create the texture to store the grid
-    glGenTextures(1, &gridTexture);
-    glBindTexture(GL_TEXTURE_2D, gridTexture);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, gridWidth, gridHeight, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
-    
-    // glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-    // glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-    // Disable smoothing (use nearest-neighbor filtering)
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-
-    // Attach the texture to the framebuffer
-    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, gridTexture, 0);
-
-    // Check if framebuffer is complete
-    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
-    {
-        fprintf(stderr, "Error: Framebuffer is not complete.\n");
-        return;
-    }
-
-    // Unbind the framebuffer and texture
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);
-    glBindTexture(GL_TEXTURE_2D, 0);
-}
-
-void renderGridToTexture(Shader& gridShader,
-                         int xGrids,
-                         int yGrids,
-                         float gridSize,
-                         float borderThickness,
-                         glm::vec3 borderColor,
-                         glm::vec3 fillColor)
-{
-    // Bind the framebuffer
-    glBindFramebuffer(GL_FRAMEBUFFER, gridFBO);
-
-    // Set the viewport to match the grid texture size
-    glViewport(0, 0, (GLsizei)(xGrids * gridSize), (GLsizei)(yGrids * gridSize));
-
-    // Clear the framebuffer
-    glClearColor(0.0f, 0.0f, 0.0f, 0.0f);  // Transparent background
-    glClear(GL_COLOR_BUFFER_BIT);
-
-    // Draw the grid
-    drawGrid(gridShader, xGrids, yGrids, gridSize, borderThickness, borderColor, fillColor);
-
-    // Unbind the framebuffer
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);
-
-    // Reset viewport to the default size
-    adjust_viewport_to_window();
-}
-
-void renderCachedGrid(Shader& textureShader, real32 x, real32 y, real32 width, real32 height)
+// Draws the whole background grid in one go, the fragment shader works out cell fill and borders per pixel
+void draw_grid(Shader& grid_shader,
+               uint32 x_grids,
+               uint32 y_grids,
+               real32 block_size,
+               real32 border_thickness,
+               glm::vec3 border_color,
+               glm::vec3 fill_color)
 {
     setupGeometryRenderingState();
 
-    // Bind the texture shader
-    glUseProgram(textureShader.ID);
+    grid_shader.use();
 
-    // Set up orthographic projection
-    glm::mat4 projection = glm::ortho(0.0f, (float)LOGICAL_WIDTH, 0.0f, (float)LOGICAL_HEIGHT);
-    glUniformMatrix4fv(glGetUniformLocation(textureShader.ID, "projection"), 1, GL_FALSE, glm::value_ptr(projection));
+    real32 width = x_grids * block_size;
+    real32 height = y_grids * block_size;
 
-    // Create the model matrix for position and size
-    glm::mat4 model = glm::mat4(1.0f);                          // Identity matrix
-    model = glm::translate(model, glm::vec3(x, y, 0.0f));       // Translate to position (x, y)
-    model = glm::scale(model, glm::vec3(width, height, 1.0f));  // Scale to the desired size
-    glUniformMatrix4fv(glGetUniformLocation(textureShader.ID, "model"), 1, GL_FALSE, glm::value_ptr(model));
-
-    // Bind the texture to a texture unit
-    glActiveTexture(GL_TEXTURE0);                                        // Activate texture unit 0
-    glBindTexture(GL_TEXTURE_2D, gridTexture);                           // Bind the grid texture
-    glUniform1i(glGetUniformLocation(textureShader.ID, "texture1"), 0);  // Tell the shader to use texture unit 0
-
-    // Render a quad that covers the screen or the grid's intended area
-    glBindVertexArray(quadVAO);  // Assume a preconfigured VAO for a full-screen quad
-    glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
+    // The unit quad is centered on the origin, cells start at the bottom-left of the logical screen
+    glm::mat4 model = glm::mat4(1.0f);                                            // Identity matrix
+    model = glm::translate(model, glm::vec3(width / 2.0f, height / 2.0f, 0.0f));  // Translate to the grid's center
+    model = glm::scale(model, glm::vec3(width, height, 1.0f));                    // Scale to the desired size
+    grid_shader.setMat4("model", model);
+    grid_shader.setVec2("grid_size", width, height);
+    grid_shader.setFloat("block_size", block_size);
+    grid_shader.setFloat("border_thickness", border_thickness);
+    grid_shader.setVec3("border_color", border_color);
+    grid_shader.setVec3("fill_color", fill_color);
 
-    // Unbind the VAO and texture
-    glBindVertexArray(0);
-    glBindTexture(GL_TEXTURE_2D, 0);
+    gl_state__bind_vertex_array(quadVAO);
+    glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
 }
 
 void gameplay__render(Scene* scene)
 {
     Gameplay__State* state = (Gameplay__State*)scene->state;
+    Snake_Simulation* sim = &state->simulation;
 
     float borderThickness = 2.0f;                // Border thickness
     glm::vec3 borderColor(0.23f, 0.23f, 0.23f);  // Dark grey
     glm::vec3 fillColor(0.16f, 0.16f, 0.16f);    // Lighter grey
-    // drawGrid(*global_basic_shader, X_GRIDS, Y_GRIDS, (real32)GRID_BLOCK_SIZE, borderThickness, borderColor, fillColor);
-    if (!gridFBO)
-    {
-        createGridFramebuffer(X_GRIDS * GRID_BLOCK_SIZE, Y_GRIDS * GRID_BLOCK_SIZE);
-        renderGridToTexture(*global_basic_shader,
-                            X_GRIDS,
-                            Y_GRIDS,
-                            (real32)GRID_BLOCK_SIZE,
-                            borderThickness,
-                            borderColor,
-                            fillColor);
-    }
-    renderCachedGrid(*global_grid_shader,
-                     (real32)LOGICAL_WIDTH / 2,
-                     (real32)LOGICAL_HEIGHT / 2,
-                     (real32)LOGICAL_WIDTH,
-                     (real32)LOGICAL_HEIGHT);
+    draw_grid(*global_grid_shader, X_GRIDS, Y_GRIDS, (real32)GRID_BLOCK_SIZE, borderThickness, borderColor, fillColor);
 
     {  // Draw Blip
         Screen_Space_Position square_screen_pos =
-            map_world_space_position_to_screen_space_position((real32)state->blip_pos_x, (real32)state->blip_pos_y);
+            map_world_space_position_to_screen_space_position((real32)sim->blip_pos_x, (real32)sim->blip_pos_y);
         real32 size = (real32)(GRID_BLOCK_SIZE);
         real32 x = (real32)(square_screen_pos.x - ((real32)GRID_BLOCK_SIZE / 2));
         real32 y = (real32)(square_screen_pos.y - ((real32)GRID_BLOCK_SIZE / 2));
 
         // glm::vec3 blue_color = {0.204f, 0.596f, 0.859f};
         // drawSquare(*global_basic_shader, x, y, size, blue_color);
-        draw_texture(*global_grid_shader, global_egg_texture, x, y, 0.f, size);
+        sprite_batch__push(&global_sprite_batch, &global_egg_region, x, y, 0.f, size);
     }
 
     {  // Draw Player
         // Tail parts
-        for (uint32 i = 0; i < state->next_snake_part_index; i++)
+        for (uint32 i = 0; i < sim->next_snake_part_index; i++)
         {
-            Snake_Part* snake_part = &state->snake_parts[i];
+            Snake_Part* snake_part = snake_simulation__part(sim, i);
             Screen_Space_Position screen_pos =
                 map_world_space_position_to_screen_space_position((real32)snake_part->pos_x, (real32)snake_part->pos_y);
 
@@ -637,81 +442,100 @@ void gameplay__render(Scene* scene)
             Direction direction = snake_part->direction;
             real32 angle = get_angle_from_direction(direction);
 
-            if (i == state->next_snake_part_index - 1)
+            if (i == sim->next_snake_part_index - 1)
             {
-                draw_texture(*global_grid_shader, global_snake_tail_texture, x, y, angle, size);
+                sprite_batch__push(&global_sprite_batch, &global_snake_tail_region, x, y, angle, size);
             }
             else
             {
-                draw_texture(*global_grid_shader, global_snake_body_texture, x, y, angle, size);
+                sprite_batch__push(&global_sprite_batch, &global_snake_body_region, x, y, angle, size);
             }
         }
 
         // Player
         Screen_Space_Position square_screen_pos =
-            map_world_space_position_to_screen_space_position((real32)state->pos_x, (real32)state->pos_y);
+            map_world_space_position_to_screen_space_position((real32)sim->pos_x, (real32)sim->pos_y);
         real32 size = (real32)(GRID_BLOCK_SIZE);
         real32 x = square_screen_pos.x - ((real32)GRID_BLOCK_SIZE / 2);
         real32 y = square_screen_pos.y - ((real32)GRID_BLOCK_SIZE / 2);
 
         // glm::vec3 red_color = {0.6039f, 0.2471f, 0.2314f};
         // drawSquare(*global_basic_shader, x, y, size, red_color);
-        Direction direction = state->current_direction;
+        Direction direction = sim->current_direction;
         real32 angle = get_angle_from_direction(direction);
-        draw_texture(*global_grid_shader, global_snake_face_texture, x, y, angle, size);
+        sprite_batch__push(&global_sprite_batch, &global_snake_head_region, x, y, angle, size);
     }
 
+    // One instanced draw per sprite texture, no matter how long the snake gets
+    sprite_batch__flush(&global_sprite_batch, *global_sprite_shader);
+
     {  // Dynamic Score Text
         float initial_x = (real32)LOGICAL_WIDTH - (LOGICAL_WIDTH * 0.05f);
         float initial_y = (real32)LOGICAL_HEIGHT - 5.0f;
         glm::vec3 text_color = white;
 
-        char text[DYNAMIC_SCORE_LENGTH];
-        snprintf(text, DYNAMIC_SCORE_LENGTH, "Score: %d", state->next_snake_part_index);
+        // Only re-format when an egg was eaten
+        if (global_dynamic_score_text_value != sim->next_snake_part_index)
+        {
+            global_dynamic_score_text_value = sim->next_snake_part_index;
+            snprintf(global_dynamic_score_text, DYNAMIC_SCORE_LENGTH, "Score: %u", sim->next_snake_part_index);
+        }
 
         real32 size_ratio = 0.5f;
         float text_scale = size_ratio / FONT_SCALE_FACTOR;
+        const Text_Layout* layout = text_layout__get(&global_font, global_dynamic_score_text, text_scale);
+
+        float x = initial_x - layout->width;
+        float y = initial_y - layout->height;
 
-        // Compute the total text width
-        float text_width = 0.0f;
-        for (char c : text)
+        text_layout__draw(*global_text_shader, layout, x, y, text_color);
+    }
+
+    if (state->is_autopilot_enabled)
+    {  // Autopilot label, and how long it's taking to plan (or how hard MCTS is searching) with the debug overlay up
+        char autopilot_text[64] = "AUTOPILOT";
+        if (global_display_debug_info && state->is_mcts_enabled)
         {
-            text_width += (Characters[c].Advance >> 6) * text_scale;  // Horizontal advance in pixels
+            snprintf(autopilot_text,
+                     sizeof(autopilot_text),
+                     "AUTOPILOT MCTS %.0f rollouts/s, %u nodes",
+                     state->mcts_rollouts_per_second,
+                     state->mcts_tree_size);
+        }
+        else if (global_display_debug_info)
+        {
+            snprintf(autopilot_text,
+                     sizeof(autopilot_text),
+                     "AUTOPILOT plan %.2fus (max %.2fus)",
+                     state->autopilot_plan_mean__us,
+                     state->autopilot_plan_max__us);
         }
 
-        float x = initial_x - text_width;
-        float y =
-            initial_y - (Characters['H'].Size.y * text_scale);  // Use a sample character for height
-
-        RenderText(*global_text_shader, text, x, y, text_scale, text_color);
+        real32 text_scale = 0.5f / FONT_SCALE_FACTOR;
+        const Text_Layout* layout = text_layout__get(&global_font, autopilot_text, text_scale);
+        real32 x = (real32)LOGICAL_WIDTH * 0.05f;
+        real32 y = (real32)LOGICAL_HEIGHT - 5.0f - layout->height;
+        text_layout__draw(*global_text_shader, layout, x, y, white);
     }
 
     {  // Game over stuff
-        if (state->game_over)
+        if (sim->game_over)
         {
             real32 initial_x = 0.5f * (real32)LOGICAL_WIDTH;
             real32 initial_y = 0.75f * (real32)LOGICAL_HEIGHT;
             real32 game_over_size_ratio = 1.75f;
             float game_over_text_scale = game_over_size_ratio / FONT_SCALE_FACTOR;
-            real32 game_over_height = Characters['H'].Size.y * game_over_text_scale;
+            const Text_Layout* game_over_layout = text_layout__get(&global_font, "Game Over", game_over_text_scale);
+            real32 game_over_height = game_over_layout->height;
 
             {  // Render Game Over
                 glm::vec3 text_color = white;
 
-                std::string text = "Game Over";
-
-                // Compute the total text width
-                float text_width = 0.0f;
-                for (char c : text)
-                {
-                    text_width += (Characters[c].Advance >> 6) * game_over_text_scale;  // Horizontal advance in pixels
-                }
-
                 // Adjust for centering
-                float x = initial_x - (text_width / 2.0f);
+                float x = initial_x - (game_over_layout->width / 2.0f);
                 float y = initial_y - (game_over_height / 2.0f);
 
-                RenderText(*global_text_shader, text, x, y, game_over_text_scale, text_color);
+                text_layout__draw(*global_text_shader, game_over_layout, x, y, text_color);
             }
 
             {  // Render Restart Text
@@ -722,21 +546,13 @@ void gameplay__render(Scene* scene)
                 initial_y -= game_over_height;
                 initial_y -= game_over_height / 4.0f;
 
-                std::string text = "Press <Enter> to restart.";
-
-                // Compute the total text width
-                float text_width = 0.0f;
-                for (char c : text)
-                {
-                    text_width += (Characters[c].Advance >> 6) * text_scale;  // Horizontal advance in pixels
-                }
+                const Text_Layout* layout = text_layout__get(&global_font, "Press <Enter> to restart.", text_scale);
 
                 // Adjust for centering
-                float x = initial_x - (text_width / 2.0f);
-                float y =
-                    initial_y - (Characters['H'].Size.y * text_scale / 2.0f);  // Use a sample character for height
+                float x = initial_x - (layout->width / 2.0f);
+                float y = initial_y - (layout->height / 2.0f);
 
-                RenderText(*global_text_shader, text, x, y, text_scale, text_color);
+                text_layout__draw(*global_text_shader, layout, x, y, text_color);
             }
         }
     }
@@ -751,26 +567,13 @@ void gameplay__render(Scene* scene)
             real32 size_ratio = 0.75f;
             float text_scale = size_ratio / FONT_SCALE_FACTOR;
 
-            std::string text = "PAUSED";
-
-            // Compute the total text width
-            float text_width = 0.0f;
-            for (char c : text)
-            {
-                text_width += (Characters[c].Advance >> 6) * text_scale;  // Horizontal advance in pixels
-            }
-            // Compute the total text width
-            float snake_game_text_width = 0.0f;
-            for (char c : text)
-            {
-                snake_game_text_width += (Characters[c].Advance >> 6) * text_scale;  // Horizontal advance in pixels
-            }
+            const Text_Layout* layout = text_layout__get(&global_font, "PAUSED", text_scale);
 
             // Adjust for centering
-            float x = initial_x - (snake_game_text_width / 2.0f);
-            float y = initial_y - (Characters['H'].Size.y * text_scale / 2.0f);  // Use a sample character for height
+            float x = initial_x - (layout->width / 2.0f);
+            float y = initial_y - (layout->height / 2.0f);
 
-            RenderText(*global_text_shader, text, x, y, text_scale, text_color);
+            text_layout__draw(*global_text_shader, layout, x, y, text_color);
         }
     }
 }
\ No newline at end of file
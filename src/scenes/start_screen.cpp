@@ -3,7 +3,11 @@
 typedef enum
 {
     Start_Screen_Option__Start_Game,
+    Start_Screen_Option__Autopilot,
+    Start_Screen_Option__Arena,
     Start_Screen_Option__Exit_Game,
+
+    Start_Screen_Option__Count,  // Should be the last item
 } Start_Screen__Option;
 
 struct Start_Screen__State
@@ -22,6 +26,7 @@ void start_screen__reset_state(Scene* scene)
     state->is_starting = 1;
     state->blink_color = white;
     state->current_option = Start_Screen_Option__Start_Game;
+    scene->has_visual_changes = 1;
 }
 
 void start_screen__handle_input(Scene* scene, Input* input)
@@ -30,9 +35,21 @@ void start_screen__handle_input(Scene* scene, Input* input)
 
     if (pressed(BUTTON_ENTER) && state->current_option == Start_Screen_Option__Start_Game)
     {
+        global_autopilot_enabled = 0;
+        global_next_scene = &global_gameplay_scene;
+    }
+
+    if (pressed(BUTTON_ENTER) && state->current_option == Start_Screen_Option__Autopilot)
+    {
+        global_autopilot_enabled = 1;  // Plays by itself until escape
         global_next_scene = &global_gameplay_scene;
     }
 
+    if (pressed(BUTTON_ENTER) && state->current_option == Start_Screen_Option__Arena)
+    {
+        global_next_scene = &global_arena_scene;  // Thousands of snakes steering themselves
+    }
+
     if (pressed(BUTTON_ENTER) && state->current_option == Start_Screen_Option__Exit_Game)
     {
         global_running = 0;
@@ -41,30 +58,18 @@ void start_screen__handle_input(Scene* scene, Input* input)
     if (pressed(BUTTON_D) || pressed(BUTTON_A))
     {
         play_sound_effect(global_audio_context.effect_beep);
+        scene->has_visual_changes = 1;
     }
 
     if (pressed(BUTTON_D))
     {
-        if (state->current_option == Start_Screen_Option__Start_Game)
-        {
-            state->current_option = Start_Screen_Option__Exit_Game;
-        }
-        else if (state->current_option == Start_Screen_Option__Exit_Game)
-        {
-            state->current_option = Start_Screen_Option__Start_Game;
-        }
+        state->current_option = (Start_Screen__Option)((state->current_option + 1) % Start_Screen_Option__Count);
     }
 
     if (pressed(BUTTON_A))
     {
-        if (state->current_option == Start_Screen_Option__Start_Game)
-        {
-            state->current_option = Start_Screen_Option__Exit_Game;
-        }
-        else if (state->current_option == Start_Screen_Option__Exit_Game)
-        {
-            state->current_option = Start_Screen_Option__Start_Game;
-        }
+        state->current_option = (Start_Screen__Option)((state->current_option + Start_Screen_Option__Count - 1) %
+                                                       Start_Screen_Option__Count);
     }
 }
 
@@ -105,11 +110,17 @@ void start_screen__update(struct Scene* scene, real64 simulation_time_elapsed, r
         {
             global_marker = global_next_marker;
         }
+        scene->has_visual_changes = 1;
     }
 
     global_tick_time_remaining -= dt_s;
 }
 
+real32 start_screen__seconds_until_next_change(Scene* scene)
+{
+    return global_tick_time_remaining;  // Next blink
+}
+
 void start_screen__render(Scene* scene)
 {
     Start_Screen__State* state = (Start_Screen__State*)scene->state;
@@ -119,27 +130,18 @@ void start_screen__render(Scene* scene)
         float snake_game_initial_y = LOGICAL_HEIGHT * 3.0f / 4.0f;
         glm::vec3 text_color = white;
 
-        std::string snake_game_text = "Snake Game";
         float snake_game_text_scale = 2.0f / FONT_SCALE_FACTOR;
-
-        // Compute the total text width
-        float snake_game_text_width = 0.0f;
-        for (char c : snake_game_text)
-        {
-            snake_game_text_width +=
-                (Characters[c].Advance >> 6) * snake_game_text_scale;  // Horizontal advance in pixels
-        }
+        const Text_Layout* layout = text_layout__get(&global_font, "Snake Game", snake_game_text_scale);
 
         // Adjust for centering
-        float snake_game_x = snake_game_initial_x - (snake_game_text_width / 2.0f);
-        float snake_game_y = snake_game_initial_y - (Characters['H'].Size.y * snake_game_text_scale /
-                                                     2.0f);  // Use a sample character for height
+        float snake_game_x = snake_game_initial_x - (layout->width / 2.0f);
+        float snake_game_y = snake_game_initial_y - (layout->height / 2.0f);
 
-        RenderText(*global_text_shader, snake_game_text, snake_game_x, snake_game_y, snake_game_text_scale, text_color);
+        text_layout__draw(*global_text_shader, layout, snake_game_x, snake_game_y, text_color);
     }
 
     {  // Start Text
-        float start_initial_x = LOGICAL_WIDTH * 1.0f / 4.0f;
+        float start_initial_x = LOGICAL_WIDTH * 1.0f / 5.0f;
         float start_initial_y = LOGICAL_HEIGHT * 1.0f / 4.0f;
         glm::vec3 text_color = white;
         if (state->current_option == Start_Screen_Option__Start_Game)
@@ -147,26 +149,56 @@ void start_screen__render(Scene* scene)
             text_color = state->blink_color;
         }
 
-        std::string start_text = "Start";
         float start_text_scale = 1.0f / FONT_SCALE_FACTOR;
+        const Text_Layout* layout = text_layout__get(&global_font, "Start", start_text_scale);
+
+        // Adjust for centering
+        float start_x = start_initial_x - (layout->width / 2.0f);
+        float start_y = start_initial_y + layout->height;
+
+        text_layout__draw(*global_text_shader, layout, start_x, start_y, text_color);
+    }
+
+    {  // Autopilot Text
+        float autopilot_initial_x = LOGICAL_WIDTH * 2.0f / 5.0f;
+        float autopilot_initial_y = LOGICAL_HEIGHT * 1.0f / 4.0f;
+        glm::vec3 text_color = white;
+        if (state->current_option == Start_Screen_Option__Autopilot)
+        {
+            text_color = state->blink_color;
+        }
 
-        // Compute the total text width
-        float start_text_width = 0.0f;
-        for (char c : start_text)
+        float autopilot_text_scale = 1.0f / FONT_SCALE_FACTOR;
+        const Text_Layout* layout = text_layout__get(&global_font, "Autopilot", autopilot_text_scale);
+
+        // Adjust for centering
+        float autopilot_x = autopilot_initial_x - (layout->width / 2.0f);
+        float autopilot_y = autopilot_initial_y + layout->height;
+
+        text_layout__draw(*global_text_shader, layout, autopilot_x, autopilot_y, text_color);
+    }
+
+    {  // Arena Text
+        float arena_initial_x = LOGICAL_WIDTH * 3.0f / 5.0f;
+        float arena_initial_y = LOGICAL_HEIGHT * 1.0f / 4.0f;
+        glm::vec3 text_color = white;
+        if (state->current_option == Start_Screen_Option__Arena)
         {
-            start_text_width += (Characters[c].Advance >> 6) * start_text_scale;  // Horizontal advance in pixels
+            text_color = state->blink_color;
         }
 
+        float arena_text_scale = 1.0f / FONT_SCALE_FACTOR;
+        const Text_Layout* layout = text_layout__get(&global_font, "Arena", arena_text_scale);
+
         // Adjust for centering
-        float start_x = start_initial_x - (start_text_width / 2.0f);
-        float start_y =
-            start_initial_y + (Characters['H'].Size.y * start_text_scale);  // Use a sample character for height
+        float arena_x = arena_initial_x - (layout->width / 2.0f);
+        float arena_y = arena_initial_y + layout->height;
 
-        RenderText(*global_text_shader, start_text, start_x, start_y, start_text_scale, text_color);
+        text_layout__draw(*global_text_shader, layout, arena_x, arena_y, text_color);
     }
 
     {  // Exit Text
-        float exit_initial_x = LOGICAL_WIDTH * 3.0f / 4.0f;
+        float exit_initial_x = LOGICAL_WIDTH * 4.0f / 5.0f;
         float exit_initial_y = LOGICAL_HEIGHT * 1.0f / 4.0f;
         glm::vec3 text_color = white;
         if (state->current_option == Start_Screen_Option__Exit_Game)
@@ -174,21 +206,13 @@ void start_screen__render(Scene* scene)
             text_color = state->blink_color;
         }
 
-        std::string exit_text = "Exit";
         float exit_text_scale = 1.0f / FONT_SCALE_FACTOR;
-
-        // Compute the total text width
-        float exit_text_width = 0.0f;
-        for (char c : exit_text)
-        {
-            exit_text_width += (Characters[c].Advance >> 6) * exit_text_scale;  // Horizontal advance in pixels
-        }
+        const Text_Layout* layout = text_layout__get(&global_font, "Exit", exit_text_scale);
 
         // Adjust for centering
-        float exit_x = exit_initial_x - (exit_text_width / 2.0f);
-        float exit_y =
-            exit_initial_y + (Characters['H'].Size.y * exit_text_scale);  // Use a sample character for height
+        float exit_x = exit_initial_x - (layout->width / 2.0f);
+        float exit_y = exit_initial_y + layout->height;
 
-        RenderText(*global_text_shader, exit_text, exit_x, exit_y, exit_text_scale, text_color);
+        text_layout__draw(*global_text_shader, layout, exit_x, exit_y, text_color);
     }
 }
\ No newline at end of file
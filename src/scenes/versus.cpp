@@ -0,0 +1,275 @@
+#include <SDL3/SDL.h>
+
+#include "../audio.h"
+#include "../common.h"
+
+// Head-to-head against another machine (--host / --join), see netplay.cpp. The scene only collects the local player's
+// presses and hands one per tick to global_netplay_session, which does all the predicting and rolling back. What gets
+// drawn is a copy of the session's present state, so it works the same with the simulation thread.
+
+#define VERSUS_STATS_WINDOW_TICKS 100    // How often the netplay numbers on the debug overlay get recomputed
+#define VERSUS_WAITING_MESSAGE_TICKS 10  // Stalled this long before saying so, sitting out the odd tick is normal
+
+struct Versus__State
+{
+    bool32 is_starting;
+    bool32 is_host;
+    bool32 is_connected;        // Both sides have the board and the seed
+    uint32 waiting_tick_count;  // In a row, still connecting or the other side has fallen too far behind
+    Direction pending_input;    // Last press that hasn't made it into a tick yet
+
+    Versus_Simulation simulation;  // Copy of the session's, to draw
+    uint32 local_player;
+    uint32 last_round;
+
+    // Netplay numbers for the debug overlay, over the last VERSUS_STATS_WINDOW_TICKS
+    Netplay_Stats window_start_stats;
+    uint32 window_tick_count;
+    real32 rollbacks_per_second;
+    real32 resimulated_ticks_per_tick;
+    real32 resimulate__ms_per_second;
+    uint32 max_resimulated_ticks;
+};
+
+Netplay_Session global_netplay_session;  // Opened in main for --host or --join
+
+void versus__reset_state(Scene* scene)
+{
+    Versus__State* state = (Versus__State*)scene->state;
+    state->is_starting = 1;
+    state->is_host = global_netplay_session.is_host;
+    state->is_connected = global_netplay_session.is_started;
+    state->waiting_tick_count = 0;
+    state->pending_input = DIRECTION_NONE;
+    state->local_player = global_netplay_session.local_player;
+    state->last_round = 0;
+    state->window_start_stats = global_netplay_session.stats;
+    state->window_tick_count = 0;
+    scene->has_visual_changes = 1;
+}
+
+void versus__handle_input(Scene* scene, Input* input)
+{
+    Versus__State* state = (Versus__State*)scene->state;
+
+    if (pressed(BUTTON_ESCAPE))
+    {
+        global_next_scene = &global_start_screen_scene;  // The other side will be left waiting for us
+    }
+
+    if (pressed(BUTTON_W) || pressed(BUTTON_UP))
+    {
+        state->pending_input = DIRECTION_NORTH;
+    }
+
+    if (pressed(BUTTON_A) || pressed(BUTTON_LEFT))
+    {
+        state->pending_input = DIRECTION_WEST;
+    }
+
+    if (pressed(BUTTON_S) || pressed(BUTTON_DOWN))
+    {
+        state->pending_input = DIRECTION_SOUTH;
+    }
+
+    if (pressed(BUTTON_D) || pressed(BUTTON_RIGHT))
+    {
+        state->pending_input = DIRECTION_EAST;
+    }
+}
+
+//=======================================================
+// UPDATE
+//=======================================================
+
+void versus__update(struct Scene* scene, real64 simulation_time_elapsed, real32 dt_s)
+{
+    Versus__State* state = (Versus__State*)scene->state;
+    Netplay_Session* session = &global_netplay_session;
+
+    if (state->is_starting)
+    {
+        state->is_starting = 0;
+        play_music(global_audio_context.gameplay_background_music);
+        set_music_volume(100.f);
+    }
+
+    bool32 has_advanced = netplay__advance(session, state->pending_input, dt_s);
+    if (has_advanced)
+    {
+        state->pending_input = DIRECTION_NONE;
+        if (state->waiting_tick_count >= VERSUS_WAITING_MESSAGE_TICKS)
+        {
+            scene->has_visual_changes = 1;  // Take the message down
+        }
+        state->waiting_tick_count = 0;
+    }
+    else if (++state->waiting_tick_count == VERSUS_WAITING_MESSAGE_TICKS)
+    {
+        scene->has_visual_changes = 1;
+    }
+    if (!session->is_started)
+    {
+        return;
+    }
+    state->is_connected = 1;
+
+    {  // Draw whatever the session has now, rollbacks included
+        Versus_Simulation* sim = &state->simulation;
+        uint32 previous_ticks = sim->ticks;
+        memcpy(sim, &session->sim, sizeof(*sim));
+        if (sim->ticks != previous_ticks)
+        {
+            scene->has_visual_changes = 1;
+        }
+
+        if (has_advanced)
+        {
+            for (uint32 player = 0; player < VERSUS_PLAYER_COUNT; player++)
+            {
+                if (sim->snakes[player].has_eaten)
+                {
+                    play_sound_effect(global_audio_context.effect_beep_2);
+                }
+            }
+            if (sim->is_round_over && state->last_round != sim->round)
+            {
+                play_sound_effect(global_audio_context.effect_boom);
+                state->last_round = sim->round;
+            }
+        }
+    }
+
+    state->window_tick_count++;
+    if (state->window_tick_count == VERSUS_STATS_WINDOW_TICKS)
+    {
+        Netplay_Stats* now = &session->stats;
+        Netplay_Stats* then = &state->window_start_stats;
+        real32 seconds = VERSUS_STATS_WINDOW_TICKS * dt_s;
+        uint64 tick_count = now->tick_count - then->tick_count;
+
+        state->rollbacks_per_second = (real32)(now->rollback_count - then->rollback_count) / seconds;
+        state->resimulated_ticks_per_tick =
+            tick_count ? (real32)(now->resimulated_tick_count - then->resimulated_tick_count) / tick_count : 0.0f;
+        state->resimulate__ms_per_second =
+            (real32)((now->resimulate__seconds - then->resimulate__seconds) * 1000.0) / seconds;
+        state->max_resimulated_ticks = now->max_resimulated_ticks;
+
+        state->window_start_stats = *now;
+        state->window_tick_count = 0;
+    }
+}
+
+real32 versus__seconds_until_next_change(Scene* scene)
+{
+    return SIMULATION_DELTA_TIME_S;  // The session has to look for packets every tick
+}
+
+//=======================================================
+// RENDER
+//=======================================================
+
+local_internal void versus__push_sprite(const Atlas_Region* region, int32 cell_x, int32 cell_y, uint8 direction)
+{
+    Screen_Space_Position screen_pos =
+        map_world_space_position_to_screen_space_position((real32)cell_x, (real32)cell_y);
+    real32 size = (real32)(GRID_BLOCK_SIZE);
+    real32 x = screen_pos.x - ((real32)GRID_BLOCK_SIZE / 2);
+    real32 y = screen_pos.y - ((real32)GRID_BLOCK_SIZE / 2);
+    sprite_batch__push(&global_sprite_batch, region, x, y, get_angle_from_direction((Direction)direction), size);
+}
+
+local_internal void versus__draw_text(const char* text, real32 size_ratio, real32 center_x, real32 center_y)
+{
+    const Text_Layout* layout = text_layout__get(&global_font, text, size_ratio / FONT_SCALE_FACTOR);
+    text_layout__draw(
+        *global_text_shader, layout, center_x - layout->width / 2.0f, center_y - layout->height / 2.0f, white);
+}
+
+void versus__render(Scene* scene)
+{
+    Versus__State* state = (Versus__State*)scene->state;
+    Versus_Simulation* sim = &state->simulation;
+
+    float borderThickness = 2.0f;                // Border thickness
+    glm::vec3 borderColor(0.23f, 0.23f, 0.23f);  // Dark grey
+    glm::vec3 fillColor(0.16f, 0.16f, 0.16f);    // Lighter grey
+    draw_grid(*global_grid_shader, X_GRIDS, Y_GRIDS, (real32)GRID_BLOCK_SIZE, borderThickness, borderColor, fillColor);
+
+    if (!state->is_connected)
+    {
+        versus__draw_text(state->is_host ? "Waiting for someone to join..." : "Connecting...",
+                          0.75f,
+                          (real32)LOGICAL_WIDTH / 2,
+                          (real32)LOGICAL_HEIGHT / 2);
+        return;
+    }
+
+    versus__push_sprite(&global_egg_region, sim->egg_x, sim->egg_y, DIRECTION_NORTH);
+
+    for (uint32 player = 0; player < VERSUS_PLAYER_COUNT; player++)
+    {  // Walk each body from the tail up, the moves say where the next part is
+        Versus_Snake* snake = &sim->snakes[player];
+        int32 x = snake->tail_x;
+        int32 y = snake->tail_y;
+        for (uint32 i = 0; i < snake->length; i++)
+        {
+            uint8 direction = (uint8)versus_snake__move(snake, i);
+            versus__push_sprite(i == 0 ? &global_snake_tail_region : &global_snake_body_region, x, y, direction);
+            versus__direction_step(direction, &x, &y);
+        }
+        versus__push_sprite(&global_snake_head_region, snake->head_x, snake->head_y, snake->direction);
+    }
+
+    // One instanced draw per sprite texture, no matter how long the snakes get
+    sprite_batch__flush(&global_sprite_batch, *global_sprite_shader);
+
+    {  // Which one is ours
+        Versus_Snake* snake = &sim->snakes[state->local_player];
+        Screen_Space_Position screen_pos =
+            map_world_space_position_to_screen_space_position((real32)snake->head_x, (real32)snake->head_y);
+        versus__draw_text("YOU", 0.4f, screen_pos.x, screen_pos.y + (real32)GRID_BLOCK_SIZE);
+    }
+
+    {  // Rounds won, ours first
+        char score_text[64];
+        snprintf(score_text,
+                 sizeof(score_text),
+                 "YOU %u - %u THEM",
+                 sim->snakes[state->local_player].round_win_count,
+                 sim->snakes[1 - state->local_player].round_win_count);
+        versus__draw_text(score_text, 0.5f, (real32)LOGICAL_WIDTH / 2, (real32)LOGICAL_HEIGHT - 20.0f);
+    }
+
+    if (global_display_debug_info)
+    {  // How hard the rollback is working
+        char netplay_text[128];
+        snprintf(netplay_text,
+                 sizeof(netplay_text),
+                 "NETPLAY %.1f rollbacks/s, %.2f resimulated ticks/tick (max %u), %.3f ms/s resimulating",
+                 state->rollbacks_per_second,
+                 state->resimulated_ticks_per_tick,
+                 state->max_resimulated_ticks,
+                 state->resimulate__ms_per_second);
+
+        real32 text_scale = 0.5f / FONT_SCALE_FACTOR;
+        const Text_Layout* layout = text_layout__get(&global_font, netplay_text, text_scale);
+        real32 x = (real32)LOGICAL_WIDTH * 0.05f;
+        real32 y = (real32)LOGICAL_HEIGHT - 5.0f - layout->height;
+        text_layout__draw(*global_text_shader, layout, x, y, white);
+    }
+
+    if (sim->is_round_over)
+    {
+        const char* result_text = sim->winner == VERSUS_DRAW           ? "Draw"
+                                  : sim->winner == state->local_player ? "You Win"
+                                                                       : "You Lose";
+        versus__draw_text(result_text, 1.75f, 0.5f * (real32)LOGICAL_WIDTH, 0.75f * (real32)LOGICAL_HEIGHT);
+    }
+    else if (state->waiting_tick_count >= VERSUS_WAITING_MESSAGE_TICKS)
+    {
+        real32 x = (real32)LOGICAL_WIDTH / 2;
+        real32 y = (real32)LOGICAL_HEIGHT / 2;
+        versus__draw_text("Waiting for the other player...", 0.75f, x, y);
+    }
+}
@@ -22,9 +22,20 @@ struct Button_State
     bool32 changed;
 };
 
+#define INPUT_MAX_PRESSES 16
+
+// A key going down, in the order they happened, so two taps between frames both count
+struct Input_Press
+{
+    uint32 button;
+    Uint64 timestamp__ns;  // From the SDL_Event, same clock as SDL_GetTicksNS
+};
+
 struct Input
 {
     Button_State buttons[BUTTON_COUNT];
+    Input_Press presses[INPUT_MAX_PRESSES];  // Since the last handle_events
+    uint32 press_count;
 };
 
 #define is_down(b) input->buttons[b].is_down
@@ -40,6 +51,7 @@ struct Input
         {                                                                         \
             input->buttons[button].changed = input->buttons[button].is_down == 0; \
             input->buttons[button].is_down = 1;                                   \
+            input__add_press(input, button, event);                               \
         }                                                                         \
         else                                                                      \
         {                                                                         \
@@ -49,12 +61,29 @@ struct Input
     }                                                                             \
     break;
 
+local_internal void input__add_press(Input* input, uint32 button, SDL_Event* event)
+{
+    if (event->key.repeat)
+    {
+        return;
+    }
+    if (input->press_count < INPUT_MAX_PRESSES)
+    {
+        input->presses[input->press_count].button = button;
+        input->presses[input->press_count].timestamp__ns = event->key.timestamp;
+        input->press_count++;
+    }
+    // How long it sat in the queue before we got to it
+    input_latency__record(&global_input_latency, INPUT_LATENCY_STAGE_EVENT, event->key.timestamp, SDL_GetTicksNS());
+}
+
 void handle_events(SDL_Event* event, Input* input)
 {
     for (int i = 0; i < BUTTON_COUNT; i++)
     {
         input->buttons[i].changed = false;
     }
+    input->press_count = 0;
 
     while (SDL_PollEvent(event))
     {
@@ -85,6 +114,7 @@ void handle_events(SDL_Event* event, Input* input)
                         case SDL_SCANCODE_GRAVE:  // Backquote key
                         {
                             global_display_debug_info = !global_display_debug_info;
+                            global_window_needs_redraw = 1;
                         }
                         break;
 
@@ -114,6 +144,22 @@ void handle_events(SDL_Event* event, Input* input)
                 // std::cout << "Mouse wheel: delta = " << event->wheel.y << std::endl;
                 break;
 
+            case SDL_EVENT_WINDOW_EXPOSED:
+            case SDL_EVENT_WINDOW_SHOWN:
+            case SDL_EVENT_WINDOW_RESTORED:
+            case SDL_EVENT_WINDOW_RESIZED:
+            case SDL_EVENT_WINDOW_PIXEL_SIZE_CHANGED:
+            case SDL_EVENT_WINDOW_DISPLAY_CHANGED:
+            {
+                // Whatever was on screen may be gone or stretched, draw it again
+                global_window_needs_redraw = 1;
+                frame_pacer__read_refresh_rate(&global_frame_pacer, global_window);  // The new one may refresh faster
+            } break;
+            case SDL_EVENT_DISPLAY_CURRENT_MODE_CHANGED:
+            {
+                frame_pacer__read_refresh_rate(&global_frame_pacer, global_window);
+            } break;
+
             case SDL_EVENT_WINDOW_CLOSE_REQUESTED:
             case SDL_EVENT_QUIT:
             {
@@ -4,11 +4,17 @@ layout (location = 1) in vec2 aTexCoord;
 
 out vec2 TexCoord;
 
-uniform mat4 projection;
+layout (std140) uniform Frame_Uniforms
+{
+    mat4 projection;
+    vec2 logical_size;
+    float simulation_time;  // Seconds
+};
 uniform mat4 model;
+uniform vec4 uv_rect; // <vec2 uv bottom-left, vec2 uv top-right>, (0, 0, 1, 1) for the whole texture
 
 void main()
 {
     gl_Position = projection * model * vec4(aPos, 0.0, 1.0);
-    TexCoord = aTexCoord;
+    TexCoord = mix(uv_rect.xy, uv_rect.zw, aTexCoord);
 }
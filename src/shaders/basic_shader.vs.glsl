@@ -3,7 +3,12 @@
 // Input vertex attributes (from vertex buffer)
 layout (location = 0) in vec2 aPos;  // Position: x, y
 
-uniform mat4 projection;
+layout (std140) uniform Frame_Uniforms
+{
+    mat4 projection;
+    vec2 logical_size;
+    float simulation_time;  // Seconds
+};
 uniform mat4 model;
 
 void main() {
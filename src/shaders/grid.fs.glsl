@@ -0,0 +1,23 @@
+#version 330 core
+in vec2 GridPos;
+out vec4 FragColor;
+
+uniform float block_size;        // Logical pixels per cell
+uniform float border_thickness;  // Logical pixels between two neighbouring cells
+uniform vec3 border_color;
+uniform vec3 fill_color;
+
+void main()
+{
+    // Distance to the nearest edge of the cell this fragment is in
+    vec2 in_cell = mod(GridPos, block_size);
+    vec2 to_edge = min(in_cell, block_size - in_cell);
+    float distance = min(to_edge.x, to_edge.y);
+
+    // Each cell owns half of the border on its side, blend across one screen pixel so it holds up at any resolution
+    float half_border = border_thickness * 0.5;
+    float aaf = fwidth(distance) * 0.5;
+    float fill = smoothstep(half_border - aaf, half_border + aaf, distance);
+
+    FragColor = vec4(mix(border_color, fill_color, fill), 1.0);
+}
@@ -0,0 +1,20 @@
+#version 330 core
+layout (location = 0) in vec2 aPos;
+layout (location = 1) in vec2 aTexCoord;
+
+out vec2 GridPos;  // Logical pixels from the grid's bottom-left corner
+
+layout (std140) uniform Frame_Uniforms
+{
+    mat4 projection;
+    vec2 logical_size;
+    float simulation_time;  // Seconds
+};
+uniform mat4 model;
+uniform vec2 grid_size;  // Logical pixels covered by the whole grid
+
+void main()
+{
+    gl_Position = projection * model * vec4(aPos, 0.0, 1.0);
+    GridPos = aTexCoord * grid_size;
+}
@@ -0,0 +1,30 @@
+#version 330 core
+layout (location = 0) in vec2 aPos;
+layout (location = 1) in vec2 aTexCoord;
+// Per-instance attributes (divisor 1)
+layout (location = 2) in vec4 aSprite; // <vec2 center, float size, float angle (radians)>
+layout (location = 3) in vec4 aUVRect; // <vec2 uv bottom-left, vec2 uv top-right> of the sprite in the atlas
+
+out vec2 TexCoord;
+
+layout (std140) uniform Frame_Uniforms
+{
+    mat4 projection;
+    vec2 logical_size;
+    float simulation_time;  // Seconds
+};
+
+void main()
+{
+    vec2 center = aSprite.xy;
+    float size = aSprite.z;
+    float angle = aSprite.w;
+
+    // Same as translate * scale * rotate on the unit quad
+    float c = cos(angle);
+    float s = sin(angle);
+    vec2 rotated = vec2(aPos.x * c - aPos.y * s, aPos.x * s + aPos.y * c);
+
+    gl_Position = projection * vec4(center + rotated * size, 0.0, 1.0);
+    TexCoord = mix(aUVRect.xy, aUVRect.zw, aTexCoord);
+}
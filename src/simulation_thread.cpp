@@ -0,0 +1,212 @@
+// Simulation thread
+//
+// Optional mode (SIMULATION_THREAD_ENABLED, or run with --simulation-thread) where scene input handling and the
+// fixed-step updates run on their own thread at SIMULATION_FPS. A slow swap can't delay a tick and a burst of ticks
+// can't delay a frame.
+//
+// The main thread still pumps SDL events (it has to) and queues any button changes for the simulation under a mutex.
+// After every tick the simulation copies the current scene's state into the back slot of a lock-free triple buffer and
+// swaps it in as the latest. The render thread swaps the latest one out whenever it starts a frame. Neither side ever
+// waits on the other, and the render thread always draws the newest complete state.
+//
+// NOTE: While the thread runs it owns global_current_scene, global_next_scene and all scene state. The render thread
+// must only look at snapshots.
+
+#define SIMULATION_SNAPSHOT_COUNT 3
+#define SIMULATION_SNAPSHOT_FRESH_BIT 0x4  // Set on the shared index when it holds a snapshot the renderer hasn't seen
+#define SIMULATION_MAX_CATCH_UP__SECONDS 0.25f
+
+struct Simulation_Snapshot
+{
+    Scene* scene;
+    std::vector<uint8> state;  // Copy of scene->state (made by scene->copy_state if it has one)
+
+    uint32 visual_change_count;  // Bumped every tick the scene had visual changes (so skipped snapshots don't lose any)
+    real64 simulation_time_elapsed__seconds;
+    real32 tick_jitter_mean__ms;
+    real32 tick_jitter_max__ms;
+    uint64 input_latency_tick;  // global_input_latency.tick it was taken at, presses acted on before it are in it
+};
+
+struct Simulation_Thread
+{
+    SDL_Thread* thread;
+    SDL_AtomicInt should_quit;
+    Uint32 wake_event_type;  // Pushed to the main thread whenever there's something new to present
+
+    SDL_Mutex* input_mutex;
+    std::vector<Input> pending_inputs;
+
+    Simulation_Snapshot snapshots[SIMULATION_SNAPSHOT_COUNT];
+    SDL_AtomicInt shared_index;  // Latest published snapshot (| SIMULATION_SNAPSHOT_FRESH_BIT)
+    uint32 back_index;           // Only touched by the simulation thread
+    uint32 front_index;          // Only touched by the render thread
+
+    // Simulation thread only
+    uint32 visual_change_count;
+    real64 simulation_time_elapsed__seconds;
+    Tick_Jitter tick_jitter;
+};
+
+Simulation_Thread global_simulation_thread;
+
+local_internal void simulation_thread__write_snapshot(Simulation_Thread* sim, Simulation_Snapshot* snapshot)
+{
+    Scene* scene = global_current_scene;
+    snapshot->scene = scene;
+    if (scene->copy_state)
+    {
+        scene->copy_state(scene, &snapshot->state);
+    }
+    else
+    {
+        snapshot->state.resize(scene->state_size);
+        memcpy(&snapshot->state[0], scene->state, scene->state_size);
+    }
+    snapshot->visual_change_count = sim->visual_change_count;
+    snapshot->simulation_time_elapsed__seconds = sim->simulation_time_elapsed__seconds;
+    snapshot->tick_jitter_mean__ms = sim->tick_jitter.last_mean__ms;
+    snapshot->tick_jitter_max__ms = sim->tick_jitter.last_max__ms;
+    snapshot->input_latency_tick = global_input_latency.tick;
+}
+
+local_internal void simulation_thread__publish(Simulation_Thread* sim)
+{
+    bool32 has_visual_changes = global_current_scene->has_visual_changes;
+    if (has_visual_changes)
+    {
+        sim->visual_change_count++;
+        global_current_scene->has_visual_changes = 0;
+    }
+
+    simulation_thread__write_snapshot(sim, &sim->snapshots[sim->back_index]);
+
+    // The atomic swap is a full barrier, so the snapshot is completely written before the renderer can see it
+    int32 previous = SDL_SetAtomicInt(&sim->shared_index, (int32)(sim->back_index | SIMULATION_SNAPSHOT_FRESH_BIT));
+    sim->back_index = (uint32)previous & ~SIMULATION_SNAPSHOT_FRESH_BIT;
+
+    if (has_visual_changes)
+    {
+        SDL_Event event = {};
+        event.type = sim->wake_event_type;
+        SDL_PushEvent(&event);
+    }
+}
+
+local_internal int simulation_thread__run(void* data)
+{
+    Simulation_Thread* sim = (Simulation_Thread*)data;
+
+    Uint64 counter_frequency = SDL_GetPerformanceFrequency();
+    Uint64 tick__ns = (Uint64)(SIMULATION_DELTA_TIME_S * SDL_NS_PER_SECOND);
+    Uint64 next_tick__ns = SDL_GetTicksNS();
+    std::vector<Input> inputs;
+
+    while (!SDL_GetAtomicInt(&sim->should_quit))
+    {
+        {  // Input
+            SDL_LockMutex(sim->input_mutex);
+            inputs.swap(sim->pending_inputs);
+            SDL_UnlockMutex(sim->input_mutex);
+
+            for (uint32 i = 0; i < inputs.size(); i++)
+            {
+                global_current_scene->handle_input(global_current_scene, &inputs[i]);
+            }
+            inputs.clear();
+        }
+
+        scene_manager__switch_to_next_scene();
+
+        global_current_scene->update(
+            global_current_scene, sim->simulation_time_elapsed__seconds, SIMULATION_DELTA_TIME_S);
+        sim->simulation_time_elapsed__seconds += SIMULATION_DELTA_TIME_S;
+        input_latency__end_tick(&global_input_latency);
+        tick_jitter__record(&sim->tick_jitter, SDL_GetPerformanceCounter(), counter_frequency);
+
+        simulation_thread__publish(sim);
+
+        next_tick__ns += tick__ns;
+        Uint64 now__ns = SDL_GetTicksNS();
+        if (now__ns > next_tick__ns + (Uint64)(SIMULATION_MAX_CATCH_UP__SECONDS * SDL_NS_PER_SECOND))
+        {
+            // We fell way behind (e.g. the debugger paused us), don't try to catch up all at once
+            next_tick__ns = now__ns;
+        }
+        if (next_tick__ns > now__ns)
+        {
+            SDL_DelayPrecise(next_tick__ns - now__ns);
+        }
+    }
+
+    return 0;
+}
+
+bool32 simulation_thread__start(Simulation_Thread* sim, real64 simulation_time_elapsed__seconds)
+{
+    sim->wake_event_type = SDL_RegisterEvents(1);
+    sim->input_mutex = SDL_CreateMutex();
+    if (!sim->wake_event_type || !sim->input_mutex)
+    {
+        fprintf(stderr, "ERROR::SIMULATION_THREAD: %s\n", SDL_GetError());
+        return 0;
+    }
+
+    sim->simulation_time_elapsed__seconds = simulation_time_elapsed__seconds;
+    sim->tick_jitter = Tick_Jitter();
+
+    // Every slot has to be able to hold the biggest scene's state
+    size_t max_state_size = SDL_max(global_start_screen_scene.state_size, global_gameplay_scene.state_size);
+    for (uint32 i = 0; i < SIMULATION_SNAPSHOT_COUNT; i++)
+    {
+        sim->snapshots[i].state.resize(max_state_size);
+        simulation_thread__write_snapshot(sim, &sim->snapshots[i]);
+    }
+    sim->front_index = 0;
+    sim->back_index = 1;
+    SDL_SetAtomicInt(&sim->shared_index, 2);
+    SDL_SetAtomicInt(&sim->should_quit, 0);
+
+    sim->thread = SDL_CreateThread(simulation_thread__run, "Simulation", sim);
+    if (!sim->thread)
+    {
+        fprintf(stderr, "ERROR::SIMULATION_THREAD: %s\n", SDL_GetError());
+        return 0;
+    }
+
+    return 1;
+}
+
+void simulation_thread__stop(Simulation_Thread* sim)
+{
+    SDL_SetAtomicInt(&sim->should_quit, 1);
+    SDL_WaitThread(sim->thread, NULL);
+    sim->thread = 0;
+    SDL_DestroyMutex(sim->input_mutex);
+}
+
+// Only queues anything when a button actually changed, scenes only react to presses
+void simulation_thread__push_input(Simulation_Thread* sim, Input* input)
+{
+    for (uint32 i = 0; i < BUTTON_COUNT; i++)
+    {
+        if (input->buttons[i].changed)
+        {
+            SDL_LockMutex(sim->input_mutex);
+            sim->pending_inputs.push_back(*input);
+            SDL_UnlockMutex(sim->input_mutex);
+            return;
+        }
+    }
+}
+
+// Called from the render thread. The snapshot stays untouched by the simulation until the next call.
+const Simulation_Snapshot* simulation_thread__latest_snapshot(Simulation_Thread* sim)
+{
+    if (SDL_GetAtomicInt(&sim->shared_index) & SIMULATION_SNAPSHOT_FRESH_BIT)
+    {
+        int32 previous = SDL_SetAtomicInt(&sim->shared_index, (int32)sim->front_index);
+        sim->front_index = (uint32)previous & ~SIMULATION_SNAPSHOT_FRESH_BIT;
+    }
+    return &sim->snapshots[sim->front_index];
+}
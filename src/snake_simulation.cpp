@@ -0,0 +1,547 @@
+// Snake simulation
+//
+// The rules of the game and nothing else. No SDL, GL, audio or globals: the board size, RNG and input queue all live in
+// Snake_Simulation, so the same code runs inside the game, in the headless runner (headless_main.cpp) and when playing
+// back replays. Anything that should reach the outside world (sounds, the replay recorder, ...) is emitted as an event
+// that whoever stepped the simulation acts on afterwards.
+//
+// Needs common.h, memory_arena.cpp and replay.cpp included before it.
+
+#include <assert.h>
+#include <chrono>
+
+typedef enum
+{
+    DIRECTION_NONE,  // Represents no movement
+    DIRECTION_NORTH,
+    DIRECTION_EAST,
+    DIRECTION_SOUTH,
+    DIRECTION_WEST
+} Direction;
+
+struct Snake_Part
+{
+    int32 pos_x;
+    int32 pos_y;
+    Direction direction;
+};
+
+typedef enum
+{
+    SNAKE_EVENT_ATE_EGG,
+    SNAKE_EVENT_GAME_OVER,
+    SNAKE_EVENT_WON,  // Filled the whole board, the game's over without a crash
+} Snake_Event;
+
+#define SNAKE_MAX_QUEUED_INPUTS 10
+#define SNAKE_MAX_EVENTS 4
+#define SNAKE_STARTING_GRID_JUMP__SECONDS .1f
+
+struct Snake_Simulation
+{
+    uint32 x_grids;
+    uint32 y_grids;
+
+    bool32 game_over;
+
+    int32 pos_x;
+    int32 pos_y;
+
+    // Circular buffer of body parts, walk it with snake_simulation__part. Part 0 is right behind the head and the last
+    // part is the tail, so moving only writes the new part 0 and the old tail falls off the end by itself.
+    Snake_Part* snake_parts;
+    uint32 snake_parts_capacity;   // One per cell, the body can never be longer than the board
+    uint32 snake_parts_first;      // Where part 0 lives in snake_parts
+    uint32 next_snake_part_index;  // How many parts there are
+
+    Direction current_direction;
+
+    real32 time_until_grid_jump__seconds;
+    real32 set_time_until_grid_jump__seconds;
+
+    uint32 ticks;  // Steps that actually simulated something (not game over), replays are stamped with it
+
+    int32 blip_pos_x;
+    int32 blip_pos_y;
+
+    uint32 rng;  // LCG state, the egg spawns are the only thing that uses it
+
+    // Directions waiting to be applied, one per grid jump
+    Direction input_queue[SNAKE_MAX_QUEUED_INPUTS];
+    int32 input_head;  // Points to the current input to be processed
+    int32 input_tail;  // Points to the next free spot for adding input
+
+    // Cells taken by the snake (head and body), one bit each, kept in sync as it moves. Cell index is y * x_grids + x.
+    // The bits past the last cell are set so they never count as free.
+    uint64* occupied_cells;
+    uint32 occupied_word_count;
+    uint32 free_cell_count;
+
+    // What happened during the last step
+    Snake_Event events[SNAKE_MAX_EVENTS];
+    uint32 event_count;
+
+    // Backs snake_parts and the cell arrays, sized from the board on reset
+    Memory_Arena arena;
+};
+
+//=======================================================
+// RNG
+//=======================================================
+
+#define LCG_A 1664525u
+#define LCG_C 1013904223u
+
+uint32 snake_rng__next(uint32* rng)
+{
+    *rng = LCG_A * *rng + LCG_C;
+    return *rng;
+}
+
+// Between 0 and max - 1 (inclusive)
+uint32 snake_simulation__rand_range(Snake_Simulation* sim, uint32 max)
+{
+    return snake_rng__next(&sim->rng) % max;
+}
+
+//=======================================================
+// BODY AND CELLS
+//=======================================================
+
+// i = 0 is the part right behind the head
+Snake_Part* snake_simulation__part(Snake_Simulation* sim, uint32 i)
+{
+    return &sim->snake_parts[(sim->snake_parts_first + i) % sim->snake_parts_capacity];
+}
+
+uint32 snake_simulation__cell_index(Snake_Simulation* sim, int32 x, int32 y)
+{
+    return (uint32)y * sim->x_grids + (uint32)x;
+}
+
+bool32 snake_simulation__is_cell_occupied(Snake_Simulation* sim, int32 x, int32 y)
+{
+    uint32 cell = snake_simulation__cell_index(sim, x, y);
+    return (sim->occupied_cells[cell / 64] >> (cell % 64)) & 1;
+}
+
+void snake_simulation__occupy_cell(Snake_Simulation* sim, int32 x, int32 y)
+{
+    uint32 cell = snake_simulation__cell_index(sim, x, y);
+    assert(!snake_simulation__is_cell_occupied(sim, x, y));
+
+    sim->occupied_cells[cell / 64] |= (uint64)1 << (cell % 64);
+    sim->free_cell_count--;
+}
+
+void snake_simulation__free_cell(Snake_Simulation* sim, int32 x, int32 y)
+{
+    uint32 cell = snake_simulation__cell_index(sim, x, y);
+    assert(snake_simulation__is_cell_occupied(sim, x, y));
+
+    sim->occupied_cells[cell / 64] &= ~((uint64)1 << (cell % 64));
+    sim->free_cell_count++;
+}
+
+uint32 snake_simulation__count_bits(uint64 x)
+{
+    // Portable popcount, there's no std::popcount before C++20
+    x = x - ((x >> 1) & 0x5555555555555555ULL);
+    x = (x & 0x3333333333333333ULL) + ((x >> 2) & 0x3333333333333333ULL);
+    x = (x + (x >> 4)) & 0x0F0F0F0F0F0F0F0FULL;
+    return (uint32)((x * 0x0101010101010101ULL) >> 56);
+}
+
+// The n-th free cell counting up from cell 0 (n = 0 is the first one). Only depends on which cells are taken, not on
+// the order they were taken in. O(cells / 64), it's the fallback when random probes keep hitting the body.
+uint32 snake_simulation__nth_free_cell(const uint64* occupied_cells, uint32 word_count, uint32 n)
+{
+    for (uint32 word = 0; word < word_count; word++)
+    {
+        uint64 free_bits = ~occupied_cells[word];
+        uint32 free_count = snake_simulation__count_bits(free_bits);
+        if (n >= free_count)
+        {
+            n -= free_count;
+            continue;
+        }
+
+        // Skip whole bytes, then find the bit within the last one
+        uint32 bit = 0;
+        uint32 byte_free_count = snake_simulation__count_bits(free_bits & 0xFF);
+        while (n >= byte_free_count)
+        {
+            n -= byte_free_count;
+            bit += 8;
+            byte_free_count = snake_simulation__count_bits((free_bits >> bit) & 0xFF);
+        }
+        for (;; bit++)
+        {
+            if ((free_bits >> bit) & 1)
+            {
+                if (!n)
+                {
+                    return word * 64 + bit;
+                }
+                n--;
+            }
+        }
+    }
+
+    assert(!"Fewer free cells than asked for");
+    return 0;
+}
+
+#define SNAKE_FREE_CELL_PROBES 8  // Random cells tried before falling back to counting, plenty while the board has room
+
+// A uniformly random free cell, there has to be one. Eggs spawn with this. A few random cells get tried against the
+// bitmap first, which is O(1) while the board is mostly empty, and only a crowded board falls back to
+// snake_simulation__nth_free_cell. Either way the pick only depends on the RNG and which cells are taken, so a restored
+// snapshot (snapshot.cpp) spawns the same eggs as the game it was saved from. The batch environment uses it too.
+uint32 snake_simulation__random_free_cell(
+    const uint64* occupied_cells, uint32 word_count, uint32 cell_count, uint32 free_cell_count, uint32* rng)
+{
+    for (uint32 probe = 0; probe < SNAKE_FREE_CELL_PROBES; probe++)
+    {
+        uint32 cell = snake_rng__next(rng) % cell_count;
+        if (!((occupied_cells[cell / 64] >> (cell % 64)) & 1))
+        {
+            return cell;
+        }
+    }
+    return snake_simulation__nth_free_cell(occupied_cells, word_count, snake_rng__next(rng) % free_cell_count);
+}
+
+//=======================================================
+// SETUP AND INPUT
+//=======================================================
+
+bool32 snake_simulation__reset(Snake_Simulation* sim, uint32 x_grids, uint32 y_grids, uint32 seed)
+{
+    sim->x_grids = x_grids;
+    sim->y_grids = y_grids;
+    sim->game_over = 0;
+
+    sim->pos_x = x_grids / 2;
+    sim->pos_y = y_grids / 4;
+    sim->current_direction = DIRECTION_NORTH;
+    sim->snake_parts_first = 0;
+    sim->next_snake_part_index = 0;
+
+    sim->set_time_until_grid_jump__seconds = SNAKE_STARTING_GRID_JUMP__SECONDS;
+    sim->time_until_grid_jump__seconds = sim->set_time_until_grid_jump__seconds;
+    sim->ticks = 0;
+
+    sim->blip_pos_x = x_grids / 2;
+    sim->blip_pos_y = y_grids / 2;
+
+    sim->rng = seed;
+    sim->input_head = 0;
+    sim->input_tail = 0;
+    sim->event_count = 0;
+
+    uint32 cell_count = x_grids * y_grids;
+    {  // Storage for the body and cells, everything the snake could ever need on this board
+        uint32 word_count = (cell_count + 63) / 64;
+        size_t arena_size = memory_arena__array_size(Snake_Part, cell_count) +
+                            memory_arena__array_size(uint64, word_count);
+        if (!memory_arena__reserve(&sim->arena, arena_size))
+        {
+            fprintf(stderr, "ERROR::SNAKE_SIMULATION: Not enough memory for a %ux%u board\n", x_grids, y_grids);
+            return 0;
+        }
+        sim->snake_parts = memory_arena__push_array(&sim->arena, Snake_Part, cell_count);
+        sim->snake_parts_capacity = cell_count;
+        sim->occupied_cells = memory_arena__push_array(&sim->arena, uint64, word_count);
+        sim->occupied_word_count = word_count;
+    }
+
+    {  // Every cell is free apart from the head's
+        memset(sim->occupied_cells, 0, sim->occupied_word_count * sizeof(uint64));
+        if (cell_count % 64)
+        {
+            sim->occupied_cells[cell_count / 64] = ~(uint64)0 << (cell_count % 64);
+        }
+        sim->free_cell_count = cell_count;
+        snake_simulation__occupy_cell(sim, sim->pos_x, sim->pos_y);
+    }
+
+    return 1;
+}
+
+void snake_simulation__free(Snake_Simulation* sim)
+{
+    memory_arena__free(&sim->arena);
+}
+
+void snake_simulation__queue_input(Snake_Simulation* sim, Direction direction)
+{
+    int32 next_tail = (sim->input_tail + 1) % SNAKE_MAX_QUEUED_INPUTS;
+    if (next_tail != sim->input_head)  // Only add if there's space in the queue
+    {
+        sim->input_queue[sim->input_tail] = direction;
+        sim->input_tail = next_tail;
+    }
+}
+
+// Does the next step of dt_s make the snake jump? Lets a controller pick a direction right before it's needed.
+bool32 snake_simulation__jumps_next_step(Snake_Simulation* sim, real32 dt_s)
+{
+    return !sim->game_over && sim->time_until_grid_jump__seconds - dt_s <= 0;
+}
+
+local_internal Direction snake_simulation__next_input(Snake_Simulation* sim)
+{
+    if (sim->input_head == sim->input_tail)
+    {
+        return DIRECTION_NONE;
+    }
+    Direction direction = sim->input_queue[sim->input_head];
+    sim->input_head = (sim->input_head + 1) % SNAKE_MAX_QUEUED_INPUTS;
+    return direction;
+}
+
+local_internal void snake_simulation__emit(Snake_Simulation* sim, Snake_Event event)
+{
+    assert(sim->event_count < SNAKE_MAX_EVENTS);
+    sim->events[sim->event_count++] = event;
+}
+
+//=======================================================
+// STEP
+//=======================================================
+
+// Advances the game by dt_s and returns 1 if the snake moved (i.e. what it looks like changed). Events from this step
+// are in sim->events until the next one.
+bool32 snake_simulation__step(Snake_Simulation* sim, real32 dt_s)
+{
+    sim->event_count = 0;
+
+    if (sim->game_over)
+    {
+        return 0;
+    }
+
+    sim->ticks++;
+    sim->time_until_grid_jump__seconds -= dt_s;
+
+    if (sim->time_until_grid_jump__seconds > 0)
+    {
+        return 0;
+    }
+
+    Direction proposed_direction = snake_simulation__next_input(sim);
+
+    switch (proposed_direction)
+    {
+        case DIRECTION_NORTH:
+        {
+            if (sim->current_direction != DIRECTION_SOUTH)
+            {
+                sim->current_direction = DIRECTION_NORTH;
+            }
+        }
+        break;
+        case DIRECTION_EAST:
+        {
+            if (sim->current_direction != DIRECTION_WEST)
+            {
+                sim->current_direction = DIRECTION_EAST;
+            }
+        }
+        break;
+        case DIRECTION_SOUTH:
+        {
+            if (sim->current_direction != DIRECTION_NORTH)
+            {
+                sim->current_direction = DIRECTION_SOUTH;
+            }
+        }
+        break;
+        case DIRECTION_WEST:
+        {
+            if (sim->current_direction != DIRECTION_EAST)
+            {
+                sim->current_direction = DIRECTION_WEST;
+            }
+        }
+        break;
+    }
+
+    bool32 has_grown = 0;
+    {  // Blip collision
+        if (sim->pos_x == sim->blip_pos_x && sim->pos_y == sim->blip_pos_y)
+        {
+            if (!sim->free_cell_count)
+            {  // The head took the last free cell, there's nowhere to grow or move to
+                sim->game_over = 1;
+                snake_simulation__emit(sim, SNAKE_EVENT_WON);
+                sim->time_until_grid_jump__seconds = sim->set_time_until_grid_jump__seconds;
+                return 1;
+            }
+
+            snake_simulation__emit(sim, SNAKE_EVENT_ATE_EGG);
+
+            {  // Grow snake part (the tail just doesn't move this tick)
+                // NOTE: Can't overflow, there are never more parts than cells and snake_parts_capacity is the cell
+                // count. The body can fill it, a full board ends the game above before another part goes in.
+                sim->next_snake_part_index++;
+                has_grown = 1;
+            }
+
+            {  // Randomly spawn blip in a cell the snake isn't in, the tail stays put so there's still one free
+                uint32 cell = snake_simulation__random_free_cell(sim->occupied_cells,
+                                                                 sim->occupied_word_count,
+                                                                 sim->x_grids * sim->y_grids,
+                                                                 sim->free_cell_count,
+                                                                 &sim->rng);
+                sim->blip_pos_x = cell % sim->x_grids;
+                sim->blip_pos_y = cell / sim->x_grids;
+            }
+
+            sim->set_time_until_grid_jump__seconds -= 0.0005f;
+        }
+    }
+
+    {  // The head's old cell becomes the new part 0, everything else stays where it is
+        sim->snake_parts_first = (sim->snake_parts_first + sim->snake_parts_capacity - 1) % sim->snake_parts_capacity;
+        Snake_Part* new_snake_part = snake_simulation__part(sim, 0);
+        new_snake_part->pos_x = sim->pos_x;
+        new_snake_part->pos_y = sim->pos_y;
+        new_snake_part->direction = sim->current_direction;
+
+        if (!has_grown)
+        {
+            // The old tail (or with no body, the head's old cell) is what just fell off the end
+            Snake_Part* dropped_snake_part = snake_simulation__part(sim, sim->next_snake_part_index);
+            snake_simulation__free_cell(sim, dropped_snake_part->pos_x, dropped_snake_part->pos_y);
+        }
+    }
+
+    switch (sim->current_direction)
+    {
+        case DIRECTION_NORTH:
+        {
+            sim->pos_y++;
+        }
+        break;
+        case DIRECTION_EAST:
+        {
+            sim->pos_x++;
+        }
+        break;
+        case DIRECTION_SOUTH:
+        {
+            sim->pos_y--;
+        }
+        break;
+        case DIRECTION_WEST:
+        {
+            sim->pos_x--;
+        }
+        break;
+    }
+
+    {  // End Game if player crashes
+        if (sim->pos_x < 0 || sim->pos_x >= (int32)sim->x_grids || sim->pos_y < 0 || sim->pos_y >= (int32)sim->y_grids)
+        {
+            sim->game_over = 1;
+        }
+        else if (snake_simulation__is_cell_occupied(sim, sim->pos_x, sim->pos_y))
+        {
+            sim->game_over = 1;  // Ran into its own body
+        }
+        else
+        {
+            snake_simulation__occupy_cell(sim, sim->pos_x, sim->pos_y);
+        }
+
+        if (sim->game_over)
+        {
+            snake_simulation__emit(sim, SNAKE_EVENT_GAME_OVER);
+        }
+    }
+
+    sim->time_until_grid_jump__seconds = sim->set_time_until_grid_jump__seconds;
+    return 1;
+}
+
+// FNV-1a over everything that matters for the outcome of a game, replays check it to know they played out the same
+uint64 snake_simulation__hash(Snake_Simulation* sim)
+{
+    uint64 hash = 14695981039346656037ULL;
+    uint32 values[] = {
+        (uint32)sim->pos_x,
+        (uint32)sim->pos_y,
+        (uint32)sim->current_direction,
+        (uint32)sim->blip_pos_x,
+        (uint32)sim->blip_pos_y,
+        sim->next_snake_part_index,
+        (uint32)sim->game_over,
+        sim->ticks,
+        sim->rng,
+    };
+    for (uint32 i = 0; i < sizeof(values) / sizeof(values[0]); i++)
+    {
+        hash = (hash ^ values[i]) * 1099511628211ULL;
+    }
+    for (uint32 i = 0; i < sim->next_snake_part_index; i++)
+    {
+        Snake_Part* part = snake_simulation__part(sim, i);
+        hash = (hash ^ (uint32)part->pos_x) * 1099511628211ULL;
+        hash = (hash ^ (uint32)part->pos_y) * 1099511628211ULL;
+        hash = (hash ^ (uint32)part->direction) * 1099511628211ULL;
+    }
+    return hash;
+}
+
+//=======================================================
+// REPLAYS
+//=======================================================
+
+// Re-runs a recorded game as fast as possible and checks it ends up in the same state. Returns 1 if it matched.
+bool32 snake_simulation__play_replay(const char* path)
+{
+    Replay replay;
+    if (!replay__load(&replay, path))
+    {
+        return 0;
+    }
+
+    Snake_Simulation sim = {};
+    if (!snake_simulation__reset(&sim, replay.x_grids, replay.y_grids, replay.seed))
+    {
+        return 0;
+    }
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+    uint32 next_input = 0;
+    while (!sim.game_over && sim.ticks < replay.final_tick)
+    {
+        while (next_input < replay.inputs.size() && replay.inputs[next_input].tick == sim.ticks)
+        {
+            snake_simulation__queue_input(&sim, (Direction)replay.inputs[next_input].direction);
+            next_input++;
+        }
+        snake_simulation__step(&sim, replay.simulation_delta_time__seconds);
+    }
+
+    real64 seconds = std::chrono::duration<real64>(std::chrono::steady_clock::now() - start).count();
+    uint64 hash = snake_simulation__hash(&sim);
+    bool32 is_match = sim.ticks == replay.final_tick && hash == replay.final_state_hash;
+
+    printf("Replay %s: %u ticks, score %u, %.3f ms (%.0f ticks/s)\n",
+           path,
+           sim.ticks,
+           sim.next_snake_part_index,
+           seconds * 1000.0,
+           seconds > 0 ? sim.ticks / seconds : 0.0);
+    printf("State hash: %016llx, expected %016llx: %s\n",
+           (unsigned long long)hash,
+           (unsigned long long)replay.final_state_hash,
+           is_match ? "MATCH" : "MISMATCH");
+
+    snake_simulation__free(&sim);
+    return is_match;
+}
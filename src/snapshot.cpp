@@ -0,0 +1,399 @@
+// Snapshots
+//
+// Saves and restores the complete state of a Snake_Simulation (body, egg, timers, RNG and the input queue) so a game
+// can be rolled back, rewound or seeked through without replaying it from the start. Everything else in the
+// simulation can be rebuilt from this: each body part's position follows from the head and the moves in between,
+// and the occupied cells from the body. That keeps a snapshot at a small header plus 2 bits per body part.
+//
+// Snapshots close together in time are nearly the same, so one can be delta-encoded against another. The delta has
+// the header bytes that changed, the moves the target's head made that the base's didn't, where the rest of the
+// target's body lines up with the base's, and any tail the base no longer has. That works both ways, so a delta can go
+// forward or back in time.
+//
+// NOTE: Snapshots and deltas are for keeping in memory. They're in the machine's byte order, replays (replay.cpp) are
+// what go to disk.
+//
+// Needs snake_simulation.cpp included before it (and replay.cpp, for the varints).
+//
+// Layout:
+//     Snake_Snapshot__Header
+//     body moves, part 0 first, 2 bits each (direction - 1): the move each part made to get to the next one up
+//
+// Delta layout:
+//     u64 mask of the header bytes that changed, then those bytes
+//     varint count of new moves at the head, then those moves packed 2 bits each
+//     varint where the run shared with the base starts in the base's moves, varint its length
+//     the moves after the shared run (the tail the base has lost since), packed 2 bits each
+//
+// Usage:
+//     snake_snapshot__save(&sim, &snapshot);
+//     snake_snapshot__diff(&base[0], base.size(), &snapshot[0], snapshot.size(), &delta);
+//     snake_snapshot__apply_delta(&base[0], base.size(), &delta[0], delta.size(), &snapshot);
+//     snake_snapshot__restore(&sim, &snapshot[0], snapshot.size());
+
+#define SNAKE_SNAPSHOT_MAX_DELTA_SEARCH 64  // Moves apart two snapshots can be and still share their body in a delta
+
+struct Snake_Snapshot__Header
+{
+    uint16 x_grids;
+    uint16 y_grids;
+    int16 pos_x;
+    int16 pos_y;
+    int16 blip_pos_x;
+    int16 blip_pos_y;
+    uint32 length;  // Body parts
+    uint32 ticks;
+    uint32 rng;
+    real32 time_until_grid_jump__seconds;
+    real32 set_time_until_grid_jump__seconds;
+    uint8 game_over;
+    uint8 current_direction;
+    uint8 input_count;
+    uint8 inputs[SNAKE_MAX_QUEUED_INPUTS];  // Oldest first
+};
+
+static_assert(sizeof(Snake_Snapshot__Header) <= 64, "Delta header mask has one bit per header byte");
+
+local_internal uint32 snake_snapshot__get_move(const uint8* moves, uint32 i)
+{
+    return (moves[i / 4] >> ((i % 4) * 2)) & 3;
+}
+
+local_internal void snake_snapshot__set_move(uint8* moves, uint32 i, uint32 move)
+{
+    uint32 shift = (i % 4) * 2;
+    moves[i / 4] = (uint8)((moves[i / 4] & ~(3 << shift)) | (move << shift));
+}
+
+local_internal void snake_snapshot__step_back(uint32 move, int32* x, int32* y)
+{
+    // Undoes a move (direction - 1: north, east, south, west)
+    *x -= move == 1 ? 1 : move == 3 ? -1 : 0;
+    *y -= move == 0 ? 1 : move == 2 ? -1 : 0;
+}
+
+//=======================================================
+// SAVE AND RESTORE
+//=======================================================
+
+void snake_snapshot__save(Snake_Simulation* sim, std::vector<uint8>* snapshot)
+{
+    uint32 length = sim->next_snake_part_index;
+    snapshot->assign(sizeof(Snake_Snapshot__Header) + (length + 3) / 4, 0);  // Zeroes the header's padding too
+
+    Snake_Snapshot__Header* header = (Snake_Snapshot__Header*)&(*snapshot)[0];
+    header->x_grids = (uint16)sim->x_grids;
+    header->y_grids = (uint16)sim->y_grids;
+    header->pos_x = (int16)sim->pos_x;
+    header->pos_y = (int16)sim->pos_y;
+    header->blip_pos_x = (int16)sim->blip_pos_x;
+    header->blip_pos_y = (int16)sim->blip_pos_y;
+    header->length = length;
+    header->ticks = sim->ticks;
+    header->rng = sim->rng;
+    header->time_until_grid_jump__seconds = sim->time_until_grid_jump__seconds;
+    header->set_time_until_grid_jump__seconds = sim->set_time_until_grid_jump__seconds;
+    header->game_over = (uint8)sim->game_over;
+    header->current_direction = (uint8)sim->current_direction;
+    for (int32 i = sim->input_head; i != sim->input_tail; i = (i + 1) % SNAKE_MAX_QUEUED_INPUTS)
+    {
+        header->inputs[header->input_count++] = (uint8)sim->input_queue[i];
+    }
+
+    // A part's direction is the way the head was going when it left that cell, i.e. the move toward the next part up
+    uint8* moves = (uint8*)(header + 1);
+    uint32 slot = sim->snake_parts_first;
+    for (uint32 i = 0; i < length; i++)
+    {
+        moves[i / 4] |= (uint8)((sim->snake_parts[slot].direction - 1) << ((i % 4) * 2));
+        slot = slot + 1 < sim->snake_parts_capacity ? slot + 1 : 0;
+    }
+}
+
+// Puts the simulation back in the snapshot's state. Resets it first if it isn't set up for that board size.
+bool32 snake_snapshot__restore(Snake_Simulation* sim, const uint8* snapshot, size_t size)
+{
+    const Snake_Snapshot__Header* header = (const Snake_Snapshot__Header*)snapshot;
+    if (size < sizeof(Snake_Snapshot__Header) || size != sizeof(Snake_Snapshot__Header) + (header->length + 3) / 4 ||
+        header->input_count >= SNAKE_MAX_QUEUED_INPUTS ||
+        header->length > (uint32)header->x_grids * header->y_grids)
+    {
+        fprintf(stderr, "ERROR::SNAPSHOT: Not a snapshot\n");
+        return 0;
+    }
+
+    if (!sim->occupied_cells || sim->x_grids != header->x_grids || sim->y_grids != header->y_grids)
+    {
+        if (!snake_simulation__reset(sim, header->x_grids, header->y_grids, 0))
+        {
+            return 0;
+        }
+    }
+
+    sim->game_over = header->game_over;
+    sim->pos_x = header->pos_x;
+    sim->pos_y = header->pos_y;
+    sim->current_direction = (Direction)header->current_direction;
+    sim->time_until_grid_jump__seconds = header->time_until_grid_jump__seconds;
+    sim->set_time_until_grid_jump__seconds = header->set_time_until_grid_jump__seconds;
+    sim->ticks = header->ticks;
+    sim->blip_pos_x = header->blip_pos_x;
+    sim->blip_pos_y = header->blip_pos_y;
+    sim->rng = header->rng;
+    sim->event_count = 0;
+
+    sim->input_head = 0;
+    sim->input_tail = header->input_count;
+    for (uint32 i = 0; i < header->input_count; i++)
+    {
+        sim->input_queue[i] = (Direction)header->inputs[i];
+    }
+
+    uint32 cell_count = sim->x_grids * sim->y_grids;
+    memset(sim->occupied_cells, 0, sim->occupied_word_count * sizeof(uint64));
+    if (cell_count % 64)
+    {
+        sim->occupied_cells[cell_count / 64] = ~(uint64)0 << (cell_count % 64);
+    }
+    sim->free_cell_count = cell_count;
+
+    // The head's cell is only taken while the game is running or after a win filled the board, a crash leaves it
+    // where it hit
+    if (!sim->game_over || header->length + 1 == cell_count)
+    {
+        snake_simulation__occupy_cell(sim, sim->pos_x, sim->pos_y);
+    }
+
+    // Walk back from the head to rebuild the body
+    const uint8* moves = (const uint8*)(header + 1);
+    sim->snake_parts_first = 0;
+    sim->next_snake_part_index = header->length;
+    int32 x = sim->pos_x;
+    int32 y = sim->pos_y;
+    for (uint32 i = 0; i < header->length; i++)
+    {
+        uint32 move = snake_snapshot__get_move(moves, i);
+        snake_snapshot__step_back(move, &x, &y);
+
+        Snake_Part* part = &sim->snake_parts[i];
+        part->pos_x = x;
+        part->pos_y = y;
+        part->direction = (Direction)(move + 1);
+        snake_simulation__occupy_cell(sim, x, y);
+    }
+
+    return 1;
+}
+
+//=======================================================
+// DELTAS
+//=======================================================
+
+// The target's body is some new moves at the head, a run it shares with the base, then any moves at the tail the
+// base doesn't have any more
+struct Snake_Snapshot__Body_Match
+{
+    uint32 head_count;
+    uint32 base_first;  // Where the shared run starts in the base's moves
+    uint32 shared_count;
+};
+
+local_internal bool32 snake_snapshot__is_body_shared(
+    const uint8* base_moves, const uint8* target_moves, Snake_Snapshot__Body_Match* match)
+{
+    for (uint32 i = 0; i < match->shared_count; i++)
+    {
+        uint32 target_move = snake_snapshot__get_move(target_moves, match->head_count + i);
+        if (target_move != snake_snapshot__get_move(base_moves, match->base_first + i))
+        {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+// Finds where the two bodies line up. If the target is later, the base's head is somewhere in the target's body, and
+// if it's earlier the target's head is somewhere in the base's body. Positions narrow it down to one candidate each
+// way, then the moves get checked.
+local_internal Snake_Snapshot__Body_Match snake_snapshot__match_body(const Snake_Snapshot__Header* base,
+                                                                     const Snake_Snapshot__Header* target)
+{
+    const uint8* base_moves = (const uint8*)(base + 1);
+    const uint8* target_moves = (const uint8*)(target + 1);
+
+    Snake_Snapshot__Body_Match match = {};
+
+    {  // Forward: the target's head made head_count moves since the base
+        int32 x = target->pos_x;
+        int32 y = target->pos_y;
+        for (uint32 n = 0; n <= target->length && n <= SNAKE_SNAPSHOT_MAX_DELTA_SEARCH; n++)
+        {
+            if (x == base->pos_x && y == base->pos_y)
+            {
+                match.head_count = n;
+                match.base_first = 0;
+                uint32 remaining = target->length - n;
+                match.shared_count = remaining < base->length ? remaining : base->length;
+                if (snake_snapshot__is_body_shared(base_moves, target_moves, &match))
+                {
+                    return match;
+                }
+            }
+            if (n < target->length)
+            {
+                snake_snapshot__step_back(snake_snapshot__get_move(target_moves, n), &x, &y);
+            }
+        }
+    }
+
+    {  // Back: the base's head made base_first moves since the target
+        int32 x = base->pos_x;
+        int32 y = base->pos_y;
+        for (uint32 o = 0; o < base->length && o < SNAKE_SNAPSHOT_MAX_DELTA_SEARCH; o++)
+        {
+            snake_snapshot__step_back(snake_snapshot__get_move(base_moves, o), &x, &y);
+            if (x == target->pos_x && y == target->pos_y)
+            {
+                match.head_count = 0;
+                match.base_first = o + 1;
+                uint32 remaining = base->length - (o + 1);
+                match.shared_count = target->length < remaining ? target->length : remaining;
+                if (snake_snapshot__is_body_shared(base_moves, target_moves, &match))
+                {
+                    return match;
+                }
+            }
+        }
+    }
+
+    match.head_count = target->length;  // Nothing shared, every move goes in the delta
+    match.base_first = 0;
+    match.shared_count = 0;
+    return match;
+}
+
+local_internal void snake_snapshot__write_moves(
+    std::vector<uint8>* bytes, const uint8* moves, uint32 first, uint32 count)
+{
+    size_t start = bytes->size();
+    bytes->resize(start + (count + 3) / 4, 0);
+    for (uint32 i = 0; i < count; i++)
+    {
+        snake_snapshot__set_move(&(*bytes)[start], i, snake_snapshot__get_move(moves, first + i));
+    }
+}
+
+// Encodes target as the changes from base
+void snake_snapshot__diff(
+    const uint8* base, size_t base_size, const uint8* target, size_t target_size, std::vector<uint8>* delta)
+{
+    assert(base_size >= sizeof(Snake_Snapshot__Header) && target_size >= sizeof(Snake_Snapshot__Header));
+    (void)base_size;  // Only read by the assert
+    (void)target_size;
+    const Snake_Snapshot__Header* base_header = (const Snake_Snapshot__Header*)base;
+    const Snake_Snapshot__Header* target_header = (const Snake_Snapshot__Header*)target;
+    const uint8* target_moves = (const uint8*)(target_header + 1);
+
+    Snake_Snapshot__Body_Match match = snake_snapshot__match_body(base_header, target_header);
+    uint32 tail_count = target_header->length - match.head_count - match.shared_count;
+
+    delta->clear();
+    delta->reserve(8 + sizeof(Snake_Snapshot__Header) + 15 + (match.head_count + tail_count + 6) / 4);
+
+    uint64 changed_mask = 0;
+    for (uint32 i = 0; i < sizeof(Snake_Snapshot__Header); i++)
+    {
+        changed_mask |= (uint64)(base[i] != target[i]) << i;
+    }
+    replay__write_u64(delta, changed_mask);
+    for (uint32 i = 0; i < sizeof(Snake_Snapshot__Header); i++)
+    {
+        if ((changed_mask >> i) & 1)
+        {
+            delta->push_back(target[i]);
+        }
+    }
+
+    replay__write_varint(delta, match.head_count);
+    snake_snapshot__write_moves(delta, target_moves, 0, match.head_count);
+    replay__write_varint(delta, match.base_first);
+    replay__write_varint(delta, match.shared_count);
+    snake_snapshot__write_moves(delta, target_moves, match.head_count + match.shared_count, tail_count);
+}
+
+// Rebuilds the snapshot a delta was made for from the base it was made against
+bool32 snake_snapshot__apply_delta(
+    const uint8* base, size_t base_size, const uint8* delta, size_t delta_size, std::vector<uint8>* target)
+{
+    if (base_size < sizeof(Snake_Snapshot__Header))
+    {
+        fprintf(stderr, "ERROR::SNAPSHOT: Not a snapshot\n");
+        return 0;
+    }
+    const Snake_Snapshot__Header* base_header = (const Snake_Snapshot__Header*)base;
+
+    Replay__Reader reader = {};
+    reader.at = delta;
+    reader.end = delta + delta_size;
+
+    Snake_Snapshot__Header header;
+    memcpy(&header, base, sizeof(header));
+    uint64 changed_mask = replay__read_fixed(&reader, 8);
+    for (uint32 i = 0; i < sizeof(Snake_Snapshot__Header); i++)
+    {
+        if ((changed_mask >> i) & 1)
+        {
+            ((uint8*)&header)[i] = (uint8)replay__read_fixed(&reader, 1);
+        }
+    }
+
+    // Every count is checked as a uint64 against the bytes left before the reader moves past them, so a corrupt delta
+    // can't wrap around or step the reader off the end
+    uint64 head_count = replay__read_varint(&reader);
+    if (reader.has_failed || head_count > header.length || (head_count + 3) / 4 > (uint64)(reader.end - reader.at))
+    {
+        fprintf(stderr, "ERROR::SNAPSHOT: Delta doesn't go with this base\n");
+        return 0;
+    }
+    const uint8* head_moves = reader.at;
+    reader.at += (head_count + 3) / 4;
+
+    uint64 base_first = replay__read_varint(&reader);
+    uint64 shared_count = replay__read_varint(&reader);
+    if (reader.has_failed || head_count + shared_count > header.length ||
+        base_first + shared_count > base_header->length ||
+        (uint64)(base_size - sizeof(Snake_Snapshot__Header)) < ((uint64)base_header->length + 3) / 4 ||
+        (header.length - head_count - shared_count + 3) / 4 != (uint64)(reader.end - reader.at))
+    {
+        fprintf(stderr, "ERROR::SNAPSHOT: Delta doesn't go with this base\n");
+        return 0;
+    }
+    const uint8* tail_moves = reader.at;
+    uint32 tail_count = (uint32)(header.length - head_count - shared_count);
+
+    Snake_Snapshot__Body_Match match = {};
+    match.head_count = (uint32)head_count;
+    match.base_first = (uint32)base_first;
+    match.shared_count = (uint32)shared_count;
+
+    target->assign(sizeof(Snake_Snapshot__Header) + (header.length + 3) / 4, 0);
+    memcpy(&(*target)[0], &header, sizeof(header));
+    uint8* target_moves = &(*target)[sizeof(Snake_Snapshot__Header)];
+    const uint8* base_moves = (const uint8*)(base_header + 1);
+
+    uint32 i = 0;
+    for (uint32 j = 0; j < match.head_count; j++)
+    {
+        snake_snapshot__set_move(target_moves, i++, snake_snapshot__get_move(head_moves, j));
+    }
+    for (uint32 j = 0; j < match.shared_count; j++)
+    {
+        snake_snapshot__set_move(target_moves, i++, snake_snapshot__get_move(base_moves, match.base_first + j));
+    }
+    for (uint32 j = 0; j < tail_count; j++)
+    {
+        snake_snapshot__set_move(target_moves, i++, snake_snapshot__get_move(tail_moves, j));
+    }
+
+    return 1;
+}
@@ -0,0 +1,191 @@
+// Sprite batching
+//
+// Scenes push sprites (position, rotation, size, atlas region) while they render and the batch submits them in one
+// instanced draw per texture when flushed. Game sprites all live in one atlas so that's normally a single draw.
+// Buckets are drawn in the order their texture was first pushed, so layering between textures is preserved.
+// Instance data is written into the shared stream buffer (see stream_buffer.cpp).
+
+struct Sprite_Instance
+{
+    real32 x;  // Center
+    real32 y;  // Center
+    real32 size;
+    real32 angle__radians;
+    // Atlas UV rectangle
+    real32 u0;
+    real32 v0;
+    real32 u1;
+    real32 v1;
+};
+
+struct Sprite_Batch__Bucket
+{
+    uint32 texture_id;
+    std::vector<Sprite_Instance> instances;
+};
+
+#define MAX_SPRITE_BATCH_TEXTURES 16
+
+struct Sprite_Batch
+{
+    GLuint VAO;
+
+    Sprite_Batch__Bucket buckets[MAX_SPRITE_BATCH_TEXTURES];
+    uint32 bucket_count;
+
+    // Stats from the last flush
+    uint32 sprites_drawn;
+    uint32 draw_calls;
+};
+
+Sprite_Batch global_sprite_batch;
+Shader* global_sprite_shader;
+
+// Points the instance attributes at the given byte offset of the stream buffer (which must be bound)
+local_internal void sprite_batch__point_instance_attributes(uintptr_t offset)
+{
+    glVertexAttribPointer(2, 4, GL_FLOAT, GL_FALSE, sizeof(Sprite_Instance), (void*)offset);
+    glVertexAttribPointer(
+        3, 4, GL_FLOAT, GL_FALSE, sizeof(Sprite_Instance), (void*)(offset + offsetof(Sprite_Instance, u0)));
+}
+
+// NOTE: Relies on quadVBO and quadEBO (see setupQuad) and global_stream_buffer already being set up
+void sprite_batch__init(Sprite_Batch* batch)
+{
+    batch->bucket_count = 0;
+
+    glGenVertexArrays(1, &batch->VAO);
+
+    gl_state__bind_vertex_array(batch->VAO);
+
+    // Re-use the unit quad
+    glBindBuffer(GL_ARRAY_BUFFER, quadVBO);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, quadEBO);
+
+    // Position attribute
+    glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 4 * sizeof(float), (void*)0);
+    glEnableVertexAttribArray(0);
+
+    // Texture Coord attribute
+    glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 4 * sizeof(float), (void*)(2 * sizeof(float)));
+    glEnableVertexAttribArray(1);
+
+    // Per-instance sprite attributes (center, size, angle) and (uv rect)
+    glBindBuffer(GL_ARRAY_BUFFER, global_stream_buffer.VBO);
+    sprite_batch__point_instance_attributes(0);
+    glEnableVertexAttribArray(2);
+    glVertexAttribDivisor(2, 1);
+    glEnableVertexAttribArray(3);
+    glVertexAttribDivisor(3, 1);
+
+    gl_state__bind_vertex_array(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+void sprite_batch__push(
+    Sprite_Batch* batch, const Atlas_Region* region, real32 x, real32 y, real32 angle__degrees, real32 size)
+{
+    uint32 texture_id = region->texture_id;
+
+    Sprite_Batch__Bucket* bucket = 0;
+    for (uint32 i = 0; i < batch->bucket_count; i++)
+    {
+        if (batch->buckets[i].texture_id == texture_id)
+        {
+            bucket = &batch->buckets[i];
+            break;
+        }
+    }
+
+    if (!bucket)
+    {
+        SDL_assert(batch->bucket_count < MAX_SPRITE_BATCH_TEXTURES);
+        bucket = &batch->buckets[batch->bucket_count++];
+        bucket->texture_id = texture_id;
+        bucket->instances.clear();  // Keeps its capacity from previous frames
+    }
+
+    Sprite_Instance instance = {};
+    instance.x = x;
+    instance.y = y;
+    instance.size = size;
+    instance.angle__radians = glm::radians(angle__degrees);
+    instance.u0 = region->u0;
+    instance.v0 = region->v0;
+    instance.u1 = region->u1;
+    instance.v1 = region->v1;
+    bucket->instances.push_back(instance);
+}
+
+void sprite_batch__flush(Sprite_Batch* batch, Shader& shader)
+{
+    batch->sprites_drawn = 0;
+    batch->draw_calls = 0;
+
+    uint32 total_instances = 0;
+    for (uint32 i = 0; i < batch->bucket_count; i++)
+    {
+        total_instances += (uint32)batch->buckets[i].instances.size();
+    }
+
+    if (total_instances == 0)
+    {
+        batch->bucket_count = 0;
+        return;
+    }
+
+    setupTextRenderingState();  // Sprites need alpha blending too
+    shader.use();  // Projection comes from the shared Frame_Uniforms block
+
+    gl_state__bind_vertex_array(batch->VAO);
+
+    // Write every bucket back to back, then point the instance attribute at each bucket's range as we draw it
+    uint32 base_offset;
+    Sprite_Instance* dst = (Sprite_Instance*)stream_buffer__map(
+        &global_stream_buffer, total_instances * sizeof(Sprite_Instance), sizeof(Sprite_Instance), &base_offset);
+    if (!dst)
+    {
+        for (uint32 i = 0; i < batch->bucket_count; i++)
+        {
+            batch->buckets[i].instances.clear();
+        }
+        batch->bucket_count = 0;
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+        return;
+    }
+
+    uint32 offset = 0;
+    for (uint32 i = 0; i < batch->bucket_count; i++)
+    {
+        Sprite_Batch__Bucket* bucket = &batch->buckets[i];
+        uint32 count = (uint32)bucket->instances.size();
+        if (count)
+        {
+            memcpy(dst + offset, &bucket->instances[0], count * sizeof(Sprite_Instance));
+        }
+        offset += count;
+    }
+    stream_buffer__unmap(&global_stream_buffer);
+
+    offset = 0;
+    for (uint32 i = 0; i < batch->bucket_count; i++)
+    {
+        Sprite_Batch__Bucket* bucket = &batch->buckets[i];
+        uint32 count = (uint32)bucket->instances.size();
+        if (count)
+        {
+            sprite_batch__point_instance_attributes(base_offset + offset * sizeof(Sprite_Instance));
+            gl_state__bind_texture_2d(0, bucket->texture_id);
+            glDrawElementsInstanced(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0, count);
+
+            batch->sprites_drawn += count;
+            batch->draw_calls++;
+        }
+        offset += count;
+        bucket->instances.clear();
+    }
+
+    batch->bucket_count = 0;
+
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
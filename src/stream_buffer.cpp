@@ -0,0 +1,164 @@
+// Streaming vertex buffer
+//
+// One big GL_ARRAY_BUFFER that every per-frame draw path (text, sprite instances, ...) appends its data to. Writes go
+// through unsynchronized maps so the driver never has to stall or copy on our behalf, and the ring is split into
+// segments with a fence each: when the write head moves onto a segment, we wait for the GPU to have finished with
+// whatever it last drew out of it. With a few frames worth of space that wait is normally already satisfied. An
+// allocation never crosses into the next segment, it skips to the start of it instead.
+//
+// Usage:
+//     uint32 offset;
+//     void* dst = stream_buffer__map(&global_stream_buffer, size, alignment, &offset);
+//     memcpy(dst, data, size);
+//     stream_buffer__unmap(&global_stream_buffer);
+//     ... draw, pointing attributes at `offset` in global_stream_buffer.VBO ...
+
+#define STREAM_BUFFER_SEGMENT_COUNT 4
+#define STREAM_BUFFER_DEFAULT_SIZE (1024 * 1024)  // In bytes
+
+struct Stream_Buffer
+{
+    GLuint VBO;
+    uint32 size;     // In bytes
+    uint32 head;     // Next free byte
+    uint32 segment;  // Segment the head is currently in
+    GLsync segment_fences[STREAM_BUFFER_SEGMENT_COUNT];
+
+    // Counters for the current frame, and the totals from the last one for the debug overlay
+    uint32 bytes_written;
+    uint32 fence_waits;  // How many times we actually had to block on the GPU
+    uint32 last_frame_bytes_written;
+    uint32 last_frame_fence_waits;
+};
+
+Stream_Buffer global_stream_buffer;
+
+local_internal uint32 stream_buffer__segment_size(Stream_Buffer* buffer)
+{
+    return buffer->size / STREAM_BUFFER_SEGMENT_COUNT;
+}
+
+local_internal void stream_buffer__allocate_storage(Stream_Buffer* buffer, uint32 size)
+{
+    for (uint32 i = 0; i < STREAM_BUFFER_SEGMENT_COUNT; i++)
+    {
+        if (buffer->segment_fences[i])
+        {
+            glDeleteSync(buffer->segment_fences[i]);
+            buffer->segment_fences[i] = 0;
+        }
+    }
+
+    buffer->size = size;
+    buffer->head = 0;
+    buffer->segment = 0;
+
+    glBindBuffer(GL_ARRAY_BUFFER, buffer->VBO);
+    // Orphans any old storage, the GPU keeps reading it until it's done and we never touch it again
+    glBufferData(GL_ARRAY_BUFFER, size, NULL, GL_STREAM_DRAW);
+}
+
+void stream_buffer__init(Stream_Buffer* buffer, uint32 size)
+{
+    *buffer = {};
+    glGenBuffers(1, &buffer->VBO);
+    stream_buffer__allocate_storage(buffer, size);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+void stream_buffer__begin_frame(Stream_Buffer* buffer)
+{
+    buffer->last_frame_bytes_written = buffer->bytes_written;
+    buffer->last_frame_fence_waits = buffer->fence_waits;
+    buffer->bytes_written = 0;
+    buffer->fence_waits = 0;
+}
+
+// Fence off everything drawn from the segment we're leaving so we know when it's safe to write over it again
+local_internal void stream_buffer__leave_segment(Stream_Buffer* buffer)
+{
+    GLsync* fence = &buffer->segment_fences[buffer->segment];
+    if (*fence)
+    {
+        glDeleteSync(*fence);
+    }
+    *fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+}
+
+local_internal void stream_buffer__enter_segment(Stream_Buffer* buffer, uint32 segment)
+{
+    buffer->segment = segment;
+
+    GLsync* fence = &buffer->segment_fences[segment];
+    if (!*fence)
+    {
+        return;
+    }
+
+    GLenum result = glClientWaitSync(*fence, 0, 0);
+    if (result == GL_TIMEOUT_EXPIRED)
+    {
+        buffer->fence_waits++;
+        do
+        {
+            result = glClientWaitSync(*fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000 * 1000);  // 1ms
+        } while (result == GL_TIMEOUT_EXPIRED);
+    }
+    if (result == GL_WAIT_FAILED)
+    {
+        fprintf(stderr, "ERROR::STREAM_BUFFER: Waiting on a segment fence failed\n");
+    }
+
+    glDeleteSync(*fence);
+    *fence = 0;
+}
+
+// Reserves `size` bytes, aligned to `alignment` (e.g. the vertex stride so the offset works as a draw's first vertex),
+// and maps them for writing. Leaves the stream VBO bound to GL_ARRAY_BUFFER. Whatever draws from the mapping has to be
+// issued before the next map.
+void* stream_buffer__map(Stream_Buffer* buffer, uint32 size, uint32 alignment, uint32* offset)
+{
+    glBindBuffer(GL_ARRAY_BUFFER, buffer->VBO);
+
+    if (size + alignment > stream_buffer__segment_size(buffer))
+    {
+        uint32 new_size = buffer->size;
+        while (size + alignment > new_size / STREAM_BUFFER_SEGMENT_COUNT)
+        {
+            new_size *= 2;
+        }
+        stream_buffer__allocate_storage(buffer, new_size);
+    }
+
+    uint32 segment_size = stream_buffer__segment_size(buffer);
+    uint32 start = ((buffer->head + alignment - 1) / alignment) * alignment;
+    if (start + size > (buffer->segment + 1) * segment_size)
+    {
+        // Never straddle two segments: the draws reading this one have all been issued by now, so its fence covers
+        // them. One that crossed into the next segment would be drawn after that fence went in.
+        stream_buffer__leave_segment(buffer);
+        stream_buffer__enter_segment(buffer, (buffer->segment + 1) % STREAM_BUFFER_SEGMENT_COUNT);
+        start = buffer->segment * segment_size;
+        start = ((start + alignment - 1) / alignment) * alignment;
+    }
+
+    buffer->head = start + size;
+    buffer->bytes_written += size;
+    *offset = start;
+
+    // Fences already guarantee the GPU is done with this range, don't let the driver synchronize again
+    return glMapBufferRange(GL_ARRAY_BUFFER,
+                            start,
+                            size,
+                            GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+}
+
+void stream_buffer__unmap(Stream_Buffer* buffer)
+{
+    if (!glUnmapBuffer(GL_ARRAY_BUFFER))
+    {
+        // The storage got corrupted (e.g. video mode change), start over with a fresh one
+        fprintf(stderr, "ERROR::STREAM_BUFFER: Buffer contents were lost while mapped\n");
+        stream_buffer__allocate_storage(buffer, buffer->size);
+    }
+}
@@ -0,0 +1,446 @@
+// Text rendering
+//
+// All SDF glyphs are packed into a single texture when the font loads. RenderText doesn't draw anything itself, it
+// appends the string's quads to the frame's text batch, which is written into the stream buffer and drawn with one call
+// by text_batch__flush once the scene (and debug overlay) have finished rendering.
+//
+// Laying out a string (measuring it and building its glyph quads) is cached per (font, scale, text), so labels that
+// don't change only get laid out once. Use text_layout__get to measure a string before drawing it with
+// text_layout__draw. Layouts nobody asked for in a while are evicted.
+
+#define FONT_GLYPH_COUNT 128  // First 128 characters of the ASCII set
+
+/// Holds all state information relevant to a character as loaded using FreeType
+struct Character
+{
+    glm::ivec2 Size;       // Size of glyph
+    glm::ivec2 Bearing;    // Offset from baseline to left/top of glyph
+    unsigned int Advance;  // Horizontal offset to advance to next glyph
+    // Glyph's rectangle in the font atlas (v0 is the top row of the glyph)
+    real32 u0;
+    real32 v0;
+    real32 u1;
+    real32 v1;
+};
+
+struct Font
+{
+    uint32 atlas_texture;
+    int32 atlas_width;
+    int32 atlas_height;
+    Character characters[FONT_GLYPH_COUNT];
+};
+
+Font global_font;
+
+struct Text_Vertex
+{
+    real32 x;
+    real32 y;
+    real32 u;
+    real32 v;
+    real32 r;
+    real32 g;
+    real32 b;
+};
+
+struct Text_Batch
+{
+    std::vector<Text_Vertex> vertices;
+    Shader* shader;
+
+    // Stats from the last flush
+    uint32 glyphs_drawn;
+    uint32 draw_calls;
+};
+
+Text_Batch global_text_batch;
+unsigned int FONT_VAO;
+
+struct Text_Layout
+{
+    std::string text;
+    const Font* font;
+    real32 scale;
+
+    real32 width;   // Sum of the advances, in pixels
+    real32 height;  // Height of 'H' (what we center text with), in pixels
+    std::vector<Text_Vertex> vertices;  // 6 per visible glyph, relative to the baseline origin, color not filled in
+
+    uint32 last_used_frame;
+};
+
+#define TEXT_LAYOUT_EVICT_AFTER_FRAMES 120
+
+struct Text_Layout_Cache
+{
+    std::unordered_map<uint64, Text_Layout> layouts;  // Keyed by text_layout__hash
+    uint32 frame;
+
+    // Stats
+    uint32 layouts_built;
+};
+
+Text_Layout_Cache global_text_layout_cache;
+
+struct Font__Rasterize_Batch
+{
+    Font* font;
+    const char* path;
+    uint32 pixel_height;
+    std::vector<unsigned char>* glyph_bitmaps;  // FONT_GLYPH_COUNT of them
+    std::atomic<int32> failed_count;          // Batches that couldn't open FreeType or the font
+    std::atomic<int32> library_failed_count;  // Of those, the ones where FreeType itself wouldn't init
+};
+
+// Rasterizes a range of glyphs. A FreeType library and face must only be used from one thread at a time, so each
+// batch opens its own. Every batch would fail the same way, so font__load_sdf reports those failures once.
+local_internal void font__rasterize_glyphs(void* data, uint32 first, uint32 count)
+{
+    Font__Rasterize_Batch* batch = (Font__Rasterize_Batch*)data;
+    Font* font = batch->font;
+
+    FT_Library ft;
+    // All functions return a value different than 0 whenever an error occurred
+    if (FT_Init_FreeType(&ft))
+    {
+        batch->library_failed_count++;
+        batch->failed_count++;
+        return;
+    }
+
+    // load font as face
+    FT_Face face;
+    if (FT_New_Face(ft, batch->path, 0, &face))
+    {
+        FT_Done_FreeType(ft);
+        batch->failed_count++;
+        return;
+    }
+
+    // set size to load glyphs as
+    FT_Set_Pixel_Sizes(face, 0, batch->pixel_height);
+
+    for (uint32 c = first; c < first + count; c++)
+    {
+        // We're using signed distance fields!
+        FT_Int32 load_flags = FT_LOAD_RENDER | FT_LOAD_TARGET_(FT_RENDER_MODE_SDF);
+        // Load character glyph
+        if (FT_Load_Char(face, c, load_flags))
+        {
+            fprintf(stderr, "ERROR::FREETYPE: Failed to load glyph %u\n", c);  // Not std::cout, this runs on the pool
+            continue;
+        }
+
+        FT_Bitmap* bitmap = &face->glyph->bitmap;
+        int32 width = (int32)bitmap->width;
+        int32 rows = (int32)bitmap->rows;
+
+        Character character = {};
+        character.Size = glm::ivec2(width, rows);
+        character.Bearing = glm::ivec2(face->glyph->bitmap_left, face->glyph->bitmap_top);
+        character.Advance = static_cast<unsigned int>(face->glyph->advance.x);
+        font->characters[c] = character;
+
+        if (width == 0 || rows == 0)
+        {
+            continue;  // Nothing to draw (e.g. space)
+        }
+
+        // Copy out the bitmap (the glyph slot gets re-used by the next load) dropping any row padding
+        std::vector<unsigned char>& pixels = batch->glyph_bitmaps[c];
+        pixels.resize((size_t)width * rows);
+        for (int32 row = 0; row < rows; row++)
+        {
+            memcpy(&pixels[(size_t)row * width], bitmap->buffer + (ptrdiff_t)row * bitmap->pitch, (size_t)width);
+        }
+    }
+
+    // destroy FreeType once we're finished
+    FT_Done_Face(face);
+    FT_Done_FreeType(ft);
+}
+
+// SDF rasterization is the slow part of startup, the glyphs get split over the pool
+bool32 font__load_sdf(Font* font, Thread_Pool* pool, const char* path, uint32 pixel_height)
+{
+    // Rasterize every glyph first, then pack them all into one texture
+    std::vector<std::vector<unsigned char> > glyph_bitmaps(FONT_GLYPH_COUNT);
+
+    Font__Rasterize_Batch batch = {};
+    batch.font = font;
+    batch.path = path;
+    batch.pixel_height = pixel_height;
+    batch.glyph_bitmaps = &glyph_bitmaps[0];
+    thread_pool__parallel_for(pool, FONT_GLYPH_COUNT, 8, font__rasterize_glyphs, &batch);
+    if (batch.failed_count)
+    {
+        if (batch.library_failed_count)
+        {
+            fprintf(stderr, "ERROR::FREETYPE: Could not init FreeType Library\n");
+        }
+        else
+        {
+            fprintf(stderr, "ERROR::FREETYPE: Failed to load font %s\n", path);
+        }
+        return 0;
+    }
+
+    std::vector<Texture_Atlas__Image> glyph_rects;
+    for (uint32 c = 0; c < FONT_GLYPH_COUNT; c++)
+    {
+        if (glyph_bitmaps[c].empty())
+        {
+            continue;
+        }
+
+        Texture_Atlas__Image rect = {};
+        rect.name = std::string(1, (char)c);
+        rect.width = font->characters[c].Size.x;
+        rect.height = font->characters[c].Size.y;
+        glyph_rects.push_back(rect);
+    }
+
+    std::stable_sort(glyph_rects.begin(), glyph_rects.end(), texture_atlas__compare_image_height);
+
+    int32 atlas_width = 256;
+    int32 atlas_height = 0;
+    while (atlas_width <= TEXTURE_ATLAS_MAX_SIZE)
+    {
+        atlas_height = texture_atlas__pack(glyph_rects, atlas_width);
+        if (atlas_height && atlas_height <= atlas_width)
+        {
+            break;
+        }
+        atlas_width *= 2;
+    }
+
+    if (atlas_width > TEXTURE_ATLAS_MAX_SIZE)
+    {
+        std::cout << "ERROR::FREETYPE: Glyphs don't fit in a " << TEXTURE_ATLAS_MAX_SIZE << " atlas" << std::endl;
+        return 0;
+    }
+
+    std::vector<unsigned char> atlas_pixels((size_t)atlas_width * atlas_height, 0);
+    for (uint32 i = 0; i < glyph_rects.size(); i++)
+    {
+        Texture_Atlas__Image* rect = &glyph_rects[i];
+        unsigned char c = (unsigned char)rect->name[0];
+        std::vector<unsigned char>& pixels = glyph_bitmaps[c];
+
+        for (int32 row = 0; row < rect->height; row++)
+        {
+            memcpy(&atlas_pixels[(size_t)(rect->y + row) * atlas_width + rect->x],
+                   &pixels[(size_t)row * rect->width],
+                   (size_t)rect->width);
+        }
+
+        Character* character = &font->characters[c];
+        character->u0 = (real32)rect->x / (real32)atlas_width;
+        character->v0 = (real32)rect->y / (real32)atlas_height;
+        character->u1 = (real32)(rect->x + rect->width) / (real32)atlas_width;
+        character->v1 = (real32)(rect->y + rect->height) / (real32)atlas_height;
+    }
+
+    // disable byte-alignment restriction
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+
+    glGenTextures(1, &font->atlas_texture);
+    gl_state__bind_texture_2d(0, font->atlas_texture);
+    glTexImage2D(
+        GL_TEXTURE_2D, 0, GL_RED, atlas_width, atlas_height, 0, GL_RED, GL_UNSIGNED_BYTE, &atlas_pixels[0]);
+    // set texture options
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    gl_state__bind_texture_2d(0, 0);
+
+    font->atlas_width = atlas_width;
+    font->atlas_height = atlas_height;
+
+    return 1;
+}
+
+// configure VAO for texture quads
+// NOTE: Relies on global_stream_buffer already being set up, the vertices live there
+void text_batch__init(Text_Batch* batch)
+{
+    glGenVertexArrays(1, &FONT_VAO);
+    gl_state__bind_vertex_array(FONT_VAO);
+    glBindBuffer(GL_ARRAY_BUFFER, global_stream_buffer.VBO);
+    // <vec2 pos, vec2 tex>
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, sizeof(Text_Vertex), 0);
+    // <vec3 color>
+    glEnableVertexAttribArray(1);
+    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Text_Vertex), (void*)offsetof(Text_Vertex, r));
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    gl_state__bind_vertex_array(0);
+}
+
+// FNV-1a over everything the layout depends on, so a lookup never has to build a std::string
+local_internal uint64 text_layout__hash(const Font* font, const char* text, real32 scale)
+{
+    uint64 hash = 14695981039346656037ULL;
+    for (const char* c = text; *c; c++)
+    {
+        hash = (hash ^ (uint8)*c) * 1099511628211ULL;
+    }
+    uint32 scale_bits;
+    memcpy(&scale_bits, &scale, sizeof(scale_bits));
+    hash = (hash ^ scale_bits) * 1099511628211ULL;
+    hash = (hash ^ (uint64)(uintptr_t)font) * 1099511628211ULL;
+    return hash;
+}
+
+local_internal void text_layout__build(Text_Layout* layout, const Font* font, const char* text, real32 scale)
+{
+    layout->text = text;
+    layout->font = font;
+    layout->scale = scale;
+    layout->height = font->characters['H'].Size.y * scale;
+    layout->vertices.clear();
+
+    float x = 0.0f;
+    float y = 0.0f;
+
+    // iterate through all characters
+    for (const char* c = text; *c; c++)
+    {
+        unsigned char glyph = (unsigned char)*c;
+        if (glyph >= FONT_GLYPH_COUNT)
+        {
+            continue;
+        }
+        const Character* ch = &font->characters[glyph];
+
+        float xpos = x + ch->Bearing.x * scale;
+        float ypos = y - (ch->Size.y - ch->Bearing.y) * scale;
+
+        float w = ch->Size.x * scale;
+        float h = ch->Size.y * scale;
+
+        if (w > 0 && h > 0)
+        {
+            Text_Vertex vertices[6] = {
+                // clang-format off
+                { xpos,     ypos + h,   ch->u0, ch->v0,   1.0f, 1.0f, 1.0f },
+                { xpos,     ypos,       ch->u0, ch->v1,   1.0f, 1.0f, 1.0f },
+                { xpos + w, ypos,       ch->u1, ch->v1,   1.0f, 1.0f, 1.0f },
+
+                { xpos,     ypos + h,   ch->u0, ch->v0,   1.0f, 1.0f, 1.0f },
+                { xpos + w, ypos,       ch->u1, ch->v1,   1.0f, 1.0f, 1.0f },
+                { xpos + w, ypos + h,   ch->u1, ch->v0,   1.0f, 1.0f, 1.0f }
+                // clang-format on
+            };
+            layout->vertices.insert(layout->vertices.end(), vertices, vertices + 6);
+        }
+
+        // now advance cursors for next glyph (note that advance is number of 1/64 pixels)
+        x += (ch->Advance >> 6) * scale;  // bitshift by 6 to get value in pixels (2^6 = 64 (divide amount of 1/64th
+                                          // pixels by 64 to get amount of pixels))
+    }
+
+    layout->width = x;
+}
+
+// NOTE: The returned layout stays valid until the end of the frame (text_batch__flush may evict it)
+const Text_Layout* text_layout__get(const Font* font, const char* text, real32 scale)
+{
+    Text_Layout_Cache* cache = &global_text_layout_cache;
+    uint64 hash = text_layout__hash(font, text, scale);
+
+    Text_Layout* layout = &cache->layouts[hash];
+    bool32 is_match = layout->font == font && layout->scale == scale && layout->text == text;
+    if (!is_match)
+    {
+        // New text (or, very rarely, a hash collision in which case the newer string wins the slot)
+        text_layout__build(layout, font, text, scale);
+        cache->layouts_built++;
+    }
+    layout->last_used_frame = cache->frame;
+    return layout;
+}
+
+void text_layout__draw(Shader& shader, const Text_Layout* layout, float x, float y, glm::vec3 color)
+{
+    Text_Batch* batch = &global_text_batch;
+    SDL_assert(!batch->shader || batch->shader == &shader);  // One batch per text shader
+    batch->shader = &shader;
+
+    size_t first = batch->vertices.size();
+    batch->vertices.insert(batch->vertices.end(), layout->vertices.begin(), layout->vertices.end());
+    for (size_t i = first; i < batch->vertices.size(); i++)
+    {
+        Text_Vertex* vertex = &batch->vertices[i];
+        vertex->x += x;
+        vertex->y += y;
+        vertex->r = color.r;
+        vertex->g = color.g;
+        vertex->b = color.b;
+    }
+}
+
+void RenderText(Shader& shader, const char* text, float x, float y, float scale, glm::vec3 color)
+{
+    text_layout__draw(shader, text_layout__get(&global_font, text, scale), x, y, color);
+}
+
+// Drops layouts that haven't been asked for recently (e.g. old debug overlay numbers)
+local_internal void text_layout_cache__evict_stale(Text_Layout_Cache* cache)
+{
+    std::unordered_map<uint64, Text_Layout>::iterator it = cache->layouts.begin();
+    while (it != cache->layouts.end())
+    {
+        if (cache->frame - it->second.last_used_frame > TEXT_LAYOUT_EVICT_AFTER_FRAMES)
+        {
+            it = cache->layouts.erase(it);
+        }
+        else
+        {
+            it++;
+        }
+    }
+}
+
+// Draws every glyph queued by RenderText since the last flush with a single draw call
+void text_batch__flush(Text_Batch* batch)
+{
+    uint32 vertex_count = (uint32)batch->vertices.size();
+    batch->glyphs_drawn = vertex_count / 6;
+    batch->draw_calls = 0;
+
+    Text_Layout_Cache* cache = &global_text_layout_cache;
+    cache->frame++;
+    if (cache->frame % TEXT_LAYOUT_EVICT_AFTER_FRAMES == 0)
+    {
+        text_layout_cache__evict_stale(cache);
+    }
+
+    if (vertex_count == 0 || !batch->shader)
+    {
+        return;
+    }
+
+    setupTextRenderingState();
+    batch->shader->use();  // Projection comes from the shared Frame_Uniforms block
+    gl_state__bind_texture_2d(0, global_font.atlas_texture);
+    gl_state__bind_vertex_array(FONT_VAO);
+
+    // Aligned to the vertex size so the offset can be given to the draw as its first vertex
+    uint32 size = vertex_count * sizeof(Text_Vertex);
+    uint32 offset;
+    void* dst = stream_buffer__map(&global_stream_buffer, size, sizeof(Text_Vertex), &offset);
+    if (dst)
+    {
+        memcpy(dst, &batch->vertices[0], size);
+        stream_buffer__unmap(&global_stream_buffer);
+
+        glDrawArrays(GL_TRIANGLES, offset / sizeof(Text_Vertex), vertex_count);
+        batch->draw_calls = 1;
+    }
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    batch->vertices.clear();
+}
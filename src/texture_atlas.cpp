@@ -0,0 +1,251 @@
+// Texture atlas
+//
+// Packs every sprite image into a single GL texture at load time so a whole frame of game sprites needs one texture
+// bind. Add images to a Texture_Atlas__Builder, build it once, then look up each sprite's Atlas_Region by name and
+// keep it around (lookups are by string, so don't do them per frame).
+
+struct Atlas_Region
+{
+    uint32 texture_id;  // The atlas texture this region lives in
+    // UV rectangle (bottom-left to top-right)
+    real32 u0;
+    real32 v0;
+    real32 u1;
+    real32 v1;
+    int32 width;   // In pixels
+    int32 height;  // In pixels
+};
+
+struct Texture_Atlas
+{
+    uint32 texture_id;
+    int32 width;
+    int32 height;
+    std::map<std::string, Atlas_Region> regions;
+};
+
+struct Texture_Atlas__Image
+{
+    std::string name;
+    unsigned char* pixels;  // RGBA
+    int32 width;
+    int32 height;
+    int32 x;  // Packed position in the atlas
+    int32 y;
+};
+
+struct Texture_Atlas__Builder
+{
+    std::vector<Texture_Atlas__Image> images;
+};
+
+// Transparent gap around every sprite so nearest sampling at the edges never picks up a neighbour's texels
+#define TEXTURE_ATLAS_PADDING 1
+#define TEXTURE_ATLAS_MAX_SIZE 4096
+
+local_internal bool32 texture_atlas__load_image(Texture_Atlas__Image* image, const char* name, const char* path)
+{
+    int32 channels;
+    // Always ask for RGBA so every image can share the atlas format
+    image->pixels = stbi_load(path, &image->width, &image->height, &channels, 4);
+    if (!image->pixels)
+    {
+        fprintf(stderr, "Failed to load texture: %s\n", path);  // Not std::cout, this can run on several threads
+        return 0;
+    }
+    image->name = name;
+    return 1;
+}
+
+bool32 texture_atlas__add_image(Texture_Atlas__Builder* builder, const char* name, const char* path)
+{
+    Texture_Atlas__Image image = {};
+    if (!texture_atlas__load_image(&image, name, path))
+    {
+        return 0;
+    }
+    builder->images.push_back(image);
+    return 1;
+}
+
+struct Texture_Atlas__Load
+{
+    const char* name;
+    const char* path;
+};
+
+struct Texture_Atlas__Load_Batch
+{
+    const Texture_Atlas__Load* loads;
+    Texture_Atlas__Image* images;
+    std::atomic<int32> failed_count;
+};
+
+local_internal void texture_atlas__load_images(void* data, uint32 first, uint32 count)
+{
+    Texture_Atlas__Load_Batch* batch = (Texture_Atlas__Load_Batch*)data;
+    for (uint32 i = first; i < first + count; i++)
+    {
+        if (!texture_atlas__load_image(&batch->images[i], batch->loads[i].name, batch->loads[i].path))
+        {
+            batch->failed_count++;
+        }
+    }
+}
+
+// Same as texture_atlas__add_image for each one, but the PNGs get decoded in parallel on the pool
+bool32 texture_atlas__add_images(
+    Texture_Atlas__Builder* builder, Thread_Pool* pool, const Texture_Atlas__Load* loads, uint32 count)
+{
+    std::vector<Texture_Atlas__Image> images(count);
+    Texture_Atlas__Load_Batch batch = {};
+    batch.loads = loads;
+    batch.images = count ? &images[0] : 0;
+    thread_pool__parallel_for(pool, count, 1, texture_atlas__load_images, &batch);
+
+    for (uint32 i = 0; i < count; i++)
+    {
+        if (images[i].pixels)
+        {
+            builder->images.push_back(images[i]);
+        }
+    }
+    return batch.failed_count == 0;
+}
+
+local_internal bool32 texture_atlas__compare_image_height(const Texture_Atlas__Image& a, const Texture_Atlas__Image& b)
+{
+    return a.height > b.height;
+}
+
+// Simple shelf packer: tallest images first, left to right, start a new shelf when the row is full.
+// Returns the atlas height needed for the given width (or 0 if it won't fit).
+local_internal int32 texture_atlas__pack(std::vector<Texture_Atlas__Image>& images, int32 atlas_width)
+{
+    int32 shelf_x = 0;
+    int32 shelf_y = 0;
+    int32 shelf_height = 0;
+
+    for (uint32 i = 0; i < images.size(); i++)
+    {
+        Texture_Atlas__Image* image = &images[i];
+        int32 padded_width = image->width + 2 * TEXTURE_ATLAS_PADDING;
+        int32 padded_height = image->height + 2 * TEXTURE_ATLAS_PADDING;
+
+        if (padded_width > atlas_width)
+        {
+            return 0;
+        }
+
+        if (shelf_x + padded_width > atlas_width)
+        {
+            shelf_y += shelf_height;
+            shelf_x = 0;
+            shelf_height = 0;
+        }
+
+        image->x = shelf_x + TEXTURE_ATLAS_PADDING;
+        image->y = shelf_y + TEXTURE_ATLAS_PADDING;
+
+        shelf_x += padded_width;
+        if (padded_height > shelf_height)
+        {
+            shelf_height = padded_height;
+        }
+    }
+
+    return shelf_y + shelf_height;
+}
+
+bool32 texture_atlas__build(Texture_Atlas__Builder* builder, Texture_Atlas* atlas)
+{
+    std::vector<Texture_Atlas__Image>& images = builder->images;
+    std::stable_sort(images.begin(), images.end(), texture_atlas__compare_image_height);
+
+    // Find the smallest power-of-two square-ish atlas that fits everything
+    int32 atlas_width = 64;
+    int32 atlas_height = 0;
+    while (atlas_width <= TEXTURE_ATLAS_MAX_SIZE)
+    {
+        atlas_height = texture_atlas__pack(images, atlas_width);
+        if (atlas_height && atlas_height <= atlas_width)
+        {
+            break;
+        }
+        atlas_width *= 2;
+    }
+
+    if (atlas_width > TEXTURE_ATLAS_MAX_SIZE)
+    {
+        std::cout << "ERROR::TEXTURE_ATLAS: Sprites don't fit in a " << TEXTURE_ATLAS_MAX_SIZE << " atlas" << std::endl;
+        return 0;
+    }
+
+    int32 pot_height = 1;
+    while (pot_height < atlas_height)
+    {
+        pot_height *= 2;
+    }
+    atlas_height = pot_height;
+
+    // Blit every image into the atlas (zeroed memory keeps the padding transparent)
+    std::vector<unsigned char> atlas_pixels((size_t)atlas_width * atlas_height * 4, 0);
+    for (uint32 i = 0; i < images.size(); i++)
+    {
+        Texture_Atlas__Image* image = &images[i];
+        for (int32 row = 0; row < image->height; row++)
+        {
+            unsigned char* dst = &atlas_pixels[((size_t)(image->y + row) * atlas_width + image->x) * 4];
+            unsigned char* src = &image->pixels[(size_t)row * image->width * 4];
+            memcpy(dst, src, (size_t)image->width * 4);
+        }
+    }
+
+    glGenTextures(1, &atlas->texture_id);
+    gl_state__bind_texture_2d(0, atlas->texture_id);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    glTexImage2D(
+        GL_TEXTURE_2D, 0, GL_RGBA, atlas_width, atlas_height, 0, GL_RGBA, GL_UNSIGNED_BYTE, &atlas_pixels[0]);
+    gl_state__bind_texture_2d(0, 0);
+
+    atlas->width = atlas_width;
+    atlas->height = atlas_height;
+    atlas->regions.clear();
+
+    for (uint32 i = 0; i < images.size(); i++)
+    {
+        Texture_Atlas__Image* image = &images[i];
+
+        Atlas_Region region = {};
+        region.texture_id = atlas->texture_id;
+        region.u0 = (real32)image->x / (real32)atlas_width;
+        region.v0 = (real32)image->y / (real32)atlas_height;
+        region.u1 = (real32)(image->x + image->width) / (real32)atlas_width;
+        region.v1 = (real32)(image->y + image->height) / (real32)atlas_height;
+        region.width = image->width;
+        region.height = image->height;
+        atlas->regions[image->name] = region;
+
+        stbi_image_free(image->pixels);
+        image->pixels = 0;
+    }
+    images.clear();
+
+    return 1;
+}
+
+Atlas_Region texture_atlas__get_region(Texture_Atlas* atlas, const char* name)
+{
+    std::map<std::string, Atlas_Region>::iterator it = atlas->regions.find(name);
+    if (it == atlas->regions.end())
+    {
+        std::cout << "ERROR::TEXTURE_ATLAS: No sprite named " << name << std::endl;
+        Atlas_Region empty = {};
+        return empty;
+    }
+    return it->second;
+}
@@ -0,0 +1,345 @@
+// Thread pool
+//
+// The job system: a fixed set of worker threads, one per core besides the main thread, with one task queue each. New
+// tasks go on the back of the submitting thread's queue and a thread takes its own work from the back (newest first,
+// still warm in cache). Once its queue runs dry it steals from the front of the others' (oldest first, usually the
+// biggest chunks left). Threads that aren't part of the pool share queue 0 and help out while they wait for their
+// tasks to finish, so a pool with no workers still runs everything, just on the waiting thread.
+//
+// Dependencies go through counters: a task submitted with a signal counter bumps it and drops it again once it's run.
+// Tasks submitted after a counter sit off to the side until it reaches zero, and anyone can wait on one (helping out
+// in the meantime) without caring what else the pool is busy with. thread_pool__parallel_for is built on that.
+//
+// NOTE: No SDL in here, the headless runner uses it too.
+//
+// Usage:
+//     thread_pool__start(&pool, thread_pool__default_worker_count());
+//     thread_pool__submit(&pool, function, data);  // function(&pool, data) runs on some thread, can submit more
+//     thread_pool__wait(&pool);                    // Returns once everything submitted so far has run
+//
+//     Thread_Pool__Counter loaded = {};
+//     thread_pool__submit_signal(&pool, load, data, &loaded);
+//     thread_pool__submit_after(&pool, &loaded, build, data, 0);  // Runs once every load is done
+//     thread_pool__wait_for(&pool, &loaded);
+//
+//     thread_pool__parallel_for(&pool, item_count, min_batch_size, function, data);  // function(data, first, count)
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+
+struct Thread_Pool;
+struct Thread_Pool__Counter;
+typedef void (*Thread_Pool__Function)(Thread_Pool* pool, void* data);
+typedef void (*Thread_Pool__For_Function)(void* data, uint32 first, uint32 count);
+
+struct Thread_Pool__Task
+{
+    Thread_Pool__Function function;
+    void* data;
+    Thread_Pool__Counter* signal;  // Dropped by one once the task has run, can be 0
+};
+
+// Zero-initialize, and keep it alive until thread_pool__wait_for on it returns
+struct Thread_Pool__Counter
+{
+    std::atomic<int32> count;  // Tasks still to run that signal it
+    std::mutex mutex;
+    std::vector<Thread_Pool__Task> waiting;  // Submitted after it, queued once count gets to 0
+};
+
+struct Thread_Pool__Queue
+{
+    std::mutex mutex;
+    std::deque<Thread_Pool__Task> tasks;
+};
+
+struct Thread_Pool
+{
+    std::vector<std::thread> threads;
+    Thread_Pool__Queue* queues;  // Queue 0 is for threads outside the pool, then one per worker
+    uint32 queue_count;
+
+    std::atomic<int32> queued_count;      // Sitting in a queue
+    std::atomic<int32> unfinished_count;  // Submitted and not done running yet
+    std::atomic<bool> should_quit;
+
+    // Idle workers sleep on this until something gets queued
+    std::mutex sleep_mutex;
+    std::condition_variable wake_condition;
+
+    std::atomic<uint64> steal_count;
+};
+
+// Which queue the current thread pushes to and pops from (0 for anyone outside the pool)
+thread_local uint32 thread_pool__current_queue;
+
+// One core is the thread that starts the pool, it runs tasks whenever it waits on them
+uint32 thread_pool__default_worker_count()
+{
+    uint32 core_count = std::thread::hardware_concurrency();
+    return core_count > 1 ? core_count - 1 : 0;
+}
+
+// Puts an already counted task in the current thread's queue and wakes a worker for it
+local_internal void thread_pool__push(Thread_Pool* pool, Thread_Pool__Task task)
+{
+    {
+        Thread_Pool__Queue* queue = &pool->queues[thread_pool__current_queue];
+        std::lock_guard<std::mutex> lock(queue->mutex);
+        queue->tasks.push_back(task);
+    }
+
+    {
+        // Taking the lock makes sure a worker that just found nothing is already waiting, or will see the count
+        std::lock_guard<std::mutex> lock(pool->sleep_mutex);
+        pool->queued_count++;
+    }
+    pool->wake_condition.notify_one();
+}
+
+local_internal void thread_pool__signal(Thread_Pool* pool, Thread_Pool__Counter* counter)
+{
+    std::vector<Thread_Pool__Task> released;
+    {
+        // Under the lock so thread_pool__submit_after can't park a task just after the waiting list was emptied
+        std::lock_guard<std::mutex> lock(counter->mutex);
+        if (--counter->count == 0)
+        {
+            released.swap(counter->waiting);
+        }
+    }
+    for (uint32 i = 0; i < released.size(); i++)
+    {
+        thread_pool__push(pool, released[i]);
+    }
+}
+
+// Runs one task if it can find one, own queue first and then the others'. Returns 0 if every queue was empty.
+local_internal bool32 thread_pool__run_one(Thread_Pool* pool, uint32 queue_index)
+{
+    Thread_Pool__Task task = {};
+    bool32 has_task = 0;
+
+    for (uint32 i = 0; i < pool->queue_count && !has_task; i++)
+    {
+        uint32 victim_index = (queue_index + i) % pool->queue_count;
+        Thread_Pool__Queue* queue = &pool->queues[victim_index];
+        std::lock_guard<std::mutex> lock(queue->mutex);
+        if (queue->tasks.empty())
+        {
+            continue;
+        }
+
+        if (i == 0)
+        {
+            task = queue->tasks.back();
+            queue->tasks.pop_back();
+        }
+        else
+        {
+            task = queue->tasks.front();
+            queue->tasks.pop_front();
+            pool->steal_count++;
+        }
+        has_task = 1;
+    }
+
+    if (!has_task)
+    {
+        return 0;
+    }
+
+    pool->queued_count--;
+    task.function(pool, task.data);
+    if (task.signal)
+    {
+        thread_pool__signal(pool, task.signal);
+    }
+    pool->unfinished_count--;
+    return 1;
+}
+
+local_internal void thread_pool__worker(Thread_Pool* pool, uint32 queue_index)
+{
+    thread_pool__current_queue = queue_index;
+
+    while (!pool->should_quit)
+    {
+        if (thread_pool__run_one(pool, queue_index))
+        {
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(pool->sleep_mutex);
+        while (!pool->should_quit && pool->queued_count == 0)
+        {
+            pool->wake_condition.wait(lock);
+        }
+    }
+}
+
+void thread_pool__start(Thread_Pool* pool, uint32 worker_count)
+{
+    pool->queue_count = worker_count + 1;
+    pool->queues = new Thread_Pool__Queue[pool->queue_count];
+    pool->queued_count = 0;
+    pool->unfinished_count = 0;
+    pool->should_quit = false;
+    pool->steal_count = 0;
+
+    for (uint32 i = 0; i < worker_count; i++)
+    {
+        pool->threads.push_back(std::thread(thread_pool__worker, pool, i + 1));
+    }
+}
+
+// Lets the workers finish whatever they're running and joins them, anything still queued is dropped
+void thread_pool__stop(Thread_Pool* pool)
+{
+    {
+        std::lock_guard<std::mutex> lock(pool->sleep_mutex);
+        pool->should_quit = true;
+    }
+    pool->wake_condition.notify_all();
+
+    for (uint32 i = 0; i < pool->threads.size(); i++)
+    {
+        pool->threads[i].join();
+    }
+    pool->threads.clear();
+
+    delete[] pool->queues;
+    pool->queues = 0;
+    pool->queue_count = 0;
+}
+
+// signal (can be 0) counts the task as unfinished until it has run
+void thread_pool__submit_signal(
+    Thread_Pool* pool, Thread_Pool__Function function, void* data, Thread_Pool__Counter* signal)
+{
+    Thread_Pool__Task task = {};
+    task.function = function;
+    task.data = data;
+    task.signal = signal;
+
+    pool->unfinished_count++;
+    if (signal)
+    {
+        signal->count++;
+    }
+    thread_pool__push(pool, task);
+}
+
+void thread_pool__submit(Thread_Pool* pool, Thread_Pool__Function function, void* data)
+{
+    thread_pool__submit_signal(pool, function, data, 0);
+}
+
+// Holds the task back until every task signalling dependency has run. Submit those first, a counter that's already
+// at zero lets it go straight away.
+void thread_pool__submit_after(Thread_Pool* pool,
+                               Thread_Pool__Counter* dependency,
+                               Thread_Pool__Function function,
+                               void* data,
+                               Thread_Pool__Counter* signal)
+{
+    Thread_Pool__Task task = {};
+    task.function = function;
+    task.data = data;
+    task.signal = signal;
+
+    pool->unfinished_count++;
+    if (signal)
+    {
+        signal->count++;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(dependency->mutex);
+        if (dependency->count > 0)
+        {
+            dependency->waiting.push_back(task);
+            return;
+        }
+    }
+    thread_pool__push(pool, task);
+}
+
+// Helps run tasks until every one submitted so far (and everything they submitted) is done
+void thread_pool__wait(Thread_Pool* pool)
+{
+    while (pool->unfinished_count > 0)
+    {
+        if (!thread_pool__run_one(pool, thread_pool__current_queue))
+        {
+            std::this_thread::yield();  // The last few tasks are running elsewhere
+        }
+    }
+}
+
+// Helps run tasks until every one signalling the counter is done, whatever else is still queued
+void thread_pool__wait_for(Thread_Pool* pool, Thread_Pool__Counter* counter)
+{
+    while (counter->count > 0)
+    {
+        if (!thread_pool__run_one(pool, thread_pool__current_queue))
+        {
+            std::this_thread::yield();
+        }
+    }
+
+    // The last signal might still be letting go of the lock, the counter can go out of scope once it has
+    std::lock_guard<std::mutex> lock(counter->mutex);
+}
+
+struct Thread_Pool__For_Batch
+{
+    Thread_Pool__For_Function function;
+    void* data;
+    uint32 first;
+    uint32 count;
+};
+
+local_internal void thread_pool__run_for_batch(Thread_Pool* pool, void* data)
+{
+    (void)pool;
+    Thread_Pool__For_Batch* batch = (Thread_Pool__For_Batch*)data;
+    batch->function(batch->data, batch->first, batch->count);
+}
+
+// Calls function(data, first, count) over [0, item_count) in batches of at least min_batch_size, spread over the pool,
+// and returns once they've all run. A few batches per thread so a slow one doesn't hold everyone up.
+void thread_pool__parallel_for(
+    Thread_Pool* pool, uint32 item_count, uint32 min_batch_size, Thread_Pool__For_Function function, void* data)
+{
+    if (!item_count)
+    {
+        return;
+    }
+
+    uint32 batch_size = (item_count + pool->queue_count * 4 - 1) / (pool->queue_count * 4);
+    batch_size = batch_size > min_batch_size ? batch_size : min_batch_size;
+    batch_size = batch_size ? batch_size : 1;
+    uint32 batch_count = (item_count + batch_size - 1) / batch_size;
+    if (batch_count == 1)
+    {
+        function(data, 0, item_count);  // Not worth a trip through the queues
+        return;
+    }
+
+    std::vector<Thread_Pool__For_Batch> batches(batch_count);
+    Thread_Pool__Counter done = {};
+    for (uint32 i = 0; i < batch_count; i++)
+    {
+        Thread_Pool__For_Batch* batch = &batches[i];
+        batch->function = function;
+        batch->data = data;
+        batch->first = i * batch_size;
+        batch->count = i == batch_count - 1 ? item_count - batch->first : batch_size;
+        thread_pool__submit_signal(pool, thread_pool__run_for_batch, batch, &done);
+    }
+    thread_pool__wait_for(pool, &done);
+}
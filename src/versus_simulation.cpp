@@ -0,0 +1,327 @@
+// Versus simulation
+//
+// Two snakes on one board going after the same egg, for head-to-head play over the network (netplay.cpp). A snake
+// dies when it leaves the board or runs into either body. If both heads move into the same cell, both snakes die. The
+// round ends as soon as a snake dies. The survivor wins it, and if neither survives it's a draw. A few seconds later
+// the next round starts by itself, so two machines never have to agree on when to restart.
+//
+// Rollback means saving the game every tick and putting it back whenever a late input turns out different from the
+// guess. So the whole state is one flat struct (about 2.6 KB on any board up to VERSUS_MAX_CELLS) and saving it is a
+// plain copy. The bodies are stored the same way as mcts.cpp's compact state: the tail's position plus 2 bits per
+// part for the move that part still has to make to catch up with the head.
+//
+// Inputs come in one per player per tick (DIRECTION_NONE when nothing was pressed) instead of through a queue, because
+// that's what gets sent over the wire. The last direction pressed before a jump is the one taken.
+//
+// Usage:
+//     versus_simulation__reset(&sim, x_grids, y_grids, seed);
+//     uint8 inputs[VERSUS_PLAYER_COUNT] = {local_direction, remote_direction};
+//     versus_simulation__step(&sim, inputs, dt);
+//
+// Needs snake_simulation.cpp included before it (Direction, the RNG and snake_simulation__nth_free_cell).
+
+#define VERSUS_PLAYER_COUNT 2
+#define VERSUS_MAX_CELLS 4096  // Biggest board the flat state fits (e.g. 64x64), the game's 64x36 is well inside it
+#define VERSUS_DRAW VERSUS_PLAYER_COUNT  // Winner of a round nobody survived
+#define VERSUS_RESTART_DELAY__SECONDS 3.0f
+
+struct Versus_Snake
+{
+    int16 head_x;
+    int16 head_y;
+    int16 tail_x;  // Same as the head with no body
+    int16 tail_y;
+    uint16 length;         // Body parts behind the head
+    uint16 moves_first;    // Ring slot of the next move the tail makes
+    uint8 direction;       // Direction enum value
+    uint8 next_direction;  // Last one pressed since the previous jump, DIRECTION_NONE if nothing was
+    uint8 is_alive;
+    uint8 has_eaten;  // During the last step, for the sound
+    uint32 round_win_count;
+
+    uint8 moves[VERSUS_MAX_CELLS / 4];  // Tail's first, 2 bits each (the direction - 1)
+};
+
+struct Versus_Simulation
+{
+    uint16 x_grids;
+    uint16 y_grids;
+    int16 egg_x;
+    int16 egg_y;
+    uint32 rng;    // LCG state like Snake_Simulation's, only the egg spawns use it (it carries on across rounds)
+    uint32 ticks;  // Every step, including the ones between rounds
+    uint32 round;
+
+    real32 time_until_grid_jump__seconds;
+    real32 set_time_until_grid_jump__seconds;
+    real32 restart_countdown__seconds;
+
+    uint16 free_cell_count;
+    uint8 is_round_over;
+    uint8 winner;  // Player index, or VERSUS_DRAW
+
+    Versus_Snake snakes[VERSUS_PLAYER_COUNT];
+    uint64 occupied[VERSUS_MAX_CELLS / 64];  // Both snakes, one bit per cell (y * x_grids + x), padding bits set
+};
+
+//=======================================================
+// CELLS AND BODIES
+//=======================================================
+
+uint32 versus_simulation__cell(const Versus_Simulation* sim, int32 x, int32 y)
+{
+    return (uint32)y * sim->x_grids + (uint32)x;
+}
+
+bool32 versus_simulation__is_occupied(const Versus_Simulation* sim, uint32 cell)
+{
+    return (sim->occupied[cell / 64] >> (cell % 64)) & 1;
+}
+
+local_internal void versus_simulation__set_occupied(Versus_Simulation* sim, uint32 cell, bool32 is_occupied)
+{
+    assert(versus_simulation__is_occupied(sim, cell) != is_occupied);
+
+    uint64 bit = (uint64)1 << (cell % 64);
+    sim->occupied[cell / 64] = is_occupied ? sim->occupied[cell / 64] | bit : sim->occupied[cell / 64] & ~bit;
+    sim->free_cell_count = (uint16)(is_occupied ? sim->free_cell_count - 1 : sim->free_cell_count + 1);
+}
+
+// Move i counting from the tail, i.e. the direction body part i leaves its cell in to catch up with the head
+Direction versus_snake__move(const Versus_Snake* snake, uint32 i)
+{
+    uint32 slot = (snake->moves_first + i) % VERSUS_MAX_CELLS;
+    return (Direction)(((snake->moves[slot / 4] >> ((slot % 4) * 2)) & 3) + 1);
+}
+
+local_internal void versus_snake__set_move(Versus_Snake* snake, uint32 i, uint8 direction)
+{
+    uint32 slot = (snake->moves_first + i) % VERSUS_MAX_CELLS;
+    uint32 shift = (slot % 4) * 2;
+    snake->moves[slot / 4] = (uint8)((snake->moves[slot / 4] & ~(3 << shift)) | ((direction - 1) << shift));
+}
+
+void versus__direction_step(uint8 direction, int32* x, int32* y)
+{
+    *x += direction == DIRECTION_EAST ? 1 : direction == DIRECTION_WEST ? -1 : 0;
+    *y += direction == DIRECTION_NORTH ? 1 : direction == DIRECTION_SOUTH ? -1 : 0;
+}
+
+//=======================================================
+// SETUP
+//=======================================================
+
+local_internal void versus_simulation__start_round(Versus_Simulation* sim)
+{
+    uint32 cell_count = (uint32)sim->x_grids * sim->y_grids;
+    memset(sim->occupied, 0, sizeof(sim->occupied));
+    for (uint32 cell = cell_count; cell < VERSUS_MAX_CELLS; cell++)
+    {
+        sim->occupied[cell / 64] |= (uint64)1 << (cell % 64);
+    }
+    sim->free_cell_count = (uint16)cell_count;
+
+    // Opposite corners of the board, heading toward each other's side
+    int32 start_x[VERSUS_PLAYER_COUNT] = {sim->x_grids / 4, sim->x_grids - 1 - sim->x_grids / 4};
+    int32 start_y[VERSUS_PLAYER_COUNT] = {sim->y_grids / 4, sim->y_grids - 1 - sim->y_grids / 4};
+    uint8 start_direction[VERSUS_PLAYER_COUNT] = {DIRECTION_NORTH, DIRECTION_SOUTH};
+    for (uint32 player = 0; player < VERSUS_PLAYER_COUNT; player++)
+    {
+        Versus_Snake* snake = &sim->snakes[player];
+        snake->head_x = snake->tail_x = (int16)start_x[player];
+        snake->head_y = snake->tail_y = (int16)start_y[player];
+        snake->length = 0;
+        snake->moves_first = 0;
+        snake->direction = start_direction[player];
+        snake->next_direction = DIRECTION_NONE;
+        snake->is_alive = 1;
+        snake->has_eaten = 0;
+        versus_simulation__set_occupied(sim, versus_simulation__cell(sim, snake->head_x, snake->head_y), 1);
+    }
+
+    sim->egg_x = (int16)(sim->x_grids / 2);
+    sim->egg_y = (int16)(sim->y_grids / 2);
+    sim->set_time_until_grid_jump__seconds = SNAKE_STARTING_GRID_JUMP__SECONDS;
+    sim->time_until_grid_jump__seconds = sim->set_time_until_grid_jump__seconds;
+    sim->restart_countdown__seconds = VERSUS_RESTART_DELAY__SECONDS;
+    sim->is_round_over = 0;
+    sim->winner = VERSUS_DRAW;
+    sim->round++;
+}
+
+// Returns 0 if the board doesn't fit the flat state or is too small for two snakes and an egg
+bool32 versus_simulation__reset(Versus_Simulation* sim, uint32 x_grids, uint32 y_grids, uint32 seed)
+{
+    if (x_grids * y_grids > VERSUS_MAX_CELLS || x_grids < 4 || y_grids < 4)
+    {
+        fprintf(stderr, "ERROR::VERSUS_SIMULATION: Can't play versus on a %ux%u board\n", x_grids, y_grids);
+        return 0;
+    }
+
+    memset(sim, 0, sizeof(*sim));  // Padding included, so two copies of the same game are the same bytes
+    sim->x_grids = (uint16)x_grids;
+    sim->y_grids = (uint16)y_grids;
+    sim->rng = seed;
+    versus_simulation__start_round(sim);
+    return 1;
+}
+
+//=======================================================
+// STEP
+//=======================================================
+
+// Does the next step of dt_s make the snakes jump? Lets a bot pick a direction right before it's needed.
+bool32 versus_simulation__jumps_next_step(const Versus_Simulation* sim, real32 dt_s)
+{
+    return !sim->is_round_over && sim->time_until_grid_jump__seconds - dt_s <= 0;
+}
+
+local_internal void versus_simulation__end_round(Versus_Simulation* sim, uint8 winner)
+{
+    sim->is_round_over = 1;
+    sim->winner = winner;
+    if (winner != VERSUS_DRAW)
+    {
+        sim->snakes[winner].round_win_count++;
+    }
+}
+
+// Advances the game by dt_s with one input per player (DIRECTION_NONE for none) and returns 1 if the snakes moved or
+// a new round started, i.e. what it looks like changed
+bool32 versus_simulation__step(Versus_Simulation* sim, const uint8* inputs, real32 dt_s)
+{
+    sim->ticks++;
+    for (uint32 player = 0; player < VERSUS_PLAYER_COUNT; player++)
+    {
+        sim->snakes[player].has_eaten = 0;
+        if (inputs[player] != DIRECTION_NONE)
+        {
+            sim->snakes[player].next_direction = inputs[player];
+        }
+    }
+
+    if (sim->is_round_over)
+    {
+        sim->restart_countdown__seconds -= dt_s;
+        if (sim->restart_countdown__seconds > 0)
+        {
+            return 0;
+        }
+        versus_simulation__start_round(sim);
+        return 1;
+    }
+
+    sim->time_until_grid_jump__seconds -= dt_s;
+    if (sim->time_until_grid_jump__seconds > 0)
+    {
+        return 0;
+    }
+    sim->time_until_grid_jump__seconds = sim->set_time_until_grid_jump__seconds;
+
+    bool32 has_egg_been_eaten = 0;
+    {  // Turn, eat, then move the tails out of the way first so a head can follow a tail
+        for (uint32 player = 0; player < VERSUS_PLAYER_COUNT; player++)
+        {
+            Versus_Snake* snake = &sim->snakes[player];
+            if (snake->next_direction != DIRECTION_NONE && snake->next_direction % 2 != snake->direction % 2)
+            {
+                snake->direction = snake->next_direction;  // Any turn that isn't straight back
+            }
+            snake->next_direction = DIRECTION_NONE;
+
+            // The heads are never in the same cell, so at most one snake gets the egg
+            if (snake->head_x == sim->egg_x && snake->head_y == sim->egg_y)
+            {
+                snake->has_eaten = 1;
+                has_egg_been_eaten = 1;
+            }
+
+            versus_snake__set_move(snake, snake->length, snake->direction);
+            snake->length++;
+            if (!snake->has_eaten)
+            {
+                int32 x = snake->tail_x;
+                int32 y = snake->tail_y;
+                versus_simulation__set_occupied(sim, versus_simulation__cell(sim, x, y), 0);
+                versus__direction_step(versus_snake__move(snake, 0), &x, &y);
+                snake->tail_x = (int16)x;
+                snake->tail_y = (int16)y;
+                snake->moves_first = (uint16)((snake->moves_first + 1) % VERSUS_MAX_CELLS);
+                snake->length--;
+            }
+        }
+    }
+
+    {  // Move the heads and see who crashed
+        int32 head_x[VERSUS_PLAYER_COUNT];
+        int32 head_y[VERSUS_PLAYER_COUNT];
+        for (uint32 player = 0; player < VERSUS_PLAYER_COUNT; player++)
+        {
+            Versus_Snake* snake = &sim->snakes[player];
+            head_x[player] = snake->head_x;
+            head_y[player] = snake->head_y;
+            versus__direction_step(snake->direction, &head_x[player], &head_y[player]);
+
+            snake->head_x = (int16)head_x[player];
+            snake->head_y = (int16)head_y[player];
+            snake->is_alive = head_x[player] >= 0 && head_x[player] < (int32)sim->x_grids && head_y[player] >= 0 &&
+                              head_y[player] < (int32)sim->y_grids &&
+                              !versus_simulation__is_occupied(
+                                  sim, versus_simulation__cell(sim, head_x[player], head_y[player]));
+        }
+
+        if (head_x[0] == head_x[1] && head_y[0] == head_y[1])
+        {
+            sim->snakes[0].is_alive = 0;  // Head-on
+            sim->snakes[1].is_alive = 0;
+        }
+
+        for (uint32 player = 0; player < VERSUS_PLAYER_COUNT; player++)
+        {
+            if (sim->snakes[player].is_alive)
+            {
+                versus_simulation__set_occupied(sim, versus_simulation__cell(sim, head_x[player], head_y[player]), 1);
+            }
+        }
+    }
+
+    if (!sim->snakes[0].is_alive || !sim->snakes[1].is_alive)
+    {
+        versus_simulation__end_round(sim,
+                                     sim->snakes[0].is_alive   ? 0
+                                     : sim->snakes[1].is_alive ? 1
+                                                               : VERSUS_DRAW);
+    }
+    else if (has_egg_been_eaten)
+    {
+        if (sim->free_cell_count)
+        {
+            uint32 n = snake_rng__next(&sim->rng) % sim->free_cell_count;
+            uint32 cell = snake_simulation__nth_free_cell(sim->occupied, (sim->x_grids * sim->y_grids + 63) / 64, n);
+            sim->egg_x = (int16)(cell % sim->x_grids);
+            sim->egg_y = (int16)(cell / sim->x_grids);
+            sim->set_time_until_grid_jump__seconds -= 0.0005f;
+        }
+        else
+        {
+            // The board is full, the longer snake takes it
+            uint16 length_0 = sim->snakes[0].length;
+            uint16 length_1 = sim->snakes[1].length;
+            versus_simulation__end_round(sim, length_0 > length_1 ? 0 : length_1 > length_0 ? 1 : VERSUS_DRAW);
+        }
+    }
+
+    return 1;
+}
+
+// FNV-1a over the whole state. Both machines hash the same ticks and compare, to catch the games drifting apart.
+uint64 versus_simulation__hash(const Versus_Simulation* sim)
+{
+    uint64 hash = 14695981039346656037ULL;
+    const uint8* bytes = (const uint8*)sim;
+    for (size_t i = 0; i < sizeof(*sim); i++)
+    {
+        hash = (hash ^ bytes[i]) * 1099511628211ULL;
+    }
+    return hash;
+}